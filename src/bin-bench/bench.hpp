@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lib-engine/engine80.hpp"
+#include "lib-engine/logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <string_view>
+
+namespace qf::bench
+{
+	using Clock = std::chrono::steady_clock;
+
+	/*
+	* runs fn once to warm up, then returns the best time in seconds over the given number of runs
+	*/
+	template<typename F>
+	double measureSeconds(F&& fn, int runs = 5) {
+		fn();
+		double best = std::numeric_limits<double>::max();
+		for (int i = 0; i != runs; ++i) {
+			const auto start = Clock::now();
+			fn();
+			const std::chrono::duration<double> elapsed = Clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	/*
+	* logs an error when a benchmark got a wrong result, and makes bin-bench exit with 1, so
+	* a fast but broken run doesn't pass unnoticed
+	*/
+	bool check(bool ok, std::string_view what);
+
+	void runJobSystemBenchmark();
+	void runHeadlessPlatformBenchmark();
+	void runObjectPoolBenchmark();
+	void runUUIDMapBenchmark();
+	void runConfigBenchmark();
+	void runLoggerBenchmark();
+	void runProfilerBenchmark();
+	void runArchiveBenchmark();
+	void runAssetPackBenchmark();
+	void runIoBenchmark();
+	void runCompressionBenchmark();
+	void runAssetCacheBenchmark();
+	void runVfsBenchmark();
+	void runEcsBenchmark();
+	void runSystemSchedulerBenchmark();
+	void runBatchMathBenchmark();
+}
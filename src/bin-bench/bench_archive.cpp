@@ -0,0 +1,155 @@
+#include "bench.hpp"
+#include "lib-engine/archive.hpp"
+#include "lib-engine/class_factory.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <filesystem>
+#include <vector>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr u32 NODE_COUNT = 2'048;
+	constexpr u32 VERTEX_COUNT = 2'048;
+	constexpr u32 INDEX_COUNT = VERTEX_COUNT * 3;
+
+	constexpr UUID BenchMeshClassId("9c41e2b0-5d7a-4f83-b6e1-2a0d8c5f7e34");
+
+	/*
+	* a mesh in the shape of a real asset: a name, vertices that are copied out of the archive
+	* and indices that are viewed in place, plus references to other meshes
+	*/
+	class BenchMesh : public Serializable {
+	public:
+		std::string name{};
+		std::vector<glm::vec3> positions{};
+		std::vector<u32> ownedIndices{};
+		std::span<const u32> indices{};
+		std::vector<ptr<BenchMesh>> children{};
+
+		virtual UUID getClassId() const override { return BenchMeshClassId; }
+
+		virtual Expected<void> serialize(Archive& ar) override {
+			ar.serialize(name);
+			ar.serialize(positions);
+			ar.view(indices);
+			ar.serialize(children);
+			return ar.getStatus();
+		}
+	};
+
+	ptr<BenchMesh> makeGraph() {
+		auto root = makeShared<BenchMesh>();
+		root->name = "root";
+		for (u32 i = 0; i != NODE_COUNT; ++i) {
+			auto mesh = makeShared<BenchMesh>();
+			mesh->name = std::format("mesh-{}", i);
+			mesh->positions.resize(VERTEX_COUNT, glm::vec3(static_cast<float>(i)));
+			mesh->ownedIndices.resize(INDEX_COUNT, i);
+			mesh->indices = mesh->ownedIndices;
+			// every mesh is also referenced by its neighbour, so shared references are resolved
+			if (!root->children.empty()) {
+				mesh->children.push_back(root->children.back());
+			}
+			root->children.push_back(mesh);
+		}
+		return root;
+	}
+
+	/*
+	* the graph read back holds what was written, and meshes shared when written are shared again
+	*/
+	bool matchesGraph(const BenchMesh& read, const BenchMesh& written) {
+		if (read.name != written.name || read.children.size() != written.children.size()) {
+			return false;
+		}
+		for (size_t i = 0; i != written.children.size(); ++i) {
+			auto const& a = *read.children[i];
+			auto const& b = *written.children[i];
+			const bool sharesNeighbour = i == 0
+				? a.children.empty()
+				: a.children.size() == 1 && a.children[0] == read.children[i - 1];
+			if (a.name != b.name || a.positions != b.positions || !std::ranges::equal(a.indices, b.indices) || !sharesNeighbour) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	double gigabytesPerSecond(size_t bytes, double seconds) {
+		return static_cast<double>(bytes) / seconds * 1e-9;
+	}
+}
+
+/*
+* throughput of writing a large object graph and reading it back, from memory and from a
+* mapped file
+*/
+void qf::bench::runArchiveBenchmark() {
+	registerFactory(BenchMeshClassId, std::make_shared<TClassFactory<BenchMesh>>());
+
+	auto root = makeGraph();
+
+	size_t bytes = 0;
+	const double writeSeconds = measureSeconds([&] {
+		Archive ar(1);
+		ar.serialize(root);
+		bytes = ar.getData().size();
+	});
+	const double reservedSeconds = measureSeconds([&] {
+		Archive ar(1, bytes);
+		ar.serialize(root);
+	});
+
+	Archive written(1, bytes);
+	written.serialize(root);
+	if (auto res = written.getStatus(); !res.has_value()) {
+		log::error("{}", res.error().str());
+		return;
+	}
+	const std::vector<std::byte> data(written.getData().begin(), written.getData().end());
+
+	u64 sum = 0;
+	const double readSeconds = measureSeconds([&] {
+		auto ar = Archive::open(data).value();
+		ptr<BenchMesh> read;
+		ar->serialize(read);
+		sum += read->children.size() + read->children.back()->indices.back();
+	});
+
+	const fs::path path = fs::temp_directory_path() / "qf-bench-archive.bin";
+	if (auto res = written.save(path); !res.has_value()) {
+		log::error("{}", res.error().str());
+		return;
+	}
+	for (bool mapped : { false, true }) {
+		auto ar = mapped ? Archive::open(path) : Archive::open(data);
+		ptr<BenchMesh> read;
+		if (check(ar.has_value(), "the archive opens")) {
+			ar.value()->serialize(read);
+			check(ar.value()->getStatus().has_value() && read && matchesGraph(*read, *root),
+				mapped ? "the mapped archive reads back the graph" : "the archive reads back the graph");
+		}
+	}
+	const double mappedSeconds = measureSeconds([&] {
+		auto ar = Archive::open(path).value();
+		ptr<BenchMesh> read;
+		ar->serialize(read);
+		sum += read->children.size() + read->children.back()->indices.back();
+	});
+
+	const size_t positionBytes = size_t(NODE_COUNT) * VERTEX_COUNT * sizeof(glm::vec3);
+	const size_t indexBytes = size_t(NODE_COUNT) * INDEX_COUNT * sizeof(u32);
+	log::info("{} meshes, {} MB archive, {} MB copied when read, {} MB viewed", NODE_COUNT + 1,
+		bytes >> 20, positionBytes >> 20, indexBytes >> 20);
+	log::info("write              {:8.3f} ms {:6.2f} GB/s", writeSeconds * 1e3, gigabytesPerSecond(bytes, writeSeconds));
+	log::info("write, reserved    {:8.3f} ms {:6.2f} GB/s", reservedSeconds * 1e3, gigabytesPerSecond(bytes, reservedSeconds));
+	log::info("read from memory   {:8.3f} ms {:6.2f} GB/s", readSeconds * 1e3, gigabytesPerSecond(bytes, readSeconds));
+	log::info("read mapped file   {:8.3f} ms {:6.2f} GB/s ({})", mappedSeconds * 1e3, gigabytesPerSecond(bytes, mappedSeconds), sum != 0);
+
+	fs::remove(path);
+}
@@ -0,0 +1,177 @@
+#include "bench.hpp"
+#include "lib-engine/asset_cache.hpp"
+#include "lib-engine/mapped_file.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr u32 ASSET_COUNT = 100'000;
+	constexpr u64 ASSET_SIZE = 64 * 1024;
+	constexpr u32 LOOKUPS = 2'000'000;
+
+	struct BenchAsset {
+		static constexpr std::string_view ASSET_TYPE{ "bench" };
+
+		u32 index;
+	};
+
+	struct BenchFile {
+		static constexpr std::string_view ASSET_TYPE{ "bench-file" };
+
+		std::vector<std::byte> data;
+	};
+
+	/*
+	* asset indices drawn from a zipf-like distribution, a few assets are wanted far more
+	* often than the rest the way a world has common props and rare set pieces
+	*/
+	std::vector<u32> makeLookups() {
+		std::vector<double> weights(ASSET_COUNT);
+		for (u32 i = 0; i != ASSET_COUNT; ++i) {
+			weights[i] = 1.0 / std::pow(i + 1.0, 0.9);
+		}
+		std::discrete_distribution<u32> distribution(weights.begin(), weights.end());
+		std::mt19937 random(42);
+		std::vector<u32> lookups(LOOKUPS);
+		for (auto& lookup : lookups) {
+			lookup = distribution(random);
+		}
+		return lookups;
+	}
+
+	std::vector<std::byte> makeContents(u32 index) {
+		constexpr size_t FILE_SIZE = 4 * 1024;
+		std::vector<std::byte> contents(FILE_SIZE);
+		for (size_t i = 0; i != contents.size(); ++i) {
+			contents[i] = std::byte(index * 31 + i);
+		}
+		return contents;
+	}
+
+	/*
+	* a loader the way an asset type would write one, reading the whole file and counting
+	* how often it has been called
+	*/
+	Expected<LoadedAsset<BenchFile>> loadFile(const fs::path& path, std::atomic<u32>& loads) {
+		loads.fetch_add(1, std::memory_order_relaxed);
+		auto file = MappedFile::open(path);
+		if (!file.has_value()) {
+			return std::unexpected(file.error());
+		}
+		const auto data = file.value()->getData();
+		auto asset = std::make_shared<BenchFile>(BenchFile{ { data.begin(), data.end() } });
+		const u64 bytes = asset->data.size();
+		return LoadedAsset<BenchFile>{ .asset = std::move(asset), .bytes = bytes };
+	}
+
+	/*
+	* loads files through a cache with room for a few of them while holding on to the first,
+	* then has several threads load one asset at once
+	*/
+	void checkCache() {
+		constexpr u32 FILE_COUNT = 64;
+		constexpr u32 RESIDENT_FILES = 8;
+		constexpr u32 THREAD_COUNT = 8;
+
+		const fs::path root = fs::temp_directory_path() / "qf-bench-asset-cache";
+		fs::create_directories(root);
+		std::vector<fs::path> paths;
+		std::vector<UUID> ids(FILE_COUNT);
+		for (u32 i = 0; i != FILE_COUNT; ++i) {
+			const auto contents = makeContents(i);
+			paths.push_back(root / std::format("file-{}.bin", i));
+			std::ofstream(paths.back(), std::ios::binary).write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+			ids[i].p0 = i + 1;
+		}
+
+		{
+			AssetCache cache({ .defaultBudget = RESIDENT_FILES * makeContents(0).size() });
+			std::atomic<u32> loads{};
+			auto pinned = cache.load<BenchFile>(ids[0], [&] { return loadFile(paths[0], loads); });
+			bool intact = pinned.has_value() && pinned.value()->data == makeContents(0);
+			for (u32 i = 1; i != FILE_COUNT && intact; ++i) {
+				auto handle = cache.load<BenchFile>(ids[i], [&] { return loadFile(paths[i], loads); });
+				intact = handle.has_value() && handle.value()->data == makeContents(i);
+			}
+			bench::check(intact, "assets loaded through the cache match their files");
+
+			const auto stats = cache.getStats();
+			const auto type = std::ranges::find(stats, BenchFile::ASSET_TYPE, &AssetCache::TypeStats::type);
+			auto survivor = cache.find<BenchFile>(ids[0]);
+			bench::check(type != stats.end() && type->evictions != 0 && type->assetCount <= RESIDENT_FILES + 1
+				&& !cache.find<BenchFile>(ids[1]), "the cache evicts down to its budget");
+			bench::check(survivor && survivor.get() == pinned.value().get(), "a pinned asset survives eviction");
+		}
+
+		{
+			AssetCache cache({});
+			std::atomic<u32> loads{};
+			std::latch start(THREAD_COUNT);
+			std::vector<BenchFile*> loaded(THREAD_COUNT);
+			std::vector<std::thread> threads;
+			for (u32 t = 0; t != THREAD_COUNT; ++t) {
+				threads.emplace_back([&, t] {
+					start.arrive_and_wait();
+					auto handle = cache.load<BenchFile>(ids[0], [&] {
+						// long enough for every thread to ask while the load is still running
+						std::this_thread::sleep_for(std::chrono::milliseconds(20));
+						return loadFile(paths[0], loads);
+					});
+					loaded[t] = handle.has_value() ? handle.value().get() : nullptr;
+				});
+			}
+			for (auto& thread : threads) {
+				thread.join();
+			}
+			bench::check(loads.load() == 1 && loaded[0] && std::ranges::count(loaded, loaded[0]) == THREAD_COUNT,
+				"concurrent loads of one asset share a single load");
+		}
+
+		fs::remove_all(root);
+	}
+
+	void measureBudget(const std::vector<UUID>& ids, const std::vector<u32>& lookups, double residentFraction) {
+		const u64 budget = static_cast<u64>(ASSET_COUNT * residentFraction) * ASSET_SIZE;
+		AssetCache cache({ .defaultBudget = budget });
+		const double seconds = bench::measureSeconds([&] {
+			for (u32 index : lookups) {
+				auto handle = cache.load<BenchAsset>(ids[index], [&]() -> Expected<LoadedAsset<BenchAsset>> {
+					return LoadedAsset<BenchAsset>{ .asset = std::make_shared<BenchAsset>(BenchAsset{ index }), .bytes = ASSET_SIZE };
+				});
+			}
+		}, 1);
+
+		const auto stats = cache.getStats().front();
+		log::info("budget {:5.1f}% of the assets: hit rate {:5.1f}%, {:6.1f} ns per load, {} resident",
+			residentFraction * 100, 100.0 * stats.hits / (stats.hits + stats.misses), seconds / LOOKUPS * 1e9, stats.assetCount);
+	}
+}
+
+/*
+* hit rate of the clock eviction at a few budgets, under a skewed access pattern. the loads
+* that miss only allocate, so the time per load is the cost of the cache itself
+*/
+void qf::bench::runAssetCacheBenchmark() {
+	checkCache();
+
+	std::vector<UUID> ids(ASSET_COUNT);
+	for (u32 i = 0; i != ASSET_COUNT; ++i) {
+		ids[i].p0 = i + 1;
+	}
+	const auto lookups = makeLookups();
+	for (double residentFraction : { 0.01, 0.05, 0.2, 1.0 }) {
+		measureBudget(ids, lookups, residentFraction);
+	}
+}
@@ -0,0 +1,67 @@
+#include "bench.hpp"
+#include "lib-engine/asset_pack.hpp"
+
+#include <filesystem>
+#include <vector>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr u32 ASSET_SIZE = 256;
+	constexpr u32 LOOKUPS = 1'000'000;
+
+	/*
+	* time to open a pack of assetCount assets and to find assets in it
+	*/
+	void measurePack(const fs::path& path, u32 assetCount) {
+		AssetPackBuilder builder;
+		std::vector<UUID> ids;
+		for (u32 i = 0; i != assetCount; ++i) {
+			const std::string name = std::format("textures/texture-{}.dds", i);
+			ids.push_back(makeAssetId(name));
+			builder.add(ids.back(), name, std::vector<std::byte>(ASSET_SIZE, std::byte(i)));
+		}
+		if (auto res = builder.write(path); !res.has_value()) {
+			log::error("{}", res.error().str());
+			return;
+		}
+
+		size_t found = 0;
+		const double openSeconds = bench::measureSeconds([&] {
+			found += AssetPack::open(path).value()->getAssetCount();
+		}, 20);
+
+		auto pack = AssetPack::open(path).value();
+		bool intact = pack->getAssetCount() == assetCount && !pack->find(makeAssetId("textures/missing.dds"));
+		for (u32 i = 0; i != assetCount && intact; ++i) {
+			const auto data = pack->find(ids[i]);
+			intact = data && data->size() == ASSET_SIZE
+				&& std::all_of(data->begin(), data->end(), [&](std::byte b) { return b == std::byte(i); })
+				&& pack->getName(ids[i]) == std::format("textures/texture-{}.dds", i);
+		}
+		bench::check(intact, "every asset reads back from the pack");
+
+		const double findSeconds = bench::measureSeconds([&] {
+			for (u32 i = 0; i != LOOKUPS; ++i) {
+				found += pack->find(ids[(i * 7919u) % assetCount])->size();
+			}
+		});
+
+		log::info("{:>7} assets, {:>9} bytes: open {:8.3f} us, find {:6.1f} ns ({})", assetCount, fs::file_size(path),
+			openSeconds * 1e6, findSeconds / LOOKUPS * 1e9, found != 0);
+	}
+}
+
+/*
+* opening a pack costs the same however many assets it holds, finding one is a hash probe
+*/
+void qf::bench::runAssetPackBenchmark() {
+	const fs::path path = fs::temp_directory_path() / "qf-bench.pack";
+	for (u32 assetCount : { 1'000u, 10'000u, 100'000u }) {
+		measurePack(path, assetCount);
+	}
+	fs::remove(path);
+}
@@ -0,0 +1,136 @@
+#include "bench.hpp"
+#include "lib-engine/batch_math.hpp"
+
+#include <cmath>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	// fits in L2, so the kernels run at the speed of the arithmetic
+	constexpr u32 CACHED_COUNT = 1024;
+	constexpr u32 CACHED_REPEATS = 1024;
+	// streams from memory, so the kernels run at the speed of the memory
+	constexpr u32 STREAMED_COUNT = 1 << 20;
+
+	struct Data {
+		std::vector<glm::vec3> points;
+		std::vector<glm::mat4> a;
+		std::vector<glm::mat4> b;
+		std::vector<glm::mat4> matrices;
+		std::vector<glm::quat> quats;
+		std::vector<float> x, y, z, dots;
+
+		explicit Data(u32 count)
+			: points(count), a(count), b(count), matrices(count), quats(count), x(count), y(count), z(count), dots(count)
+		{
+			std::mt19937 random(7);
+			std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+			for (u32 i = 0; i != count; ++i) {
+				points[i] = glm::vec3(value(random), value(random), value(random));
+				quats[i] = glm::quat{};
+				quats[i].x = 0.5f, quats[i].y = 0.5f, quats[i].z = 0.5f, quats[i].w = 0.5f;
+				x[i] = value(random), y[i] = value(random), z[i] = value(random);
+			}
+			for (auto* matrices : { &a, &b }) {
+				for (auto& m : *matrices) {
+					float* f = reinterpret_cast<float*>(&m);
+					for (int k = 0; k != 16; ++k) {
+						f[k] = value(random);
+					}
+				}
+			}
+		}
+	};
+
+	struct Kernel {
+		std::string_view name;
+		// bytes read and written per element
+		u32 bytes;
+		void (*fn)(Data& data, const glm::mat4& m);
+	};
+
+	const Kernel kernels[] = {
+		{ "transformPoints", 24, [](Data& data, const glm::mat4& m) { batch::transformPoints(m, data.points, data.points); } },
+		{ "multiplyMatrices", 192, [](Data& data, const glm::mat4&) { batch::multiplyMatrices(data.a, data.b, data.matrices); } },
+		{ "quatsToMatrices", 80, [](Data& data, const glm::mat4&) { batch::quatsToMatrices(data.quats, data.matrices); } },
+		{ "dot", 28, [](Data& data, const glm::mat4&) { batch::dot(data.x, data.y, data.z, data.x, data.y, data.z, data.dots); } },
+		{ "normalize", 24, [](Data& data, const glm::mat4&) { batch::normalize(data.x, data.y, data.z); } },
+	};
+
+	template<typename T>
+	bool isClose(const std::vector<T>& values, const std::vector<T>& expected) {
+		const std::span<const float> a{ reinterpret_cast<const float*>(values.data()), values.size() * sizeof(T) / sizeof(float) };
+		const std::span<const float> b{ reinterpret_cast<const float*>(expected.data()), a.size() };
+		return std::equal(a.begin(), a.end(), b.begin(), [](float x, float y) {
+			return std::abs(x - y) <= 1e-5f * std::max(1.f, std::abs(y));
+		});
+	}
+
+	/*
+	* every kernel with every instruction set gives what the scalar kernel gives, on a count
+	* that leaves a tail for the scalar loop after the vector one
+	*/
+	void checkKernels(batch::Isa supported, const glm::mat4& m) {
+		constexpr u32 COUNT = 1'027;
+		for (auto const& kernel : kernels) {
+			batch::setIsa(batch::Isa::Scalar).value();
+			Data expected(COUNT);
+			kernel.fn(expected, m);
+			for (auto isa : { batch::Isa::Sse4, batch::Isa::Avx2 }) {
+				if (isa > supported) {
+					continue;
+				}
+				batch::setIsa(isa).value();
+				Data data(COUNT);
+				kernel.fn(data, m);
+				const bool matches = isClose(data.points, expected.points) && isClose(data.matrices, expected.matrices)
+					&& isClose(data.x, expected.x) && isClose(data.y, expected.y) && isClose(data.z, expected.z)
+					&& isClose(data.dots, expected.dots);
+				bench::check(matches, std::format("{} with {} matches the scalar kernel", kernel.name, batch::getIsaName(isa)));
+			}
+		}
+	}
+}
+
+/*
+* every batch kernel with each instruction set the cpu has, on arrays that fit in cache and
+* on arrays streamed from memory. transformPoints works in place on a matrix close to the
+* identity so the points stay finite
+*/
+void qf::bench::runBatchMathBenchmark() {
+	Data cached(CACHED_COUNT);
+	Data streamed(STREAMED_COUNT);
+	glm::mat4 m{};
+	float* f = reinterpret_cast<float*>(&m);
+	for (int k = 0; k != 16; ++k) {
+		f[k] = k % 5 == 0 ? 1.0f : 1e-4f;
+	}
+
+	const batch::Isa supported = batch::getSupportedIsa();
+	checkKernels(supported, m);
+	for (auto const& kernel : kernels) {
+		for (auto isa : { batch::Isa::Scalar, batch::Isa::Sse4, batch::Isa::Avx2 }) {
+			if (isa > supported) {
+				continue;
+			}
+			batch::setIsa(isa).value();
+			const double cachedSeconds = bench::measureSeconds([&] {
+				for (u32 i = 0; i != CACHED_REPEATS; ++i) {
+					kernel.fn(cached, m);
+				}
+			});
+			const double streamedSeconds = bench::measureSeconds([&] {
+				kernel.fn(streamed, m);
+			});
+			log::info("{:<16} {:<6}: cached {:6.2f} ns per element, streamed {:6.2f} GB/s",
+				kernel.name, batch::getIsaName(isa),
+				cachedSeconds / (double(CACHED_COUNT) * CACHED_REPEATS) * 1e9,
+				double(kernel.bytes) * STREAMED_COUNT / streamedSeconds * 1e-9);
+		}
+	}
+	batch::setIsa(supported).value();
+}
@@ -0,0 +1,104 @@
+#include "bench.hpp"
+#include "lib-engine/class_ids.hpp"
+#include "lib-engine/compression.hpp"
+#include "lib-engine/job_system.hpp"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr size_t DATA_SIZE = 64u << 20;
+	constexpr u32 RANDOM_READS = 4096;
+	constexpr size_t RANDOM_READ_SIZE = 4096;
+
+	/*
+	* something like mesh data: vertex positions and normals on a smooth surface, with
+	* indices, which compresses about as well as real assets do
+	*/
+	std::vector<std::byte> makeData() {
+		std::vector<std::byte> data(DATA_SIZE);
+		auto* floats = reinterpret_cast<float*>(data.data());
+		const size_t vertexFloats = DATA_SIZE / 2 / sizeof(float);
+		for (size_t i = 0; i != vertexFloats; ++i) {
+			const float t = static_cast<float>(i / 6) * 0.001f;
+			floats[i] = std::round(std::sin(t * static_cast<float>(i % 6 + 1)) * 1024.f) / 1024.f;
+		}
+		auto* indices = reinterpret_cast<u32*>(data.data() + DATA_SIZE / 2);
+		for (size_t i = 0; i != DATA_SIZE / 2 / sizeof(u32); ++i) {
+			indices[i] = static_cast<u32>(i / 3 + (i % 3) * 64);
+		}
+		return data;
+	}
+
+	void measureCodec(const std::vector<std::byte>& data, Codec codec, std::string_view label) {
+		std::vector<std::byte> compressed;
+		const double compressSeconds = bench::measureSeconds([&] {
+			auto res = compress(data, { .codec = codec });
+			if (!res.has_value()) {
+				log::error("{}", res.error().str());
+				return;
+			}
+			compressed = std::move(res.value());
+		}, 1);
+		auto block = CompressedBlock::open(compressed);
+		if (!bench::check(block.has_value(), std::format("{} output opens as a compressed block", label))) {
+			return;
+		}
+		log::info("{}: {} chunks, ratio {:.2f}, compress {:.2f} GB/s", label, block->getChunkCount(),
+			double(data.size()) / compressed.size(), data.size() / compressSeconds * 1e-9);
+
+		std::vector<std::byte> out(data.size());
+		const u32 maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+		for (u32 workers = 1;; workers = std::min(workers * 2, maxWorkers)) {
+			auto jobSystem = createInstance<jobs::JobSystem>(WorkStealingJobSystemClassId);
+			if (auto res = jobSystem->initialize(workers); !res.has_value()) {
+				log::info("failed to start job system: {}", res.error().str());
+				return;
+			}
+			bool ok = true;
+			const double seconds = bench::measureSeconds([&] {
+				ok &= block->decompress(*jobSystem, out).has_value();
+			}, 5);
+			jobSystem->shutdown();
+
+			const double bytesPerSecond = data.size() / seconds;
+			log::info("{}: workers {:>3} decompress {:6.2f} GB/s, {:5.2f} GB/s per core", label, workers,
+				bytesPerSecond * 1e-9, bytesPerSecond / workers * 1e-9);
+			bench::check(ok && out == data, std::format("{} on {} workers decompresses to the original", label, workers));
+			if (workers == maxWorkers) {
+				break;
+			}
+		}
+
+		// each read decompresses one chunk, or two where it crosses a boundary
+		std::vector<std::byte> page(RANDOM_READ_SIZE);
+		bool readsMatch = true;
+		for (u32 i = 0; i != RANDOM_READS && readsMatch; ++i) {
+			const u64 offset = (u64(i) * 2654435761u) % (data.size() - page.size());
+			readsMatch = block->read(offset, page).has_value()
+				&& std::equal(page.begin(), page.end(), data.begin() + offset);
+		}
+		bench::check(readsMatch, std::format("{} reads at random offsets match the original", label));
+		const double readSeconds = bench::measureSeconds([&] {
+			for (u32 i = 0; i != RANDOM_READS; ++i) {
+				const u64 offset = (u64(i) * 2654435761u) % (data.size() - page.size());
+				block->read(offset, page).value();
+			}
+		});
+		log::info("{}: random 4 KB read {:.1f} us", label, readSeconds / RANDOM_READS * 1e6);
+	}
+}
+
+/*
+* compressed ratio and decompression speed for each codec, from one worker up to every
+* hardware thread
+*/
+void qf::bench::runCompressionBenchmark() {
+	const auto data = makeData();
+	measureCodec(data, Codec::Lz4, "lz4");
+	measureCodec(data, Codec::Zstd, "zstd");
+}
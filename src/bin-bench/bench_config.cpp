@@ -0,0 +1,85 @@
+#include "bench.hpp"
+#include "lib-engine/config_index.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr u32 SECTION_COUNT = 2'000;
+
+	/*
+	* a config in the shape of a big production one, SECTION_COUNT sections each holding a
+	* nested map of mixed scalars and a list
+	*/
+	std::string makeConfig() {
+		std::string text;
+		for (u32 i = 0; i != SECTION_COUNT; ++i) {
+			text += std::format("section-{}:\n", i);
+			text += "  enabled: true\n  count: 42\n  scale: 1.5\n  name: some-setting-name\n";
+			text += "  limits:\n    min: -10\n    max: 10\n    soft: 0.25\n";
+			text += "  tags:\n  - alpha\n  - beta\n  - gamma\n";
+		}
+		return text;
+	}
+}
+
+/*
+* startup cost of the configuration, parsing YAML against loading the binary cache
+*/
+void qf::bench::runConfigBenchmark() {
+	const fs::path dir = fs::temp_directory_path() / "qf-bench-config";
+	fs::create_directories(dir);
+	const fs::path yamlPath = dir / "config.yaml";
+	const fs::path cachePath = dir / "config.cache";
+
+	const std::string text = makeConfig();
+	std::ofstream(yamlPath, std::ios::binary) << text;
+	fs::remove(cachePath);
+
+	size_t values = 0;
+	const double parseSeconds = measureSeconds([&] {
+		values += ConfigIndex::parseYaml(text).value().size();
+	});
+
+	if (auto res = ConfigIndex::parseYaml(text).value().writeCache(cachePath, ConfigIndex::hashSource(text)); !res.has_value()) {
+		log::info("{}", res.error().str());
+		return;
+	}
+
+	const u64 sourceHash = ConfigIndex::hashSource(text);
+	{
+		const auto parsed = ConfigIndex::parseYaml(text).value();
+		const auto cached = ConfigIndex::loadCache(cachePath, sourceHash);
+		if (check(cached.has_value(), "the config cache loads")) {
+			const auto tags = cached->getStringList("section-7.tags");
+			check(cached->isCached() && cached->size() == parsed.size(), "the config cache holds every value");
+			check(cached->getChangedPaths(parsed).empty(), "the config cache matches the yaml");
+			check(cached->getInt("section-7.limits.min") == -10 && cached->getFloat("section-7.scale") == 1.5
+				&& cached->getString("section-7.name") == "some-setting-name" && cached->getBool("section-7.enabled") == true
+				&& tags.size() == 3 && tags[0] == "alpha" && tags[2] == "gamma",
+				"values read from the config cache");
+		}
+		check(!ConfigIndex::loadCache(cachePath, sourceHash + 1).has_value(), "a stale config cache is rejected");
+	}
+
+	const double cacheSeconds = measureSeconds([&] {
+		values += ConfigIndex::loadCache(cachePath, sourceHash).value().size();
+	});
+
+	const double startupSeconds = measureSeconds([&] {
+		values += ConfigIndex::load(yamlPath, cachePath).value().size();
+	});
+
+	log::info("{} values, {} bytes of yaml, {} bytes of cache", ConfigIndex::parseYaml(text).value().size(), text.size(), fs::file_size(cachePath));
+	log::info("parse yaml         {:8.3f} ms", parseSeconds * 1e3);
+	log::info("load cache         {:8.3f} ms", cacheSeconds * 1e3);
+	log::info("startup, cache hit {:8.3f} ms (reads and hashes the yaml as well), {:.1f}x faster ({})",
+		startupSeconds * 1e3, parseSeconds / startupSeconds, values != 0);
+
+	fs::remove_all(dir);
+}
@@ -0,0 +1,186 @@
+#include "bench.hpp"
+#include "lib-engine/ecs.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 ENTITY_COUNT = 1'000'000;
+	constexpr u32 MOVES = 100'000;
+	constexpr float DT = 1.0f / 60.0f;
+
+	struct Position {
+		glm::vec3 value;
+	};
+
+	struct Velocity {
+		glm::vec3 value;
+	};
+
+	struct Health {
+		float value;
+	};
+
+	// state the movement loop doesn't read, the way most of an entity is
+	struct Render {
+		u64 mesh;
+		u64 material;
+		float bounds[6];
+		u32 flags;
+	};
+
+	struct Frozen {};
+
+	// owns heap memory, so moving it between archetypes has to relocate and destroy it properly
+	struct Name {
+		std::string value;
+	};
+
+	/*
+	* the same entities as one array of structs, which moving them reads end to end
+	*/
+	struct Object {
+		Position position;
+		Velocity velocity;
+		Health health;
+		Render render;
+	};
+
+	std::string makeName(u32 i) {
+		return std::format("entity {} with a name too long for the small string buffer", i);
+	}
+
+	/*
+	* entities with a component that owns memory, moved back and forth between archetypes
+	* and destroyed out of the middle of them, so rows are swapped with the last one
+	*/
+	void checkNonTrivialComponents() {
+		constexpr u32 COUNT = 20'000;
+
+		ecs::World world;
+		std::vector<ecs::Entity> entities;
+		for (u32 i = 0; i != COUNT; ++i) {
+			entities.push_back(world.create(Position{ glm::vec3(static_cast<float>(i)) }, Name{ makeName(i) }));
+		}
+		for (u32 i = 0; i != COUNT; i += 3) {
+			world.add<Frozen>(entities[i]);
+		}
+		for (u32 i = 0; i != COUNT; i += 5) {
+			world.destroy(entities[i]);
+		}
+		for (u32 i = 0; i != COUNT; i += 6) {
+			world.remove<Frozen>(entities[i]);
+		}
+
+		bool intact = true;
+		u32 alive = 0;
+		for (u32 i = 0; i != COUNT && intact; ++i) {
+			if (i % 5 == 0) {
+				intact = !world.isAlive(entities[i]);
+				continue;
+			}
+			++alive;
+			const auto* position = world.get<Position>(entities[i]);
+			const auto* name = world.get<Name>(entities[i]);
+			intact = position && name && position->value.x == static_cast<float>(i) && name->value == makeName(i)
+				&& world.has<Frozen>(entities[i]) == (i % 3 == 0 && i % 6 != 0);
+		}
+		bench::check(intact && world.getEntityCount() == alive, "components that own memory survive moves and destroys");
+	}
+}
+
+/*
+* moving 1M entities a step through world.each() against a loop over an array of structs.
+* the ecs reads only the position and velocity arrays, the array of structs reads every
+* byte of every object. then the cost of adding and removing a component, which moves the
+* entity between archetypes
+*/
+void qf::bench::runEcsBenchmark() {
+	ecs::World world;
+	std::vector<ecs::Entity> entities;
+	entities.reserve(ENTITY_COUNT);
+	const double createSeconds = bench::measureSeconds([&] {
+		for (auto entity : entities) {
+			world.destroy(entity);
+		}
+		entities.clear();
+		for (u32 i = 0; i != ENTITY_COUNT; ++i) {
+			const float f = static_cast<float>(i);
+			// every other entity has health, so the query spans two archetypes
+			entities.push_back(i % 2
+				? world.create(Position{ glm::vec3(f) }, Velocity{ glm::vec3(1.0f) }, Render{})
+				: world.create(Position{ glm::vec3(f) }, Velocity{ glm::vec3(1.0f) }, Render{}, Health{ 100.0f }));
+		}
+	}, 1);
+	log::info("create {} entities: {:.2f} ms, {} archetypes", ENTITY_COUNT, createSeconds * 1e3, world.getArchetypeCount());
+
+	const double eachSeconds = bench::measureSeconds([&] {
+		world.each<Position, const Velocity>([](Position& position, const Velocity& velocity) {
+			position.value += velocity.value * DT;
+		});
+	});
+	const double chunkSeconds = bench::measureSeconds([&] {
+		world.eachChunk<Position, const Velocity>([](std::span<const ecs::Entity>, std::span<Position> positions, std::span<const Velocity> velocities) {
+			for (size_t i = 0; i != positions.size(); ++i) {
+				positions[i].value += velocities[i].value * DT;
+			}
+		});
+	});
+
+	std::vector<Object> objects(ENTITY_COUNT);
+	const double aosSeconds = bench::measureSeconds([&] {
+		for (auto& object : objects) {
+			object.position.value += object.velocity.value * DT;
+		}
+	});
+	log::info("move {} entities: each {:5.2f} ms, eachChunk {:5.2f} ms, array of structs {:5.2f} ms",
+		ENTITY_COUNT, eachSeconds * 1e3, chunkSeconds * 1e3, aosSeconds * 1e3);
+
+	u32 visited = 0;
+	world.each<const Position>([&](const Position&) { ++visited; });
+	check(visited == ENTITY_COUNT, "world.each visits every entity once");
+
+	std::vector<glm::vec3> positions;
+	for (auto entity : entities) {
+		positions.push_back(world.get<Position>(entity)->value);
+	}
+
+	const double moveSeconds = bench::measureSeconds([&] {
+		for (u32 i = 0; i != MOVES; ++i) {
+			world.add<Frozen>(entities[(i * 7919u) % ENTITY_COUNT]);
+		}
+		for (u32 i = 0; i != MOVES; ++i) {
+			world.remove<Frozen>(entities[(i * 7919u) % ENTITY_COUNT]);
+		}
+	});
+	bool unchanged = true;
+	for (u32 i = 0; i != ENTITY_COUNT && unchanged; ++i) {
+		const auto* position = world.get<Position>(entities[i]);
+		const auto* velocity = world.get<Velocity>(entities[i]);
+		unchanged = position && velocity && position->value == positions[i] && velocity->value == glm::vec3(1.0f)
+			&& !world.has<Frozen>(entities[i]);
+	}
+	check(unchanged, "entities keep their components through adding and removing one");
+
+	float sum = 0;
+	const double getSeconds = bench::measureSeconds([&] {
+		for (u32 i = 0; i != MOVES; ++i) {
+			sum += world.get<Position>(entities[(i * 7919u) % ENTITY_COUNT])->value.x;
+		}
+	});
+	log::info("add and remove a component: {:5.1f} ns, get {:5.1f} ns ({})",
+		moveSeconds / (2 * MOVES) * 1e9, getSeconds / MOVES * 1e9, sum != 0);
+
+	const ecs::Entity destroyed = entities.front();
+	world.destroy(destroyed);
+	const ecs::Entity reused = world.create(Position{ glm::vec3(-1.0f) });
+	check(reused.index == destroyed.index && !world.isAlive(destroyed) && !world.get<Position>(destroyed)
+		&& world.get<Position>(reused)->value == glm::vec3(-1.0f), "a destroyed entity stays dead once its index is reused");
+
+	checkNonTrivialComponents();
+}
@@ -0,0 +1,103 @@
+#include "bench.hpp"
+#include "lib-engine/class_ids.hpp"
+#include "lib-engine/io_system.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <vector>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr size_t FILE_SIZE = 64u << 20;
+	constexpr size_t READ_SIZE = 4096;
+	constexpr u32 READ_COUNT = 16384;
+
+	/*
+	* reads READ_COUNT blocks at random offsets, submitted as one batch, and waits for all of them
+	*/
+	void measureReads(const fs::path& path, const io::Settings& settings, std::string_view label) {
+		auto ioSystem = createInstance<io::IoSystem, AsyncIoSystemClassId>();
+		if (auto res = ioSystem->initialize(settings); !res.has_value()) {
+			log::info("{:<12} skipped: {}", label, res.error().str());
+			return;
+		}
+		auto file = ioSystem->openFile(path);
+		if (!file.has_value()) {
+			log::error("{}", file.error().str());
+			return;
+		}
+
+		std::vector<std::byte> buffers(READ_COUNT * READ_SIZE);
+		std::atomic<u32> failed = 0;
+		const double seconds = bench::measureSeconds([&] {
+			std::latch done(READ_COUNT);
+			std::vector<io::ReadRequest> requests;
+			requests.reserve(READ_COUNT);
+			for (u32 i = 0; i != READ_COUNT; ++i) {
+				const u64 block = (u64(i) * 2654435761u) % (FILE_SIZE / READ_SIZE);
+				requests.push_back(io::ReadRequest{
+					.file = file.value(),
+					.offset = block * READ_SIZE,
+					.buffer = std::span(buffers).subspan(i * READ_SIZE, READ_SIZE),
+					.callback = [&](Expected<size_t> result) {
+						if (!result.has_value() || result.value() != READ_SIZE) {
+							failed.fetch_add(1, std::memory_order_relaxed);
+						}
+						done.count_down();
+					},
+				});
+			}
+			ioSystem->submit(requests);
+			done.wait();
+		}, 5);
+
+		// every block of the file starts with its own offset
+		bool contents = true;
+		for (u32 i = 0; i != READ_COUNT && contents; ++i) {
+			const u64 block = (u64(i) * 2654435761u) % (FILE_SIZE / READ_SIZE);
+			u64 offset;
+			std::memcpy(&offset, buffers.data() + i * READ_SIZE, sizeof(offset));
+			contents = offset == block * READ_SIZE;
+		}
+
+		log::info("{:<12} {:>9.0f} reads/s {:>8.1f} MB/s", label, READ_COUNT / seconds,
+			READ_COUNT * READ_SIZE / seconds / (1 << 20));
+		bench::check(failed.load() == 0 && contents, std::format("{} reads what was written", label));
+		ioSystem->closeFile(file.value());
+		ioSystem->shutdown();
+	}
+}
+
+/*
+* thousands of small random reads through each backend. the file was just written, so the
+* reads mostly come from the page cache and this measures the cost per request more than the
+* device. drop the caches first to measure the device
+*/
+void qf::bench::runIoBenchmark() {
+	const fs::path path = fs::temp_directory_path() / "qf-bench.io";
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		std::vector<char> block(1 << 20);
+		for (size_t written = 0; written != FILE_SIZE; written += block.size()) {
+			for (size_t offset = 0; offset < block.size(); offset += READ_SIZE) {
+				const u64 fileOffset = written + offset;
+				std::memcpy(block.data() + offset, &fileOffset, sizeof(fileOffset));
+			}
+			out.write(block.data(), static_cast<std::streamsize>(block.size()));
+		}
+	}
+
+	measureReads(path, { .backend = "io-uring", .queueDepth = 128 }, "io-uring 128");
+	measureReads(path, { .backend = "io-uring", .queueDepth = 32 }, "io-uring 32");
+	for (u32 threadCount : { 1u, 4u, 16u }) {
+		measureReads(path, { .backend = "threads", .threadCount = threadCount }, std::format("threads {}", threadCount));
+	}
+	fs::remove(path);
+}
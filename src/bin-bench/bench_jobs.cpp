@@ -0,0 +1,106 @@
+#include "bench.hpp"
+#include "lib-engine/job_system.hpp"
+#include "lib-engine/class_ids.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 ELEMENT_COUNT = 1 << 22;
+	constexpr int ITERATIONS_PER_ELEMENT = 32;
+
+	float work(u32 i) {
+		float x = static_cast<float>(i);
+		for (int k = 0; k != ITERATIONS_PER_ELEMENT; ++k) {
+			x = std::sqrt(x * 1.0001f + 1.f) + std::sin(x);
+		}
+		return x;
+	}
+
+	/*
+	* jobs that queue jobs of their own and wait for them, so workers pop, steal and help
+	* while waiting all at once. every inner job has to run exactly once
+	*/
+	bool runsNestedJobsOnce(jobs::JobSystem& jobSystem) {
+		constexpr u32 OUTER_COUNT = 64;
+		constexpr u32 INNER_COUNT = 1'024;
+
+		std::vector<std::atomic<u32>> runs(OUTER_COUNT * INNER_COUNT);
+		jobs::Counter counter;
+		for (u32 outer = 0; outer != OUTER_COUNT; ++outer) {
+			jobSystem.run([&, outer] {
+				jobs::Counter inner;
+				for (u32 i = 0; i != INNER_COUNT; ++i) {
+					jobSystem.run([&runs, index = outer * INNER_COUNT + i] {
+						runs[index].fetch_add(1, std::memory_order_relaxed);
+					}, &inner);
+				}
+				jobSystem.wait(inner);
+			}, &counter);
+		}
+		jobSystem.wait(counter);
+		return std::all_of(runs.begin(), runs.end(), [](const std::atomic<u32>& count) { return count.load() == 1; });
+	}
+}
+
+/*
+* parallelFor over a compute bound kernel, from one worker up to every hardware thread
+*/
+void qf::bench::runJobSystemBenchmark() {
+	std::vector<float> output(ELEMENT_COUNT);
+	const u32 maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<float> expected(ELEMENT_COUNT);
+	for (u32 i = 0; i != ELEMENT_COUNT; ++i) {
+		expected[i] = work(i);
+	}
+
+	double baseline = 0;
+	for (u32 workers = 1;; workers = std::min(workers * 2, maxWorkers)) {
+		auto jobSystem = createInstance<jobs::JobSystem>(WorkStealingJobSystemClassId);
+		if (auto res = jobSystem->initialize(workers); !res.has_value()) {
+			log::info("failed to start job system: {}", res.error().str());
+			return;
+		}
+
+		const double seconds = measureSeconds([&] {
+			jobSystem->parallelFor(0, ELEMENT_COUNT, 0, [&](u32 first, u32 last) {
+				for (u32 i = first; i != last; ++i) {
+					output[i] = work(i);
+				}
+			});
+		});
+
+		std::fill(output.begin(), output.end(), std::numeric_limits<float>::quiet_NaN());
+		jobSystem->parallelFor(0, ELEMENT_COUNT, 0, [&](u32 first, u32 last) {
+			for (u32 i = first; i != last; ++i) {
+				output[i] = work(i);
+			}
+		});
+		const bool covered = std::equal(output.begin(), output.end(), expected.begin(), [](float a, float b) {
+			return std::abs(a - b) <= 1e-4f * std::max(1.f, std::abs(b));
+		});
+		check(covered, std::format("parallelFor on {} workers writes every element", workers));
+		check(runsNestedJobsOnce(*jobSystem), std::format("nested jobs on {} workers each run once", workers));
+		jobSystem->shutdown();
+
+		if (workers == 1) {
+			baseline = seconds;
+		}
+		log::info("workers {:>3}: {:8.3f} ms  {:6.1f} Melem/s  speedup {:5.2f}x",
+			workers,
+			seconds * 1e3,
+			ELEMENT_COUNT / seconds * 1e-6,
+			baseline / seconds);
+
+		if (workers == maxWorkers) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,198 @@
+#include "bench.hpp"
+#include "lib-engine/log_decode.hpp"
+#include "lib-engine/mapped_file.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 BURST_SIZE = 1'000;
+	constexpr u32 BURST_COUNT = 200;
+
+	/*
+	* counts records instead of writing them, so only the logger itself is measured. the
+	* logger's own warnings about dropped messages aren't counted
+	*/
+	class CountingSink : public log::LogSink
+	{
+		std::atomic<u64>& count_;
+
+	public:
+		explicit CountingSink(std::atomic<u64>& count)
+			: count_(count) {}
+
+		virtual void write(std::span<const log::LogRecord> records) override {
+			const auto messages = std::count_if(records.begin(), records.end(), [](const log::LogRecord& record) {
+				return record.level == log::Level::Info;
+			});
+			count_.fetch_add(static_cast<u64>(messages), std::memory_order_relaxed);
+		}
+
+		virtual bool needsText() const override { return false; }
+	};
+
+	/*
+	* keeps the text the console would show, and each message on its own
+	*/
+	class TextSink : public log::LogSink
+	{
+		std::string& text_;
+		std::vector<std::string>& messages_;
+
+	public:
+		TextSink(std::string& text, std::vector<std::string>& messages)
+			: text_(text), messages_(messages) {}
+
+		virtual void write(std::span<const log::LogRecord> records) override {
+			for (auto const& record : records) {
+				formatRecord(text_, record);
+				messages_.emplace_back(record.message);
+			}
+		}
+	};
+
+	/*
+	* a type the logger can't encode, so messages with it are formatted by the caller
+	*/
+	struct Formatted {
+		double value;
+	};
+
+	/*
+	* nanoseconds per message on the calling thread, from threadCount threads logging at once
+	*/
+	template<typename F>
+	double measureLogging(u32 threadCount, F&& logOne) {
+		std::atomic<s64> nanoseconds{};
+		std::vector<std::thread> threads;
+		for (u32 t = 0; t != threadCount; ++t) {
+			threads.emplace_back([&, t] {
+				bench::Clock::duration elapsed{};
+				for (u32 burst = 0; burst != BURST_COUNT; ++burst) {
+					const auto start = bench::Clock::now();
+					for (u32 i = 0; i != BURST_SIZE; ++i) {
+						logOne(t, burst, i);
+					}
+					elapsed += bench::Clock::now() - start;
+					log::flush();
+				}
+				nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		return static_cast<double>(nanoseconds.load()) / (u64(threadCount) * BURST_COUNT * BURST_SIZE);
+	}
+}
+
+template<>
+struct std::formatter<Formatted> : std::formatter<double> {
+	auto format(const Formatted& f, std::format_context& ctx) const {
+		return std::formatter<double>::format(f.value, ctx);
+	}
+};
+
+namespace
+{
+	/*
+	* logs deferred and formatted messages to a binary log and as text at once. checks each
+	* message is what std::format makes of the original arguments, and that decoding the
+	* binary log, as bin-logdecode does, gives back the console text
+	*/
+	void checkBinaryLogRoundTrip() {
+		const std::string path = (std::filesystem::temp_directory_path() / "qf-bench-log.bin").string();
+		std::string expected;
+		std::vector<std::string> messages;
+		std::vector<std::string> formatted;
+		log::initialize(log::Settings{ .binaryFile = path, .console = false });
+		log::addSink(std::make_unique<TextSink>(expected, messages));
+
+		auto logBoth = [&]<typename... Args>(std::format_string<Args...> f, Args&&... args) {
+			formatted.push_back(std::vformat(f.get(), std::make_format_args(args...)));
+			log::info(f, std::forward<Args>(args)...);
+		};
+		const int local = 0;
+		logBoth("integers {} {} {:#x} {:+d} {:>6}", -5, 7u, 255, 3, u64(1) << 40);
+		logBoth("floats {:.3f} {:e} {} {:g}", 1.5f, 2.25, 0.1, 1e300);
+		logBoth("strings {} {:>8} {:.3} [{:^9}]", "literal", std::string("string"), std::string_view("view"), "mid");
+		logBoth("{} {} {:d} {:s}", true, 'x', 'A', false);
+		logBoth("pointers {} {}", static_cast<const void*>(&local), nullptr);
+		logBoth("positional {1} {0} {1}", "b", "a");
+		logBoth("dynamic width [{:{}}] precision {:.{}f}", 42, 6, 3.14159, 2);
+		logBoth("formatted {:.2f}", Formatted{ 0.5 });
+		logBoth("{} escaped {{}} braces", "and");
+		log::flush();
+		// closes the binary log
+		log::initialize(log::Settings{ .console = false });
+
+		bench::check(messages == formatted, "logged messages match std::format of their arguments");
+
+		std::string decoded;
+		if (auto file = MappedFile::open(path); bench::check(file.has_value(), "the binary log can be opened")) {
+			auto decoder = log::LogDecoder::open(file.value()->getData());
+			if (bench::check(decoder.has_value(), "the binary log has a header")) {
+				while (!decoder->isAtEnd() && decoder->decodeRecord(decoded).has_value()) {
+				}
+			}
+		}
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+
+		bench::check(!expected.empty() && decoded == expected, "the decoded binary log matches the console text");
+		if (decoded != expected) {
+			log::info("console:\n{}decoded:\n{}", expected, decoded);
+		}
+	}
+}
+
+/*
+* time spent in the calling thread per message, from one thread up to every hardware thread,
+* for messages whose formatting is deferred to the logger's thread and for messages formatted
+* by the caller. each thread logs bursts that fit its buffer and flushes between them
+*/
+void qf::bench::runLoggerBenchmark() {
+	checkBinaryLogRoundTrip();
+
+	std::atomic<u64> written{};
+	u64 logged = 0;
+	const u64 droppedBefore = log::getDroppedCount();
+	log::initialize(log::Settings{ .console = false });
+	log::addSink(std::make_unique<CountingSink>(written));
+
+	struct Result {
+		u32 threadCount;
+		double deferred;
+		double formatted;
+	};
+	std::vector<Result> results;
+	const u32 maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (u32 threadCount = 1;; threadCount = std::min(threadCount * 2, maxThreads)) {
+		const double deferred = measureLogging(threadCount, [](u32 t, u32 burst, u32 i) {
+			log::info("thread {} burst {} message {} value {:.3f}", t, burst, i, i * 0.5);
+		});
+		const double formatted = measureLogging(threadCount, [](u32 t, u32 burst, u32 i) {
+			log::info("thread {} burst {} message {} value {:.3f}", t, burst, i, Formatted{ i * 0.5 });
+		});
+		results.push_back(Result{ threadCount, deferred, formatted });
+		logged += 2 * u64(threadCount) * BURST_COUNT * BURST_SIZE;
+
+		if (threadCount == maxThreads) {
+			break;
+		}
+	}
+	const u64 dropped = log::getDroppedCount() - droppedBefore;
+	check(written.load() + dropped == logged, "every message logged is written or counted as dropped");
+
+	log::initialize(log::Settings::fromConfig());
+	for (auto const& result : results) {
+		log::info("threads {:>3}: deferred {:6.1f} ns, formatted {:6.1f} ns per message",
+			result.threadCount, result.deferred, result.formatted);
+	}
+	log::info("{} messages written, {} dropped", written.load(), dropped);
+}
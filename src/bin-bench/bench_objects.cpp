@@ -0,0 +1,50 @@
+#include "bench.hpp"
+
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 OBJECT_COUNT = 100'000;
+	constexpr int ROUNDS = 10;
+
+	class SmallObject : public Serializable {
+	public:
+		u32 value;
+
+		SmallObject(u32 value)
+			: value(value) {}
+	};
+
+	template<typename P, typename F>
+	void churn(const char* name, F&& create) {
+		std::vector<P> objects;
+		objects.reserve(OBJECT_COUNT);
+		u64 sum = 0;
+
+		const double seconds = bench::measureSeconds([&] {
+			for (int round = 0; round != ROUNDS; ++round) {
+				for (u32 i = 0; i != OBJECT_COUNT; ++i) {
+					objects.emplace_back(create(i));
+				}
+				for (auto const& obj : objects) {
+					sum += obj->value;
+				}
+				objects.clear();
+			}
+		});
+
+		const double perObject = seconds / (OBJECT_COUNT * ROUNDS) * 1e9;
+		log::info("{:<28} {:7.2f} ns per create+destroy ({})", name, perObject, sum != 0);
+	}
+}
+
+/*
+* creating and destroying many small engine objects through each ownership model
+*/
+void qf::bench::runObjectPoolBenchmark() {
+	churn<ptr<SmallObject>>("std::make_shared", [](u32 i) { return std::make_shared<SmallObject>(i); });
+	churn<ptr<SmallObject>>("makeShared (pooled)", [](u32 i) { return makeShared<SmallObject>(i); });
+	churn<Ref<SmallObject>>("makeRef (pooled, intrusive)", [](u32 i) { return makeRef<SmallObject>(i); });
+}
@@ -0,0 +1,70 @@
+#include "bench.hpp"
+#include "lib-engine/headless_platform_interface.hpp"
+#include "lib-engine/class_ids.hpp"
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 TICK_COUNT = 10'000'000;
+	constexpr std::chrono::microseconds TICK{ 100 };
+
+	/*
+	* a quit scheduled at 2 s of virtual time ends the run on exactly the tick that reaches it
+	*/
+	void checkScriptedQuit() {
+		auto platform = createInstance<HeadlessPlatformInterface>(HeadlessPlatformInterfaceClassId);
+		if (!bench::check(platform != nullptr, "the headless platform can be created")) {
+			return;
+		}
+		platform->setTickDuration(TICK);
+		platform->scheduleEvent({
+			.type = HeadlessPlatformInterface::Event::Type::Quit,
+			.time = std::chrono::seconds(2),
+		});
+
+		const u64 quitTick = std::chrono::seconds(2) / TICK;
+		bool runningUntilQuit = true;
+		for (u64 i = 1; i != quitTick; ++i) {
+			runningUntilQuit &= platform->update(0.f);
+		}
+		bench::check(runningUntilQuit && !platform->update(0.f), "the scheduled quit stops update() on its tick");
+	}
+}
+
+/*
+* cost of a headless platform update, the floor for a load test tick
+*/
+void qf::bench::runHeadlessPlatformBenchmark() {
+	auto platform = createInstance<HeadlessPlatformInterface>(HeadlessPlatformInterfaceClassId);
+	if (!platform) {
+		log::info("failed to create headless platform");
+		return;
+	}
+	platform->setTickDuration(TICK);
+	platform->scheduleEvent({
+		.type = HeadlessPlatformInterface::Event::Type::Resize,
+		.time = std::chrono::seconds(1),
+		.width = 1280,
+		.height = 720,
+	});
+
+	u64 ticks = 0;
+	const double seconds = measureSeconds([&] {
+		for (u32 i = 0; i != TICK_COUNT; ++i) {
+			platform->update(0.f);
+		}
+		ticks += TICK_COUNT;
+	});
+
+	const auto extents = platform->getWindowExtents();
+	check(extents && std::get<0>(*extents) == 1280 && std::get<1>(*extents) == 720, "the scheduled resize was delivered");
+	check(platform->getTickCount() == ticks && platform->getTime() == static_cast<s64>(ticks) * HeadlessPlatformInterface::Duration(TICK),
+		"virtual time advanced by a tick on every update");
+	checkScriptedQuit();
+
+	log::info("headless update: {:.2f} ns/tick, {:.1f} Mticks/s, virtual time {:.1f} s",
+		seconds / TICK_COUNT * 1e9,
+		TICK_COUNT / seconds * 1e-6,
+		std::chrono::duration<double>(platform->getTime()).count());
+}
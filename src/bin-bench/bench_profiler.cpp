@@ -0,0 +1,36 @@
+#include "bench.hpp"
+#include "lib-engine/profiler.hpp"
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 ZONE_COUNT = 100'000;
+	constexpr int RUNS = 5;
+}
+
+/*
+* cost of a profiler zone while recording is off and while it is on
+*/
+void qf::bench::runProfilerBenchmark() {
+	const bool wasEnabled = profiler::isEnabled();
+
+	auto zones = [] {
+		for (u32 i = 0; i != ZONE_COUNT; ++i) {
+			profiler::Zone zone("bench zone");
+		}
+	};
+
+	profiler::initialize(profiler::Settings{ .enabled = false });
+	const double disabledSeconds = measureSeconds(zones, RUNS);
+
+	// room for every zone of the warm up and the runs, so none are dropped
+	profiler::initialize(profiler::Settings{ .enabled = true, .bufferSize = size_t(ZONE_COUNT) * (RUNS + 2) * 32 });
+	const double enabledSeconds = measureSeconds(zones, RUNS);
+
+	profiler::initialize(profiler::Settings{ .enabled = wasEnabled });
+
+	log::info("zone, recording off {:6.2f} ns", disabledSeconds / ZONE_COUNT * 1e9);
+	log::info("zone, recording on  {:6.2f} ns{}", enabledSeconds / ZONE_COUNT * 1e9,
+		profiler::IS_COMPILED_IN ? "" : " (built without QF_PROFILER, nothing recorded)");
+}
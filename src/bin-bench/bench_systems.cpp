@@ -0,0 +1,166 @@
+#include "bench.hpp"
+#include "lib-engine/class_ids.hpp"
+#include "lib-engine/system_scheduler.hpp"
+
+#include <glm/vec3.hpp>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 ENTITY_COUNT = 1'000'000;
+	constexpr float DT = 1.0f / 60.0f;
+	constexpr float GRAVITY = 9.8f;
+	// positions further out than this are too coarse in float to follow the closed form
+	constexpr u32 SAMPLED_ENTITIES = 1'000;
+
+	struct Position {
+		glm::vec3 value;
+	};
+
+	struct Velocity {
+		glm::vec3 value;
+	};
+
+	struct Health {
+		float value;
+		float regen;
+	};
+
+	struct Bounds {
+		float radius;
+	};
+
+	struct Age {
+		float seconds;
+	};
+
+	Expected<void> addSystems(ecs::SystemScheduler& scheduler) {
+		TRY_EXPR_IGNORE_VALUE((scheduler.addSystem<Velocity>("gravity", [](const FrameInfo& info, Velocity& velocity) {
+			velocity.value.y -= GRAVITY * info.timeDelta;
+		})));
+		TRY_EXPR_IGNORE_VALUE((scheduler.addSystem<Position, const Velocity>("integrate", [](const FrameInfo& info, Position& position, const Velocity& velocity) {
+			position.value += velocity.value * info.timeDelta;
+		})));
+		TRY_EXPR_IGNORE_VALUE((scheduler.addSystem<const Position, Bounds>("bounds", [](const FrameInfo&, const Position& position, Bounds& bounds) {
+			bounds.radius = std::sqrt(position.value.x * position.value.x + position.value.z * position.value.z);
+		})));
+		// independent of the others, so runs alongside them
+		TRY_EXPR_IGNORE_VALUE((scheduler.addSystem<Health>("regen", [](const FrameInfo& info, Health& health) {
+			health.value = std::min(100.0f, health.value + std::exp(-health.regen) * info.timeDelta);
+		})));
+		TRY_EXPR_IGNORE_VALUE((scheduler.addSystem<Age>("age", [](const FrameInfo& info, Age& age) {
+			age.seconds += info.timeDelta;
+		})));
+		return scheduler.compile();
+	}
+
+	bool isNear(double value, double expected) {
+		return std::abs(value - expected) <= 1e-3 * std::max(1.0, std::abs(expected));
+	}
+
+	/*
+	* after n executes, with gravity applied before integrate each time, velocity.y is
+	* 1 - n g dt and position.y is p0 + n dt - g dt^2 n (n + 1) / 2. every entity ages by the
+	* same dt per execute, so one chunk job skipped or run twice shows as an age off from the rest
+	*/
+	void checkResults(const ecs::World& world, const std::vector<ecs::Entity>& entities, u64 executes) {
+		const double n = static_cast<double>(executes);
+		bool moved = true;
+		for (u32 i = 0; i < SAMPLED_ENTITIES && moved; i += 7) {
+			const auto* position = world.get<Position>(entities[i]);
+			const auto* velocity = world.get<Velocity>(entities[i]);
+			const double p0 = i;
+			moved = isNear(velocity->value.y, 1.0 - n * GRAVITY * DT)
+				&& isNear(velocity->value.x, 1.0)
+				&& isNear(position->value.x, p0 + n * DT)
+				&& isNear(position->value.y, p0 + n * DT - GRAVITY * DT * DT * n * (n + 1) / 2);
+		}
+		bench::check(moved, "gravity and integrate ran in order once per execute");
+
+		const float age = world.get<Age>(entities[0])->seconds;
+		const bool aged = isNear(age, n * DT) && std::all_of(entities.begin(), entities.end(), [&](ecs::Entity entity) {
+			return world.get<Age>(entity)->seconds == age;
+		});
+		bench::check(aged, "every chunk job ran once per execute");
+	}
+
+	/*
+	* every system saw every entity, and each of the chain started only once the system it
+	* depends on had finished
+	*/
+	void checkStats(const ecs::SystemScheduler::FrameStats& stats) {
+		const bool counted = std::all_of(stats.systems.begin(), stats.systems.end(), [](auto const& system) {
+			return system.entityCount == ENTITY_COUNT;
+		});
+		bench::check(counted, "every system ran over every entity");
+
+		auto find = [&](std::string_view name) {
+			return std::find_if(stats.systems.begin(), stats.systems.end(), [&](auto const& system) { return system.name == name; });
+		};
+		auto ordered = [&](std::string_view first, std::string_view second) {
+			auto a = find(first);
+			auto b = find(second);
+			// start and duration are rounded separately, allow for it
+			return a != stats.systems.end() && b != stats.systems.end() && a->startMs + a->durationMs <= b->startMs + 1e-6;
+		};
+		bench::check(ordered("gravity", "integrate") && ordered("integrate", "bounds"), "conflicting systems don't overlap");
+	}
+}
+
+/*
+* five systems over 1M entities, from one worker up to every hardware thread. gravity,
+* integrate and bounds form a chain, regen and age run next to it, and every system is
+* split into chunk jobs
+*/
+void qf::bench::runSystemSchedulerBenchmark() {
+	ecs::World world;
+	std::vector<ecs::Entity> entities;
+	entities.reserve(ENTITY_COUNT);
+	for (u32 i = 0; i != ENTITY_COUNT; ++i) {
+		const float f = static_cast<float>(i);
+		entities.push_back(world.create(Position{ glm::vec3(f) }, Velocity{ glm::vec3(1.0f) }, Bounds{}, Health{ 50.0f, f * 1e-6f }, Age{}));
+	}
+
+	ecs::SystemScheduler scheduler;
+	if (auto res = addSystems(scheduler); !res.has_value()) {
+		log::info("failed to add systems: {}", res.error().str());
+		return;
+	}
+	const FrameInfo info{ .frameIndex = 0, .timeDelta = DT, .fixedSteps = 1, .fixedTimeDelta = DT, .interpolationAlpha = 0 };
+
+	const u32 maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+	double baseline = 0;
+	u64 executes = 0;
+	for (u32 workers = 1;; workers = std::min(workers * 2, maxWorkers)) {
+		auto jobSystem = createInstance<jobs::JobSystem>(WorkStealingJobSystemClassId);
+		if (auto res = jobSystem->initialize(workers); !res.has_value()) {
+			log::info("failed to start job system: {}", res.error().str());
+			return;
+		}
+		bool executed = true;
+		const double seconds = measureSeconds([&] {
+			executed &= scheduler.execute(*jobSystem, world, info).has_value();
+			++executes;
+		});
+		jobSystem->shutdown();
+
+		check(executed, std::format("execute on {} workers succeeds", workers));
+		checkStats(scheduler.getLastFrameStats());
+
+		if (workers == 1) {
+			baseline = seconds;
+		}
+		log::info("workers {:>3}: {:7.3f} ms  speedup {:5.2f}x  parallelism {:5.2f}",
+			workers, seconds * 1e3, baseline / seconds, scheduler.getLastFrameStats().parallelism);
+		if (workers == maxWorkers) {
+			log::info("{}", scheduler.getLastFrameStats());
+			break;
+		}
+	}
+	checkResults(world, entities, executes);
+}
@@ -0,0 +1,141 @@
+#include "bench.hpp"
+#include "lib-engine/flat_hash_map.hpp"
+
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace qf;
+
+namespace
+{
+	constexpr u32 KEY_COUNT = 1'000'000;
+
+	/*
+	* ids that only differ in a few fields, like ones handed out by a counter, next to
+	* fully random ones
+	*/
+	std::vector<UUID> makeKeys(bool structured, u64 seed) {
+		std::mt19937_64 rng(seed);
+		std::vector<UUID> keys(KEY_COUNT);
+		for (u32 i = 0; i != KEY_COUNT; ++i) {
+			if (structured) {
+				keys[i] = UUID("4f0c2d7e-0000-0000-8d25-1c7f60e9a3b2");
+				keys[i].p0 ^= static_cast<u32>(seed);
+				keys[i].p1 = static_cast<u16>(i);
+				keys[i].p2 = static_cast<u16>(i >> 16);
+			}
+			else {
+				const u64 a = rng();
+				const u64 b = rng();
+				keys[i] = std::bit_cast<UUID>(std::array<u64, 2>{ a, b });
+			}
+		}
+		return keys;
+	}
+
+	template<typename Map>
+	void run(const char* name, const char* keyKind, const std::vector<UUID>& keys, const std::vector<UUID>& misses) {
+		u64 found = 0;
+
+		const double insertSeconds = bench::measureSeconds([&] {
+			Map map;
+			for (u32 i = 0; i != KEY_COUNT; ++i) {
+				map.emplace(keys[i], i);
+			}
+			found += map.size();
+		}, 3);
+
+		Map map;
+		for (u32 i = 0; i != KEY_COUNT; ++i) {
+			map.emplace(keys[i], i);
+		}
+
+		bool correct = map.size() == KEY_COUNT;
+		for (u32 i = 0; i != KEY_COUNT && correct; ++i) {
+			auto it = map.find(keys[i]);
+			correct = it != map.end() && it->second == i && map.find(misses[i]) == map.end();
+		}
+		bench::check(correct, std::format("{} {} finds what was inserted", name, keyKind));
+
+		const double hitSeconds = bench::measureSeconds([&] {
+			for (auto const& key : keys) {
+				found += map.find(key)->second;
+			}
+		});
+
+		const double missSeconds = bench::measureSeconds([&] {
+			for (auto const& key : misses) {
+				found += map.find(key) == map.end();
+			}
+		});
+
+		log::info("{:<20} {:<10} insert {:6.1f} ns, hit {:6.1f} ns, miss {:6.1f} ns ({})",
+			name, keyKind,
+			insertSeconds / KEY_COUNT * 1e9,
+			hitSeconds / KEY_COUNT * 1e9,
+			missSeconds / KEY_COUNT * 1e9,
+			found != 0);
+	}
+
+	/*
+	* rounds of inserts and erases mirrored into std::unordered_map. the map grows, refills
+	* deleted slots and rehashes in place as it goes, and has to agree with the reference after
+	* every round
+	*/
+	void checkInsertEraseCycles(const std::vector<UUID>& keys) {
+		constexpr u32 ROUNDS = 64;
+		constexpr u32 OPS_PER_ROUND = 20'000;
+		constexpr u32 KEY_RANGE = 50'000;
+
+		std::mt19937_64 rng(3);
+		UUIDMap<u32> map;
+		std::unordered_map<UUID, u32> reference;
+		bool agrees = true;
+		for (u32 round = 0; round != ROUNDS && agrees; ++round) {
+			// alternate between mostly inserting and mostly erasing
+			const u32 insertPercent = round % 4 < 2 ? 75 : 25;
+			for (u32 op = 0; op != OPS_PER_ROUND; ++op) {
+				const UUID& key = keys[rng() % KEY_RANGE];
+				if (rng() % 100 < insertPercent) {
+					const u32 value = static_cast<u32>(rng());
+					const bool inserted = map.emplace(key, value).second;
+					agrees &= inserted == reference.emplace(key, value).second;
+				}
+				else {
+					agrees &= map.erase(key) == reference.erase(key);
+				}
+			}
+			if (round % 8 == 7) {
+				map.reserve(map.size() * 2);
+			}
+
+			agrees &= map.size() == reference.size();
+			size_t visited = 0;
+			for (auto const& [key, value] : map) {
+				auto it = reference.find(key);
+				agrees &= it != reference.end() && it->second == value;
+				++visited;
+			}
+			agrees &= visited == reference.size();
+			for (u32 i = 0; i != KEY_RANGE; ++i) {
+				agrees &= map.contains(keys[i]) == reference.contains(keys[i]);
+			}
+		}
+		bench::check(agrees, "UUIDMap agrees with std::unordered_map through insert and erase cycles");
+	}
+}
+
+/*
+* inserting and looking up a million UUID keys
+*/
+void qf::bench::runUUIDMapBenchmark() {
+	for (bool structured : { false, true }) {
+		const char* keyKind = structured ? "structured" : "random";
+		const auto keys = makeKeys(structured, 1);
+		const auto misses = makeKeys(structured, 2);
+		checkInsertEraseCycles(keys);
+		run<std::unordered_map<UUID, u32>>("std::unordered_map", keyKind, keys, misses);
+		run<UUIDMap<u32>>("UUIDMap", keyKind, keys, misses);
+	}
+}
@@ -0,0 +1,86 @@
+#include "bench.hpp"
+#include "lib-engine/vfs.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <vector>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	constexpr u32 FILE_COUNT = 10'000;
+	constexpr u32 FILES_PER_DIRECTORY = 100;
+	constexpr u32 LOOKUPS = 200'000;
+	constexpr u32 OPENS = 20'000;
+
+	std::string getFileName(u32 i) {
+		return std::format("textures/set-{}/texture-{}.dds", i / FILES_PER_DIRECTORY, i);
+	}
+}
+
+/*
+* finding and opening files through the vfs index against asking the file system each time.
+* the files are tiny, where mapping one costs more than reading it. mapping wins on larger
+* files, which are never copied and only paged in where they are read
+*/
+void qf::bench::runVfsBenchmark() {
+	const fs::path root = fs::temp_directory_path() / "qf-bench-vfs";
+	fs::remove_all(root);
+	std::vector<std::string> names;
+	for (u32 i = 0; i != FILE_COUNT; ++i) {
+		names.push_back(getFileName(i));
+		fs::create_directories((root / names.back()).parent_path());
+		std::ofstream(root / names.back(), std::ios::binary) << names.back();
+	}
+
+	vfs::MountId mount = 0;
+	const double mountSeconds = bench::measureSeconds([&] {
+		vfs::unmount(mount);
+		mount = vfs::mountDirectory(root, 100).value();
+	}, 3);
+	log::info("mount {} files: {:.2f} ms", FILE_COUNT, mountSeconds * 1e3);
+
+	bool intact = true;
+	for (u32 i = 0; i != FILE_COUNT && intact; ++i) {
+		auto file = vfs::open(names[i]);
+		intact = file.has_value() && std::ranges::equal(file->getData(), std::as_bytes(std::span(names[i])));
+	}
+	bench::check(intact && !vfs::exists("textures/set-0/missing.dds"), "the vfs finds every file with its contents");
+
+	size_t found = 0;
+	const double vfsExists = bench::measureSeconds([&] {
+		for (u32 i = 0; i != LOOKUPS; ++i) {
+			found += vfs::exists(names[(i * 7919u) % FILE_COUNT]);
+		}
+	});
+	const double statExists = bench::measureSeconds([&] {
+		for (u32 i = 0; i != LOOKUPS; ++i) {
+			found += fs::exists(root / names[(i * 7919u) % FILE_COUNT]);
+		}
+	});
+	log::info("exists: vfs {:6.1f} ns, stat {:6.1f} ns", vfsExists / LOOKUPS * 1e9, statExists / LOOKUPS * 1e9);
+
+	size_t bytes = 0;
+	const double vfsOpen = bench::measureSeconds([&] {
+		for (u32 i = 0; i != OPENS; ++i) {
+			bytes += vfs::open(names[(i * 7919u) % FILE_COUNT]).value().getSize();
+		}
+	});
+	const double streamOpen = bench::measureSeconds([&] {
+		std::string text;
+		for (u32 i = 0; i != OPENS; ++i) {
+			std::ifstream in(root / names[(i * 7919u) % FILE_COUNT], std::ios::binary);
+			text.assign(std::istreambuf_iterator<char>(in), {});
+			bytes += text.size();
+		}
+	});
+	log::info("open and read: vfs {:6.2f} us, ifstream {:6.2f} us ({} {})", vfsOpen / OPENS * 1e6, streamOpen / OPENS * 1e6,
+		found != 0, bytes != 0);
+
+	vfs::unmount(mount);
+	fs::remove_all(root);
+}
@@ -0,0 +1,70 @@
+#include "bench.hpp"
+#include "lib-engine/application_context.hpp"
+
+#include <string_view>
+
+using namespace qf;
+
+namespace
+{
+	struct Benchmark {
+		std::string_view name;
+		void (*fn)();
+	};
+
+	constexpr Benchmark benchmarks[] = {
+		{ "jobs", bench::runJobSystemBenchmark },
+		{ "headless", bench::runHeadlessPlatformBenchmark },
+		{ "objects", bench::runObjectPoolBenchmark },
+		{ "uuid-map", bench::runUUIDMapBenchmark },
+		{ "config", bench::runConfigBenchmark },
+		{ "logger", bench::runLoggerBenchmark },
+		{ "profiler", bench::runProfilerBenchmark },
+		{ "archive", bench::runArchiveBenchmark },
+		{ "pack", bench::runAssetPackBenchmark },
+		{ "io", bench::runIoBenchmark },
+		{ "compression", bench::runCompressionBenchmark },
+		{ "cache", bench::runAssetCacheBenchmark },
+		{ "vfs", bench::runVfsBenchmark },
+		{ "ecs", bench::runEcsBenchmark },
+		{ "systems", bench::runSystemSchedulerBenchmark },
+		{ "batch", bench::runBatchMathBenchmark },
+	};
+
+	u32 failedChecks = 0;
+}
+
+bool qf::bench::check(bool ok, std::string_view what) {
+	if (!ok) {
+		log::error("check failed: {}", what);
+		++failedChecks;
+	}
+	return ok;
+}
+
+/*
+* usage: bin-bench [name...]
+* runs the named benchmarks, or all of them when no name is given
+*/
+int main(int argc, char** argv) {
+
+	qf::registerFactories();
+
+	auto appContext = qf::internalCreateInstance<qf::ApplicationContext>();
+
+	for (auto const& benchmark : benchmarks) {
+		bool selected = argc < 2;
+		for (int i = 1; i < argc; ++i) {
+			selected |= benchmark.name == argv[i];
+		}
+		if (selected) {
+			log::info("--- {}", benchmark.name);
+			benchmark.fn();
+		}
+	}
+	if (failedChecks != 0) {
+		log::error("{} checks failed", failedChecks);
+		return 1;
+	}
+	return 0;
+}
@@ -3,13 +3,24 @@
 #include "lib-engine/platform_interface.hpp"
 #include "lib-engine/class_ids.hpp"
 #include "lib-engine/graphics.hpp"
+#include "lib-engine/job_system.hpp"
+#include "lib-engine/io_system.hpp"
+#include "lib-engine/asset_cache.hpp"
+#include "lib-engine/frame_graph.hpp"
+#include "lib-engine/system_scheduler.hpp"
+#include "lib-engine/startup_graph.hpp"
+#include "lib-engine/frame_pacer.hpp"
+#include "lib-engine/frame_arena.hpp"
 #include "lib-engine/logger.hpp"
+#include "lib-engine/profiler.hpp"
+#include "lib-engine/vfs.hpp"
 
 #include <SDL.h>
 
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 glm::vec3 val{};
 
@@ -25,28 +36,213 @@ namespace qf::vulk {
 using namespace qf;
 
 int main() {
+    const auto processStart = std::chrono::steady_clock::now();
 
     log::info("hello");
+    QF_PROFILE_THREAD_NAME("main");
 
     qf::registerFactories();
 
+    // every other step reads the config, so it is loaded before any of them start
     auto appContext = qf::internalCreateInstance<qf::ApplicationContext>();
-    //e80::IApplicationContext::SetApplicationContext(appContext);
 
-    //auto platform = std::make_shared<e80::Sdl2PlatformInterfaceClass>();
+    log::initialize(log::Settings::fromConfig());
 
-    auto platform = createInstance<PlatformInterface>(qf::Sdl2PlatformInterfaceClassId);
-    if (auto initRes = platform->initialize(); !initRes.has_value()) {
-        std::cerr << initRes.error() << std::endl;
+    // startup so far was recorded regardless of the settings, it is only written out when they enable the profiler
+    const auto profilerSettings = profiler::Settings::fromConfig();
+    profiler::initialize(profilerSettings);
+
+    FrameArena::initialize(FrameArena::Settings::fromConfig());
+
+    // the config itself was read from the working directory, the vfs mounts it on first use
+    if (auto res = vfs::initialize(vfs::Settings::fromConfig()); !res.has_value()) {
+        std::cerr << res.error().str() << std::endl;
+        return 1;
     }
 
-    auto graphics = Graphics::createInstance<vulk::VulkanGraphics>(Graphics::CreateInstanceInfo{
-            .pi = platform,
-            .appName = "QuantaForge"
+    const bool headless = IApplicationContext::current().getConfig()->getBool("platform.run-headless").value_or(false);
+
+    auto jobSystem = createInstance<jobs::JobSystem, qf::WorkStealingJobSystemClassId>();
+    if (!jobSystem) {
+        std::cerr << "failed to create job system" << std::endl;
+        return 1;
+    }
+    auto ioSystem = createInstance<io::IoSystem, qf::AsyncIoSystemClassId>();
+    if (!ioSystem) {
+        std::cerr << "failed to create io system" << std::endl;
+        return 1;
+    }
+    auto assetCache = makeShared<AssetCache>(AssetCache::Settings::fromConfig());
+    auto platform = createInstance<PlatformInterface>(headless ? qf::HeadlessPlatformInterfaceClassId : qf::Sdl2PlatformInterfaceClassId);
+    if (!platform) {
+        std::cerr << "failed to create platform" << std::endl;
+        return 1;
+    }
+
+    // there is no window to present to when running headless
+    ptr<Graphics> graphics;
+    if (!headless) {
+        graphics = Graphics::createInstance<vulk::VulkanGraphics>(Graphics::CreateInstanceInfo{
+                .pi = platform,
+                .appName = "QuantaForge"
+            });
+    }
+
+    // the vulkan instance doesn't need the window, so it is created while the platform starts up
+    std::vector<StartupGraph::StepDesc> steps;
+    steps.push_back({
+        .name = "jobs",
+        .fn = [&] { return jobSystem->initialize(); },
+        // the thread that starts the job system takes part in running jobs
+        .mainThread = true,
+    });
+    steps.push_back({
+        .name = "io",
+        .fn = [&] { return ioSystem->initialize(); },
+    });
+    steps.push_back({
+        .name = "platform",
+        .fn = [&]() -> Expected<void> {
+            if (auto res = platform->initialize(); !res.has_value()) {
+                return std::unexpected(res.error());
+            }
+            return {};
+        },
+        .mainThread = true,
+    });
+    if (graphics) {
+        steps.push_back({
+            .name = "graphics instance",
+            .fn = [&] { return graphics->initializeInstance(); },
         });
+        steps.push_back({
+            .name = "graphics surface",
+            .after = { "platform", "graphics instance" },
+            .fn = [&] { return graphics->initializeSurface(); },
+        });
+    }
+    StartupGraph startup;
+    for (auto& step : steps) {
+        if (auto res = startup.addStep(std::move(step)); !res.has_value()) {
+            std::cerr << res.error().str() << std::endl;
+            return 1;
+        }
+    }
+    if (auto res = startup.run(); !res.has_value()) {
+        std::cerr << res.error().str() << std::endl;
+        return 1;
+    }
+    log::info("{}", startup.getStats());
+
+    IApplicationContext::current().registerService(jobSystem);
+    IApplicationContext::current().registerService(ioSystem);
+    IApplicationContext::current().registerService(assetCache);
+    IApplicationContext::current().registerService(platform);
+    if (graphics) {
+        IApplicationContext::current().registerService(graphics);
+    }
 
-    graphics->initialize();
+    bool running = true;
 
+    ecs::World world;
+    ecs::SystemScheduler systems;
+    // gameplay systems are added here
+    if (auto res = systems.compile(); !res.has_value()) {
+        std::cerr << res.error().str() << std::endl;
+        return 1;
+    }
+
+    std::vector<FrameGraph::StageDesc> stages;
+    stages.push_back({
+        .name = "platform",
+        .writes = { "platform.events" },
+        .fn = [&](const FrameInfo& info) { running = platform->update(info.timeDelta); },
+        .mainThread = true,
+    });
+    stages.push_back({
+        .name = "simulation",
+        .reads = { "platform.events" },
+        .writes = { "world" },
+        .fn = [&](const FrameInfo& info) {
+            FrameInfo stepInfo = info;
+            stepInfo.timeDelta = info.fixedTimeDelta;
+            for (u32 step = 0; step != info.fixedSteps; ++step) {
+                if (auto res = systems.execute(getService<jobs::JobSystem>(), world, stepInfo); !res.has_value()) {
+                    log::error("{}", res.error().str());
+                }
+            }
+        },
+    });
+    stages.push_back({
+        .name = "render",
+        .reads = { "world" },
+        .writes = { "render.commands" },
+        .fn = [](const FrameInfo&) {},
+    });
+    FrameGraph frameGraph;
+    for (auto& stage : stages) {
+        if (auto res = frameGraph.addStage(std::move(stage)); !res.has_value()) {
+            std::cerr << res.error().str() << std::endl;
+            return 1;
+        }
+    }
+    if (auto res = frameGraph.compile(); !res.has_value()) {
+        std::cerr << res.error().str() << std::endl;
+        return 1;
+    }
+
+    constexpr u64 STATS_INTERVAL = 600;
+    FramePacer pacer(FramePacer::Settings::fromConfig());
+    IApplicationContext::current().subscribeConfig("frame", [&](const ConfigIndex&) {
+        pacer.setSettings(FramePacer::Settings::fromConfig());
+    });
+    for (u64 frameIndex = 0; running; ++frameIndex) {
+        QF_PROFILE_FRAME(frameIndex);
+        FrameArena::beginFrame(frameIndex);
+        const auto timing = pacer.beginFrame();
+        QF_PROFILE_COUNTER("frame time ms", timing.timeDelta * 1e3);
+        const FrameInfo info{
+            .frameIndex = frameIndex,
+            .timeDelta = timing.timeDelta,
+            .fixedSteps = timing.fixedSteps,
+            .fixedTimeDelta = timing.fixedTimeDelta,
+            .interpolationAlpha = timing.interpolationAlpha,
+        };
+
+        if (auto res = frameGraph.execute(getService<jobs::JobSystem>(), info); !res.has_value()) {
+            std::cerr << res.error().str() << std::endl;
+            break;
+        }
+        if (frameIndex == 0) {
+            log::info("time to first frame {:.3f} ms",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count());
+        }
+        if (frameIndex % STATS_INTERVAL == 0) {
+            log::info("{}", frameGraph.getLastFrameStats());
+            log::info("{}", systems.getLastFrameStats());
+            log::info("{}", FrameArena::getLastFrameStats());
+        }
+
+        QF_PROFILE_COUNTER("frame arena bytes", static_cast<double>(FrameArena::getLastFrameStats().arenaBytes));
+
+        {
+            QF_PROFILE_ZONE("config update");
+            IApplicationContext::current().update();
+        }
+        {
+            QF_PROFILE_ZONE("wait for next frame");
+            pacer.waitForNextFrame(&getService<PlatformInterface>());
+        }
+    }
+
+    if (profiler::isEnabled()) {
+        if (auto res = profiler::writeTrace(profilerSettings.output); !res.has_value()) {
+            log::error("{}", res.error().str());
+        }
+        else {
+            log::info("profiler trace written to {}", profilerSettings.output);
+        }
+    }
 
     std::cout << std::format("{}", val);
     return 0;
@@ -0,0 +1,63 @@
+#include "lib-engine/engine80.hpp"
+#include "lib-engine/log_decode.hpp"
+#include "lib-engine/mapped_file.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+using namespace qf;
+
+/*
+* usage: bin-logdecode <log file> [output file]
+* turns a log written by BinaryFileSink back into text, the same text the console shows.
+* writes to stdout when no output file is given
+*/
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "usage: bin-logdecode <log file> [output file]" << std::endl;
+		return 1;
+	}
+
+	auto file = MappedFile::open(argv[1]);
+	if (!file.has_value()) {
+		std::cerr << file.error().str() << std::endl;
+		return 1;
+	}
+
+	auto decoder = log::LogDecoder::open(file.value()->getData());
+	if (!decoder.has_value()) {
+		std::cerr << std::format("{}: {}", argv[1], decoder.error().str()) << std::endl;
+		return 1;
+	}
+
+	std::FILE* out = argc > 2 ? std::fopen(argv[2], "wb") : stdout;
+	if (!out) {
+		std::cerr << "can't open " << argv[2] << std::endl;
+		return 1;
+	}
+
+	const std::chrono::sys_time<std::chrono::nanoseconds> startTime{ std::chrono::nanoseconds(decoder->getStartTime()) };
+	std::string text = std::format("log started {:%F %T} UTC\n", startTime);
+
+	constexpr size_t FLUSH_SIZE = 1 << 20;
+	int result = 0;
+	while (!decoder->isAtEnd()) {
+		if (auto res = decoder->decodeRecord(text); !res.has_value()) {
+			// a log cut short by a crash still decodes up to the damage
+			std::cerr << std::format("{}: {}", argv[1], res.error().str()) << std::endl;
+			result = 1;
+			break;
+		}
+		if (text.size() >= FLUSH_SIZE) {
+			std::fwrite(text.data(), 1, text.size(), out);
+			text.clear();
+		}
+	}
+	std::fwrite(text.data(), 1, text.size(), out);
+
+	if (out != stdout) {
+		std::fclose(out);
+	}
+	return result;
+}
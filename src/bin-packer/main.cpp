@@ -0,0 +1,122 @@
+#include "lib-engine/engine80.hpp"
+#include "lib-engine/asset_pack.hpp"
+#include "lib-engine/compression.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace qf;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	Expected<std::vector<std::byte>> readFile(const fs::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		std::error_code ec;
+		const auto size = fs::file_size(path, ec);
+		if (!in || ec) {
+			return std::unexpected(std::format("can't read {}", path.string()));
+		}
+		std::vector<std::byte> data(size);
+		in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+		if (!in) {
+			return std::unexpected(std::format("can't read {}", path.string()));
+		}
+		return data;
+	}
+
+	/*
+	* adds every file under dir, named by its path relative to dir
+	*/
+	Expected<void> addDirectory(AssetPackBuilder& builder, const fs::path& dir, Codec codec) {
+		std::vector<fs::path> files;
+		std::error_code ec;
+		for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+			if (it->is_regular_file()) {
+				files.push_back(it->path());
+			}
+		}
+		if (ec) {
+			return std::unexpected(std::format("can't list {}", dir.string()));
+		}
+		// sorted so the same files always make the same pack
+		std::sort(files.begin(), files.end());
+
+		for (auto const& file : files) {
+			const std::string name = file.lexically_relative(dir).generic_string();
+			auto data = readFile(file);
+			if (!data.has_value()) {
+				return std::unexpected(data.error());
+			}
+			if (codec != Codec::None) {
+				auto compressed = compress(data.value(), { .codec = codec });
+				if (!compressed.has_value()) {
+					return std::unexpected(std::format("can't compress {}: {}", name, compressed.error().str()));
+				}
+				data.value() = std::move(compressed.value());
+			}
+			TRY_EXPR_IGNORE_VALUE(builder.add(makeAssetId(name), name, std::move(data.value())));
+		}
+		return {};
+	}
+
+	int list(const fs::path& path) {
+		auto pack = AssetPack::open(path);
+		if (!pack.has_value()) {
+			std::cerr << pack.error().str() << std::endl;
+			return 1;
+		}
+		std::cout << std::format("{}: {} assets\n", path.string(), pack.value()->getAssetCount());
+		pack.value()->forEach([&](const UUID& id) {
+			std::cout << std::format("  {:016x}{:016x} {:>12} {}\n", id.high(), id.low(),
+				pack.value()->find(id).value_or(std::span<const std::byte>()).size(), pack.value()->getName(id));
+		});
+		return 0;
+	}
+}
+
+/*
+* usage: bin-packer [--codec lz4|zstd] <pack> <directory>...
+*        bin-packer --list <pack>
+* packs every file under the directories into one asset pack. an asset's id is made from
+* its path relative to its directory, see makeAssetId(). with --codec every asset is stored
+* as a compressed block, see CompressedBlock. --list prints what a pack holds
+*/
+int main(int argc, char** argv) {
+	if (argc == 3 && std::string_view(argv[1]) == "--list") {
+		return list(argv[2]);
+	}
+
+	Codec codec = Codec::None;
+	int first = 1;
+	if (argc > 2 && std::string_view(argv[1]) == "--codec") {
+		const std::string_view name = argv[2];
+		codec = name == "lz4" ? Codec::Lz4 : name == "zstd" ? Codec::Zstd : Codec::None;
+		if (codec == Codec::None) {
+			std::cerr << std::format("unknown codec {}, expected lz4 or zstd", name) << std::endl;
+			return 1;
+		}
+		first = 3;
+	}
+	if (argc - first < 2) {
+		std::cerr << "usage: bin-packer [--codec lz4|zstd] <pack> <directory>...\n       bin-packer --list <pack>" << std::endl;
+		return 1;
+	}
+
+	AssetPackBuilder builder;
+	for (int i = first + 1; i < argc; ++i) {
+		if (auto res = addDirectory(builder, argv[i], codec); !res.has_value()) {
+			std::cerr << res.error().str() << std::endl;
+			return 1;
+		}
+	}
+	if (auto res = builder.write(argv[first]); !res.has_value()) {
+		std::cerr << res.error().str() << std::endl;
+		return 1;
+	}
+	std::cout << std::format("packed {} assets into {}", builder.getAssetCount(), argv[first]) << std::endl;
+	return 0;
+}
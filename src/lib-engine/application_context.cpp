@@ -1,8 +1,11 @@
 #include "application_context.hpp"
+#include "config_watcher.hpp"
+#include "logger.hpp"
+#include "profiler.hpp"
+#include "vfs.hpp"
+#include <atomic>
 #include <unordered_map>
-#include <yaml-cpp/yaml.h>
-#include <fstream>
-#include <functional>
+#include <mutex>
 
 namespace fs = std::filesystem;
 namespace qf
@@ -11,7 +14,26 @@ namespace qf
 }
 
 namespace {
+	static constexpr std::string_view CONFIG_FILE_NAME{ "config.yaml" };
+	static constexpr std::string_view CONFIG_CACHE_FILE_NAME{ "config.cache" };
+	static constexpr std::string_view HOT_RELOAD_PROP_NAME{ "config.hot-reload" };
+
 	qf::ptr<qf::ApplicationContext> globalContext_;
+
+	/*
+	* the cache is written next to the config.yaml the vfs found. a config from a pack has no
+	* directory of its own, its cache goes in the working directory
+	*/
+	qf::Expected<qf::ConfigIndex> loadConfig() {
+		QF_PROFILE_ZONE("loadConfig");
+		auto file = qf::vfs::open(CONFIG_FILE_NAME);
+		if (!file.has_value()) {
+			return std::unexpected(file.error());
+		}
+		const auto path = qf::vfs::getNativePath(CONFIG_FILE_NAME);
+		const fs::path cachePath = path ? path->parent_path() / CONFIG_CACHE_FILE_NAME : fs::path(CONFIG_CACHE_FILE_NAME);
+		return qf::ConfigIndex::loadSource(file->getText(), cachePath);
+	}
 }
 
 namespace qf {
@@ -19,7 +41,57 @@ namespace qf {
 		: public IApplicationContext
 	{
 		std::unordered_map<std::string, ptr<Serializable>> serviceMap_{};
-		YAML::Node config_{};
+
+		/*
+		* the published snapshot, read without a lock. the snapshot it replaced is kept in
+		* retired_ until the next publish, so a reader that loaded the old pointer just before
+		* a reload still has a frame to finish with it
+		*/
+		std::atomic<const ConfigIndex*> config_{};
+		static_assert(std::atomic<const ConfigIndex*>::is_always_lock_free);
+
+		mutable std::mutex snapshotMutex_{};
+		ptr<const ConfigIndex> snapshot_{};
+		ptr<const ConfigIndex> retired_{};
+
+		/*
+		* parsed on the watcher thread, waiting for update() to publish it
+		*/
+		std::mutex pendingMutex_{};
+		Box<ConfigIndex> pending_{};
+
+		struct Subscription {
+			u32 id;
+			std::string subtree;
+			ConfigCallback callback;
+		};
+
+		std::mutex subscriptionMutex_{};
+		std::vector<Subscription> subscriptions_{};
+		u32 nextSubscriptionId_ = 1;
+
+		/*
+		* declared last so its thread is stopped before anything it touches is destroyed
+		*/
+		Box<ConfigWatcher> watcher_{};
+
+		void publish(ptr<const ConfigIndex>&& config) {
+			// declared before the lock, so the oldest snapshot is freed after it is released
+			ptr<const ConfigIndex> released;
+			std::lock_guard lock(snapshotMutex_);
+			released = std::exchange(retired_, std::exchange(snapshot_, std::move(config)));
+			config_.store(snapshot_.get(), std::memory_order_release);
+		}
+
+		void onConfigFileChanged() {
+			auto index = loadConfig();
+			if (!index.has_value()) {
+				log::info("config not reloaded, {}", index.error().str());
+				return;
+			}
+			std::lock_guard lock(pendingMutex_);
+			pending_ = makeBox<ConfigIndex>(std::move(index.value()));
+		}
 
 		virtual Result RegisterService(std::shared_ptr<Serializable>&& obj, std::string&& contextName) override {
 			auto [it, inserted] = serviceMap_.emplace(contextName, std::move(obj));
@@ -44,59 +116,94 @@ namespace qf {
 			return it->second;
 		}
 	public:
+		ApplicationContext() {
+			publish(std::make_shared<const ConfigIndex>());
+		}
+
 		virtual std::expected<void, std::string> postConstruct() override
 		{
 			globalContext_ = this->sharedFromThis<ApplicationContext>();
+			current_ = this;
+
+			auto index = loadConfig();
+			if (!index.has_value()) {
+				return std::unexpected(index.error().str());
+			}
+			publish(std::make_shared<const ConfigIndex>(std::move(index.value())));
 
-			try {
-				config_ = YAML::LoadFile("config.yaml");
+			if (!getConfig()->getBool(HOT_RELOAD_PROP_NAME).value_or(false)) {
+				return {};
 			}
-			catch (...) {
-				return std::unexpected("failed to load config");
+			// a config mounted from a pack can't change
+			if (auto path = vfs::getNativePath(CONFIG_FILE_NAME)) {
+				watcher_ = makeBox<ConfigWatcher>(*path, [this] { onConfigFileChanged(); });
+				if (auto res = watcher_->start(); !res.has_value()) {
+					log::info("config hot reload disabled, {}", res.error().str());
+				}
+			}
+			else {
+				log::info("config hot reload disabled, {} isn't in a mounted directory", CONFIG_FILE_NAME);
 			}
 			return {};
 		}
 
-		virtual std::optional<bool> getPropertyAsBool(const std::string_view& name) const override
+		virtual const ConfigIndex* getConfig() const override
 		{
-			auto node = getProperty(name);
-			if (node.has_value())
-				return node.value().as<bool>();
-			return std::nullopt;
+			return config_.load(std::memory_order_acquire);
 		}
 
-		virtual std::optional<YAML::Node> getProperty(const std::string_view& name) const override
+		virtual ptr<const ConfigIndex> getConfigHandle() const override
 		{
-			std::function<std::optional<YAML::Node>(const YAML::Node& node, std::vector<std::string_view>&,int)> f;
+			std::lock_guard lock(snapshotMutex_);
+			return snapshot_;
+		}
 
-			f = [&](const YAML::Node& node, std::vector<std::string_view>& keys, int i)->std::optional<YAML::Node> {
-				if (i == keys.size()) {
-					return node;
-				}
-				const std::string temp(keys[i].begin(), keys[i].end());
-				const YAML::Node child = node[temp];
-				if (not child) {
-					return std::nullopt;
-				}
-				return f(child, keys, i + 1);
-				};
+		virtual u32 subscribeConfig(std::string_view subtree, ConfigCallback&& callback) override
+		{
+			std::lock_guard lock(subscriptionMutex_);
+			const u32 id = nextSubscriptionId_++;
+			subscriptions_.push_back(Subscription{ id, std::string(subtree), std::move(callback) });
+			return id;
+		}
 
-			auto keys = split(name, '.');
-			auto result = f(config_, keys, 0);
-			return result;
+		virtual void unsubscribeConfig(u32 id) override
+		{
+			std::lock_guard lock(subscriptionMutex_);
+			std::erase_if(subscriptions_, [id](auto const& subscription) { return subscription.id == id; });
 		}
 
-		static std::vector<std::string_view> split(const std::string_view& value, char delim)
+		virtual void update() override
 		{
-			std::vector<std::string_view> result;
-			auto start = value.begin();
-			const auto end = value.end();
-			while (start != end) {
-				auto next = std::find(start, end, delim);
-				result.emplace_back(start, next);
-				start = next != end ? std::next(next) : next;
+			Box<ConfigIndex> next;
+			{
+				std::lock_guard lock(pendingMutex_);
+				next = std::move(pending_);
+			}
+			if (!next) {
+				return;
+			}
+
+			// the changed paths point into both snapshots, which are held until the callbacks return
+			const ptr<const ConfigIndex> previous = getConfigHandle();
+			const ptr<const ConfigIndex> current = std::move(next);
+			const auto changed = current->getChangedPaths(*previous);
+			publish(ptr<const ConfigIndex>(current));
+			log::info("config reloaded, {} values changed", changed.size());
+
+			// a callback may subscribe or unsubscribe, so they're called on a copy without the lock
+			std::vector<Subscription> subscriptions;
+			{
+				std::lock_guard lock(subscriptionMutex_);
+				subscriptions = subscriptions_;
+			}
+			for (auto const& subscription : subscriptions) {
+				const bool affected = std::any_of(changed.begin(), changed.end(), [&](std::string_view path) {
+					return ConfigIndex::isInSubtree(path, subscription.subtree);
+				});
+				if (affected) {
+					subscription.callback(*current);
+				}
 			}
-			return result;
 		}
 
 
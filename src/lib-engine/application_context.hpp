@@ -1,17 +1,26 @@
 #pragma once
 
 #include "engine80.hpp"
+#include "config_index.hpp"
+#include "service_slot.hpp"
+#include <array>
+#include <cassert>
+#include <functional>
 #include <optional>
 
-namespace YAML {
-	class Node;
-}
-
 namespace qf {
 	class ApplicationContext;
 
 	struct IApplicationContext : public Serializable {
+	protected:
+		/*
+		* non-owning, each service is kept alive by the registration under its name
+		*/
+		std::array<Serializable*, size_t(ServiceSlot::Count)> serviceSlots_{};
 
+		static inline IApplicationContext* current_{};
+
+	public:
 		virtual Result RegisterService(std::shared_ptr<Serializable>&& obj, std::string&& contextName) = 0;
 
 		virtual Result GetServiceByName(std::string const & contextName, std::shared_ptr<Serializable>& objOut) const = 0;
@@ -20,9 +29,38 @@ namespace qf {
 		virtual std::shared_ptr<Serializable> 
 			GetServiceByName(std::string const& serviceName) const = 0;
 
-		virtual std::optional<bool> getPropertyAsBool(const std::string_view& name) const = 0;
+		using ConfigCallback = std::function<void(const ConfigIndex&)>;
+
+		/*
+		* the current snapshot of config.yaml, from any thread, as one atomic load with no lock
+		* and no reference count. a reloaded config replaces it in update(), and the old
+		* snapshot, with the strings and lists read from it, stays valid until the config is
+		* reloaded again, so at least until the end of the next frame. code that keeps a
+		* snapshot for longer than that takes getConfigHandle()
+		*/
+		virtual const ConfigIndex* getConfig() const = 0;
+
+		/*
+		* a handle that keeps the current snapshot alive for as long as it is held. takes a
+		* lock, so it isn't for hot paths
+		*/
+		virtual ptr<const ConfigIndex> getConfigHandle() const = 0;
+
+		/*
+		* calls back from update() on the main thread with the new snapshot whenever a reload
+		* changes anything under subtree, eg "graphics.vulkan.swapchain". an empty subtree
+		* matches every change. subscribing and unsubscribing are safe from any thread, and
+		* from inside a callback. returns an id for unsubscribeConfig()
+		*/
+		virtual u32 subscribeConfig(std::string_view subtree, ConfigCallback&& callback) = 0;
+
+		virtual void unsubscribeConfig(u32 id) = 0;
 
-		virtual std::optional<YAML::Node> getProperty(const std::string_view& name) const = 0;
+		/*
+		* called by the main loop between frames. publishes a config reloaded in the background
+		* and notifies its subscribers
+		*/
+		virtual void update() = 0;
 
 
 		//template<typename T>
@@ -38,12 +76,61 @@ namespace qf {
 
 
 
+		/*
+		* registers a service under its name and in its slot
+		*/
+		template<SlottedService T>
+		Result registerService(ptr<T> const& obj) {
+			auto res = RegisterService(ptr<Serializable>(obj), std::string(T::SERVICE_NAME));
+			if (res.code_ == Result::Code::OK) {
+				serviceSlots_[size_t(T::SERVICE_SLOT)] = obj.get();
+			}
+			return res;
+		}
+
+		/*
+		* the service in T's slot, or nullptr when none has been registered
+		*/
+		template<SlottedService T>
+		[[nodiscard]]
+		T* findService() const {
+			return static_cast<T*>(serviceSlots_[size_t(T::SERVICE_SLOT)]);
+		}
+
+		/*
+		* the service in T's slot, which must have been registered. the reference stays valid
+		* for the lifetime of the context, so it can be fetched once and kept
+		*/
+		template<SlottedService T>
+		[[nodiscard]]
+		T& getService() const {
+			T* service = findService<T>();
+			assert(service && "service not registered");
+			return *service;
+		}
+
 		static void SetApplicationContext(std::shared_ptr<IApplicationContext> const & context);
 
 		static ptr<IApplicationContext> getContext();
+
+		/*
+		* the current context without touching its reference count, for hot paths
+		*/
+		static IApplicationContext& current() {
+			return *current_;
+		}
 	};
 
 	struct ApplicationContextClass {
 		using DefaultInterface = IApplicationContext;
 	};
+
+	/*
+	* shorthand for IApplicationContext::current().getService<T>()
+	*/
+	template<SlottedService T>
+	[[nodiscard]]
+	T& getService() {
+		return IApplicationContext::current().getService<T>();
+	}
 }
@@ -0,0 +1,233 @@
+#include "archive.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+namespace qf
+{
+	namespace
+	{
+		struct ArchiveHeader {
+			u32 magic;
+			u32 formatVersion;
+			u32 version;
+			u32 reserved;
+		};
+
+		/*
+		* object references: 0 is null, n refers to the nth object in the archive. the first
+		* reference to an object is followed by its class id and its state
+		*/
+		constexpr u32 NULL_OBJECT = 0;
+	}
+
+	// the base class has no state of its own in an archive
+	Serializable::Serializable(Archive&) {}
+
+	Archive::Archive()
+		: reading_(true) {}
+
+	Archive::Archive(u32 version, size_t capacity)
+		: reading_(false)
+		, version_(version)
+	{
+		buffer_.reserve(std::max(capacity, sizeof(ArchiveHeader)));
+		ArchiveHeader header{
+			.magic = MAGIC,
+			.formatVersion = FORMAT_VERSION,
+			.version = version,
+			.reserved = 0,
+		};
+		serializeBytes(&header, sizeof(header));
+	}
+
+	Expected<Box<Archive>> Archive::open(std::span<const std::byte> data)
+	{
+		auto archive = Box<Archive>(new Archive());
+		archive->data_ = data;
+		TRY_EXPR_IGNORE_VALUE(archive->readHeader());
+		return archive;
+	}
+
+	Expected<Box<Archive>> Archive::open(const std::filesystem::path& path)
+	{
+		auto file = MappedFile::open(path);
+		if (!file.has_value()) {
+			return std::unexpected(file.error());
+		}
+		std::shared_ptr<MappedFile> storage = std::move(file.value());
+		auto archive = Box<Archive>(new Archive());
+		archive->data_ = storage->getData();
+		archive->storage_ = std::move(storage);
+		TRY_EXPR_IGNORE_VALUE(archive->readHeader());
+		return archive;
+	}
+
+	Expected<void> Archive::readHeader()
+	{
+		ArchiveHeader header;
+		serializeBytes(&header, sizeof(header));
+		if (error_ || header.magic != MAGIC) {
+			return std::unexpected("not an archive");
+		}
+		if (header.formatVersion != FORMAT_VERSION) {
+			return std::unexpected(std::format("archive format {} isn't supported, expected {}", header.formatVersion, FORMAT_VERSION));
+		}
+		version_ = header.version;
+		return {};
+	}
+
+	Expected<void> Archive::getStatus() const
+	{
+		if (error_) {
+			return std::unexpected(*error_);
+		}
+		return {};
+	}
+
+	void Archive::setError(std::string&& message)
+	{
+		if (!error_) {
+			error_.emplace(std::move(message));
+		}
+	}
+
+	std::span<const std::byte> Archive::getData() const
+	{
+		return reading_ ? data_ : std::span<const std::byte>(buffer_);
+	}
+
+	Expected<void> Archive::save(const std::filesystem::path& path) const
+	{
+		TRY_EXPR_IGNORE_VALUE(getStatus());
+		std::FILE* file = std::fopen(path.string().c_str(), "wb");
+		if (!file) {
+			return std::unexpected(std::format("can't write {}", path.string()));
+		}
+		const auto data = getData();
+		const bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+		std::fclose(file);
+		if (!written) {
+			return std::unexpected(std::format("failed writing {}", path.string()));
+		}
+		return {};
+	}
+
+	const std::byte* Archive::take(size_t size, size_t alignment)
+	{
+		if (error_) {
+			return nullptr;
+		}
+		// offsets are aligned from the start of the archive, which only lines up with memory
+		// when the data itself is aligned, as mapped files and heap blocks are
+		const size_t start = (cursor_ + alignment - 1) & ~(alignment - 1);
+		if (start > data_.size() || data_.size() - start < size) {
+			setError("archive is truncated");
+			return nullptr;
+		}
+		const std::byte* p = data_.data() + start;
+		if (reinterpret_cast<uintptr_t>(p) % alignment != 0) {
+			setError("archive data isn't aligned for its views");
+			return nullptr;
+		}
+		cursor_ = start + size;
+		return p;
+	}
+
+	void Archive::align(size_t alignment)
+	{
+		if (!error_) {
+			buffer_.resize((buffer_.size() + alignment - 1) & ~(alignment - 1));
+		}
+	}
+
+	u32 Archive::serializeCount(size_t count)
+	{
+		if (!reading_) {
+			if (count > std::numeric_limits<u32>::max()) {
+				setError(std::format("can't archive {} elements", count));
+				return 0;
+			}
+			u32 value = static_cast<u32>(count);
+			serializeBytes(&value, sizeof(value));
+			return value;
+		}
+		u32 value;
+		serializeBytes(&value, sizeof(value));
+		// every element takes at least a byte, so a bigger count can only come from damage
+		if (value > data_.size() - cursor_) {
+			setError("archive is truncated");
+			return 0;
+		}
+		return value;
+	}
+
+	void Archive::serialize(std::string& value)
+	{
+		const u32 length = serializeCount(value.size());
+		if (reading_) {
+			const std::byte* p = take(length, 1);
+			value.assign(p ? reinterpret_cast<const char*>(p) : "", p ? length : 0);
+			return;
+		}
+		serializeBytes(value.data(), length);
+	}
+
+	void Archive::writeObject(const ptr<Serializable>& object)
+	{
+		if (!object) {
+			u32 id = NULL_OBJECT;
+			serializeBytes(&id, sizeof(id));
+			return;
+		}
+		auto [it, inserted] = objectIds_.emplace(object.get(), static_cast<u32>(objectIds_.size() + 1));
+		u32 id = it->second;
+		serializeBytes(&id, sizeof(id));
+		if (!inserted) {
+			return;
+		}
+
+		UUID classId = object->getClassId();
+		if (classId == UUID{}) {
+			setError("object has no class id and can't be archived");
+			return;
+		}
+		serializeBytes(&classId, sizeof(classId));
+		if (auto res = object->serialize(*this); !res.has_value()) {
+			setError(res.error().str());
+		}
+	}
+
+	ptr<Serializable> Archive::readObject()
+	{
+		u32 id;
+		serializeBytes(&id, sizeof(id));
+		if (error_ || id == NULL_OBJECT) {
+			return nullptr;
+		}
+		if (id <= objects_.size()) {
+			return objects_[id - 1];
+		}
+		if (id != objects_.size() + 1) {
+			setError("archive has a damaged object reference");
+			return nullptr;
+		}
+
+		UUID classId;
+		serializeBytes(&classId, sizeof(classId));
+		auto object = createInstance_(classId);
+		if (!object) {
+			setError(std::format("archive has an object of unknown class {:016x}{:016x}", classId.high(), classId.low()));
+			return nullptr;
+		}
+		// registered before its state is read so references back to it, cycles included,
+		// resolve to the same object
+		objects_.push_back(object);
+		if (auto res = object->serialize(*this); !res.has_value()) {
+			setError(res.error().str());
+		}
+		return object;
+	}
+}
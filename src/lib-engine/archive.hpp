@@ -0,0 +1,232 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "flat_hash_map.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace qf
+{
+	/**
+	 * @brief Versioned binary stream of Serializable objects and their data.
+	 *
+	 * One class both writes and reads, so a Serializable describes its state once, in
+	 * serialize(), and the same code saves and loads it:
+	 *
+	 *     Expected<void> serialize(Archive& ar) override {
+	 *         ar.serialize(name_);
+	 *         ar.serialize(positions_);   // std::vector<glm::vec3>, one copy
+	 *         ar.view(indices_);          // std::span<const u32>, no copy when reading
+	 *         ar.serialize(child_);       // ptr<Node>, created through its class id
+	 *         return ar.getStatus();
+	 *     }
+	 *
+	 * Objects are written with the class id from getClassId() and created through the class
+	 * factories when read back. An object reachable more than once is written once and every
+	 * reference to it is read back as the same object, cycles included.
+	 *
+	 * Values are stored in their in-memory representation, so archives are only read on
+	 * machines of the same endianness. A view is aligned for its type in the archive, and
+	 * when reading points straight into the archive's data, so a mapped archive's payloads
+	 * are never copied. Views stay valid as long as the data does: the span given to
+	 * open() or, for a mapped file, whatever holds getStorage().
+	 *
+	 * Errors stick: after the first one every read gives zeroed values and nothing more is
+	 * written, so serialize() only needs to check getStatus() once at the end.
+	 */
+	class Archive : NonCopyable
+	{
+	public:
+		static constexpr u32 MAGIC = 0x52414651; // "QFAR"
+		static constexpr u32 FORMAT_VERSION = 1;
+
+		/*
+		* starts writing an archive in memory. version is the caller's own data version,
+		* serialize() reads it back from getVersion() to handle older archives. reserving the
+		* expected size up front saves growing the buffer, which dominates writing big archives
+		*/
+		explicit Archive(u32 version, size_t capacity = 0);
+
+		/*
+		* reads an archive from data, which must outlive it and every view taken from it
+		*/
+		static Expected<Box<Archive>> open(std::span<const std::byte> data);
+
+		/*
+		* maps the file and reads the archive from it
+		*/
+		static Expected<Box<Archive>> open(const std::filesystem::path& path);
+
+		bool isReading() const { return reading_; }
+
+		u32 getVersion() const { return version_; }
+
+		/*
+		* the first error, if any
+		*/
+		Expected<void> getStatus() const;
+
+		void setError(std::string&& message);
+
+		/*
+		* everything written so far, header included
+		*/
+		std::span<const std::byte> getData() const;
+
+		/*
+		* writes the archive to a file, replacing it
+		*/
+		Expected<void> save(const std::filesystem::path& path) const;
+
+		/*
+		* the mapped file a reading archive came from, to be held by objects that keep views
+		* into it after the archive is gone. empty for archives opened from memory
+		*/
+		std::shared_ptr<const void> getStorage() const { return storage_; }
+
+		template<typename T>
+			requires std::is_trivially_copyable_v<T>
+		void serialize(T& value) {
+			serializeBytes(&value, sizeof(T));
+		}
+
+		void serialize(std::string& value);
+
+		template<typename T>
+		void serialize(std::vector<T>& values);
+
+		template<typename T>
+			requires std::derived_from<T, Serializable>
+		void serialize(ptr<T>& object);
+
+		/*
+		* writes the elements, or when reading points values at them in the archive
+		*/
+		template<typename T>
+			requires std::is_trivially_copyable_v<T>
+		void view(std::span<const T>& values);
+
+	private:
+		struct ObjectHash {
+			size_t operator()(const Serializable* object) const {
+				return static_cast<size_t>(detail::mix64(reinterpret_cast<uintptr_t>(object)));
+			}
+		};
+
+		bool reading_;
+		u32 version_ = 0;
+		std::optional<Err> error_{};
+
+		// writing
+		std::vector<std::byte> buffer_{};
+		FlatHashMap<const Serializable*, u32, ObjectHash> objectIds_{};
+
+		// reading
+		std::span<const std::byte> data_{};
+		size_t cursor_ = 0;
+		std::vector<ptr<Serializable>> objects_{};
+		std::shared_ptr<const void> storage_{};
+
+		Archive();
+
+		Expected<void> readHeader();
+
+		/*
+		* copies size bytes out of the archive or into it
+		*/
+		void serializeBytes(void* data, size_t size) {
+			if (!reading_) {
+				if (!error_) {
+					auto const* p = static_cast<const std::byte*>(data);
+					buffer_.insert(buffer_.end(), p, p + size);
+				}
+				return;
+			}
+			if (error_ || data_.size() - cursor_ < size) {
+				std::memset(data, 0, size);
+				if (!error_) {
+					setError("archive is truncated");
+				}
+				return;
+			}
+			std::memcpy(data, data_.data() + cursor_, size);
+			cursor_ += size;
+		}
+
+		/*
+		* the next size bytes, aligned to alignment, or nullptr after an error
+		*/
+		const std::byte* take(size_t size, size_t alignment);
+
+		/*
+		* pads what has been written so far to a multiple of alignment
+		*/
+		void align(size_t alignment);
+
+		u32 serializeCount(size_t count);
+
+		ptr<Serializable> readObject();
+
+		void writeObject(const ptr<Serializable>& object);
+	};
+
+	template<typename T>
+	void Archive::serialize(std::vector<T>& values)
+	{
+		const u32 count = serializeCount(values.size());
+		if constexpr (std::is_trivially_copyable_v<T>) {
+			if (reading_) {
+				const std::byte* p = take(count * sizeof(T), 1);
+				values.resize(p ? count : 0);
+				if (p && count != 0) {
+					std::memcpy(values.data(), p, count * sizeof(T));
+				}
+				return;
+			}
+			serializeBytes(values.data(), values.size() * sizeof(T));
+		}
+		else {
+			if (reading_) {
+				values.resize(count);
+			}
+			for (auto& value : values) {
+				serialize(value);
+			}
+		}
+	}
+
+	template<typename T>
+		requires std::derived_from<T, Serializable>
+	void Archive::serialize(ptr<T>& object)
+	{
+		if (!reading_) {
+			writeObject(object);
+			return;
+		}
+		auto read = readObject();
+		object = std::dynamic_pointer_cast<T>(read);
+		if (read && !object && !error_) {
+			setError("archived object isn't of the expected type");
+		}
+	}
+
+	template<typename T>
+		requires std::is_trivially_copyable_v<T>
+	void Archive::view(std::span<const T>& values)
+	{
+		const u32 count = serializeCount(values.size());
+		if (reading_) {
+			const std::byte* p = take(count * sizeof(T), alignof(T));
+			values = p ? std::span<const T>(reinterpret_cast<const T*>(p), count) : std::span<const T>();
+			return;
+		}
+		align(alignof(T));
+		serializeBytes(const_cast<T*>(values.data()), values.size_bytes());
+	}
+}
@@ -0,0 +1,240 @@
+#include "asset_cache.hpp"
+#include "application_context.hpp"
+#include "logger.hpp"
+#include "profiler.hpp"
+
+namespace
+{
+	static constexpr std::string_view DEFAULT_BUDGET_PROP_NAME{ "assets.cache.default-budget" };
+	static constexpr std::string_view BUDGETS_PROP_NAME{ "assets.cache.budgets" };
+}
+
+namespace qf
+{
+	auto AssetCache::Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		if (auto value = config->getInt(DEFAULT_BUDGET_PROP_NAME)) {
+			settings.defaultBudget = static_cast<u64>(*value);
+		}
+		for (size_t i = 0; i != config->getSize(BUDGETS_PROP_NAME); ++i) {
+			const std::string item = std::format("{}.{}.", BUDGETS_PROP_NAME, i);
+			const auto type = config->getString(item + "type");
+			const auto bytes = config->getInt(item + "bytes");
+			if (!type || !bytes) {
+				log::warn("asset cache budget {} needs a type and bytes", i);
+				continue;
+			}
+			settings.budgets.push_back(Budget{ .type = std::string(*type), .bytes = static_cast<u64>(*bytes) });
+		}
+		return settings;
+	}
+
+	AssetCache::AssetCache(const Settings& settings)
+		: settings_(settings) {}
+
+	AssetCache::~AssetCache() = default;
+
+	Expected<u32> AssetCache::getType(std::string_view name)
+	{
+		for (u32 i = 0; i != typeCount_; ++i) {
+			if (types_[i].name == name) {
+				return i;
+			}
+		}
+		if (typeCount_ == MAX_TYPES) {
+			return std::unexpected(std::format("can't cache assets of type {}, there are already {} types", name, MAX_TYPES));
+		}
+		Type& type = types_[typeCount_];
+		type.name = std::string(name);
+		type.budget = settings_.defaultBudget;
+		for (auto const& budget : settings_.budgets) {
+			if (budget.type == name) {
+				type.budget = budget.bytes;
+			}
+		}
+		return typeCount_++;
+	}
+
+	Expected<detail::AssetEntry*> AssetCache::acquire(const UUID& id, std::string_view typeName, LoadFn&& load)
+	{
+		ptr<detail::AssetEntry> entry;
+		{
+			std::unique_lock lock(mutex_);
+			auto type = getType(typeName);
+			if (!type.has_value()) {
+				return std::unexpected(type.error());
+			}
+
+			auto [it, inserted] = entries_.emplace(id);
+			if (!inserted) {
+				entry = it->second;
+				if (entry->type != type.value()) {
+					return std::unexpected(std::format("asset is cached as a {}, not a {}", types_[entry->type].name, typeName));
+				}
+				++types_[entry->type].hits;
+				entry->pins.fetch_add(1, std::memory_order_relaxed);
+				entry->referenced.store(true, std::memory_order_relaxed);
+				loaded_.wait(lock, [&] { return entry->state != detail::AssetEntry::State::Loading; });
+				if (entry->state == detail::AssetEntry::State::Failed) {
+					entry->pins.fetch_sub(1, std::memory_order_relaxed);
+					return std::unexpected(*entry->error);
+				}
+				return entry.get();
+			}
+
+			entry = std::make_shared<detail::AssetEntry>();
+			entry->id = id;
+			entry->type = type.value();
+			entry->pins.store(1, std::memory_order_relaxed);
+			it->second = entry;
+			++types_[entry->type].misses;
+		}
+
+		Expected<LoadedAsset<void>> loaded = [&] {
+			QF_PROFILE_ZONE("AssetCache::load");
+			return load();
+		}();
+
+		std::vector<ptr<detail::AssetEntry>> evicted;
+		{
+			std::lock_guard lock(mutex_);
+			Type& type = types_[entry->type];
+			if (!loaded.has_value()) {
+				entry->state = detail::AssetEntry::State::Failed;
+				entry->error.emplace(loaded.error());
+				entries_.erase(id);
+			}
+			else {
+				entry->state = detail::AssetEntry::State::Ready;
+				entry->value = std::move(loaded->asset);
+				entry->bytes = loaded->bytes;
+				entry->referenced.store(true, std::memory_order_relaxed);
+				type.clock.push_back(entry);
+				type.residentBytes.fetch_add(entry->bytes, std::memory_order_relaxed);
+				evicted = trim(type, type.budget.load(std::memory_order_relaxed));
+			}
+		}
+		loaded_.notify_all();
+
+		if (!loaded.has_value()) {
+			return std::unexpected(loaded.error());
+		}
+		return entry.get();
+	}
+
+	detail::AssetEntry* AssetCache::acquire(const UUID& id, std::string_view typeName)
+	{
+		std::lock_guard lock(mutex_);
+		auto it = entries_.find(id);
+		if (it == entries_.end()) {
+			return nullptr;
+		}
+		detail::AssetEntry* entry = it->second.get();
+		if (entry->state != detail::AssetEntry::State::Ready || types_[entry->type].name != typeName) {
+			return nullptr;
+		}
+		++types_[entry->type].hits;
+		entry->pins.fetch_add(1, std::memory_order_relaxed);
+		entry->referenced.store(true, std::memory_order_relaxed);
+		return entry;
+	}
+
+	/*
+	* pins only go from 0 to 1 under the lock, so an entry seen unpinned here stays unpinned
+	*/
+	std::vector<ptr<detail::AssetEntry>> AssetCache::trim(Type& type, u64 budget)
+	{
+		std::vector<ptr<detail::AssetEntry>> evicted;
+		// two passes clear every referenced bit, so a third finding nothing means all are pinned
+		for (size_t visited = 0; type.residentBytes.load(std::memory_order_relaxed) > budget && visited < type.clock.size() * 2 + 1;) {
+			if (type.clock.empty()) {
+				break;
+			}
+			if (type.hand >= type.clock.size()) {
+				type.hand = 0;
+			}
+			detail::AssetEntry& entry = *type.clock[type.hand];
+			if (entry.pins.load(std::memory_order_acquire) != 0 || entry.referenced.exchange(false, std::memory_order_relaxed)) {
+				++type.hand;
+				++visited;
+				continue;
+			}
+
+			entries_.erase(entry.id);
+			type.residentBytes.fetch_sub(entry.bytes, std::memory_order_relaxed);
+			++type.evictions;
+			evicted.push_back(std::move(type.clock[type.hand]));
+			type.clock[type.hand] = std::move(type.clock.back());
+			type.clock.pop_back();
+			visited = 0;
+		}
+		return evicted;
+	}
+
+	void AssetCache::release(detail::AssetEntry* entry)
+	{
+		Type& type = types_[entry->type];
+		if (entry->pins.fetch_sub(1, std::memory_order_acq_rel) != 1
+			|| type.residentBytes.load(std::memory_order_relaxed) <= type.budget.load(std::memory_order_relaxed)) {
+			return;
+		}
+		// the type went over budget while its assets were in use
+		std::vector<ptr<detail::AssetEntry>> evicted;
+		{
+			std::lock_guard lock(mutex_);
+			evicted = trim(type, type.budget.load(std::memory_order_relaxed));
+		}
+	}
+
+	void AssetCache::clear()
+	{
+		std::vector<ptr<detail::AssetEntry>> evicted;
+		std::lock_guard lock(mutex_);
+		for (u32 i = 0; i != typeCount_; ++i) {
+			// referenced assets are spared once, clearing them first evicts everything unpinned
+			for (auto const& entry : types_[i].clock) {
+				entry->referenced.store(false, std::memory_order_relaxed);
+			}
+			auto typeEvicted = trim(types_[i], 0);
+			std::move(typeEvicted.begin(), typeEvicted.end(), std::back_inserter(evicted));
+		}
+	}
+
+	void AssetCache::setBudget(std::string_view typeName, u64 bytes)
+	{
+		std::vector<ptr<detail::AssetEntry>> evicted;
+		std::lock_guard lock(mutex_);
+		auto type = getType(typeName);
+		if (!type.has_value()) {
+			log::warn("{}", type.error().str());
+			return;
+		}
+		types_[type.value()].budget.store(bytes, std::memory_order_relaxed);
+		evicted = trim(types_[type.value()], bytes);
+	}
+
+	auto AssetCache::getStats() const -> std::vector<TypeStats>
+	{
+		std::lock_guard lock(mutex_);
+		std::vector<TypeStats> stats;
+		for (u32 i = 0; i != typeCount_; ++i) {
+			const Type& type = types_[i];
+			stats.push_back(TypeStats{
+				.type = type.name,
+				.budget = type.budget.load(std::memory_order_relaxed),
+				.residentBytes = type.residentBytes.load(std::memory_order_relaxed),
+				.assetCount = type.clock.size(),
+				.hits = type.hits,
+				.misses = type.misses,
+				.evictions = type.evictions,
+			});
+		}
+		return stats;
+	}
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "flat_hash_map.hpp"
+#include "service_slot.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qf
+{
+	class AssetCache;
+
+	namespace detail
+	{
+		struct AssetEntry {
+			enum class State : u8 {
+				Loading,
+				Ready,
+				Failed,
+			};
+
+			UUID id;
+			u32 type = 0;
+			// handles holding the entry. a pinned entry is never evicted
+			std::atomic<u32> pins{};
+			// set by every lookup and cleared by the clock hand passing over it
+			std::atomic<bool> referenced{};
+
+			// the rest is guarded by the cache's mutex until the entry is ready
+			State state = State::Loading;
+			u64 bytes = 0;
+			ptr<void> value{};
+			std::optional<Err> error{};
+		};
+	}
+
+	/**
+	 * @brief Keeps a cached asset resident for as long as the handle, or a copy of it, lives.
+	 */
+	template<typename T>
+	class AssetHandle
+	{
+		friend class AssetCache;
+
+		AssetCache* cache_{};
+		detail::AssetEntry* entry_{};
+
+		AssetHandle(AssetCache* cache, detail::AssetEntry* entry)
+			: cache_(cache), entry_(entry) {}
+
+	public:
+		AssetHandle() = default;
+
+		AssetHandle(const AssetHandle& other)
+			: cache_(other.cache_), entry_(other.entry_)
+		{
+			if (entry_) {
+				entry_->pins.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		AssetHandle(AssetHandle&& other) noexcept
+			: cache_(std::exchange(other.cache_, nullptr)), entry_(std::exchange(other.entry_, nullptr)) {}
+
+		AssetHandle& operator=(AssetHandle other) noexcept {
+			std::swap(cache_, other.cache_);
+			std::swap(entry_, other.entry_);
+			return *this;
+		}
+
+		~AssetHandle() { reset(); }
+
+		void reset();
+
+		T* get() const { return entry_ ? static_cast<T*>(entry_->value.get()) : nullptr; }
+
+		T* operator->() const { return get(); }
+
+		T& operator*() const { return *get(); }
+
+		explicit operator bool() const { return entry_ != nullptr; }
+
+		const UUID& getId() const { return entry_->id; }
+
+		u64 getBytes() const { return entry_->bytes; }
+	};
+
+	/*
+	* what a loader hands the cache: the asset and the bytes it counts against its type's budget
+	*/
+	template<typename T>
+	struct LoadedAsset {
+		ptr<T> asset;
+		u64 bytes;
+	};
+
+	/**
+	 * @brief Loaded assets keyed by id, kept within a memory budget per asset type.
+	 *
+	 * An asset type is named by T::ASSET_TYPE. Each type has a budget of resident bytes, and
+	 * once a type is over it the cache evicts its unpinned assets with the clock algorithm:
+	 * a hand sweeps the type's assets, sparing those looked up since it last passed them,
+	 * which approximates least recently used without reordering anything on a lookup.
+	 * Assets held by a handle are never evicted, so a type can go over budget while they
+	 * are in use, and is trimmed as the handles go.
+	 *
+	 * Loading an asset that is already being loaded waits for that load rather than starting
+	 * another, so the waiting thread blocks. A failed load isn't cached, the next load of the
+	 * asset tries again.
+	 *
+	 * The cache is registered with the application context under SERVICE_NAME and SERVICE_SLOT.
+	 */
+	class AssetCache : public Serializable
+	{
+	public:
+		static constexpr std::string_view SERVICE_NAME{ "assets" };
+		static constexpr ServiceSlot SERVICE_SLOT = ServiceSlot::Assets;
+
+		static constexpr u32 MAX_TYPES = 32;
+
+		struct Settings {
+			struct Budget {
+				std::string type;
+				u64 bytes;
+			};
+
+			// bytes kept resident for types without a budget of their own
+			u64 defaultBudget = 256ull << 20;
+			std::vector<Budget> budgets{};
+
+			static Settings fromConfig();
+		};
+
+		struct TypeStats {
+			std::string_view type;
+			u64 budget;
+			u64 residentBytes;
+			u64 assetCount;
+			u64 hits;
+			u64 misses;
+			u64 evictions;
+		};
+
+		using LoadFn = std::function<Expected<LoadedAsset<void>>()>;
+
+		explicit AssetCache(const Settings& settings);
+
+		virtual ~AssetCache() override;
+
+		/*
+		* the asset with this id, loaded by loader() when it isn't cached. loader returns an
+		* Expected<LoadedAsset<T>> and is called on the calling thread without any lock held
+		*/
+		template<typename T, typename F>
+		Expected<AssetHandle<T>> load(const UUID& id, F&& loader) {
+			auto entry = acquire(id, T::ASSET_TYPE, [&]() -> Expected<LoadedAsset<void>> {
+				Expected<LoadedAsset<T>> loaded = loader();
+				if (!loaded.has_value()) {
+					return std::unexpected(loaded.error());
+				}
+				return LoadedAsset<void>{ .asset = std::move(loaded->asset), .bytes = loaded->bytes };
+			});
+			if (!entry.has_value()) {
+				return std::unexpected(entry.error());
+			}
+			return AssetHandle<T>(this, entry.value());
+		}
+
+		/*
+		* the asset if it is cached, without loading it
+		*/
+		template<typename T>
+		AssetHandle<T> find(const UUID& id) {
+			return AssetHandle<T>(this, acquire(id, T::ASSET_TYPE));
+		}
+
+		/*
+		* evicts every unpinned asset
+		*/
+		void clear();
+
+		/*
+		* changes a type's budget, evicting right away when it is over the new one
+		*/
+		void setBudget(std::string_view type, u64 bytes);
+
+		std::vector<TypeStats> getStats() const;
+
+	private:
+		template<typename T>
+		friend class AssetHandle;
+
+		struct Type {
+			std::string name{};
+			std::atomic<u64> budget{};
+			std::atomic<u64> residentBytes{};
+			// the ready assets, in the order the clock hand visits them
+			std::vector<ptr<detail::AssetEntry>> clock{};
+			size_t hand = 0;
+			u64 hits = 0;
+			u64 misses = 0;
+			u64 evictions = 0;
+		};
+
+		mutable std::mutex mutex_{};
+		std::condition_variable loaded_{};
+		UUIDMap<ptr<detail::AssetEntry>> entries_{};
+		// fixed, so a handle can check its type's budget without the lock
+		std::array<Type, MAX_TYPES> types_{};
+		u32 typeCount_ = 0;
+		Settings settings_{};
+
+		Expected<detail::AssetEntry*> acquire(const UUID& id, std::string_view type, LoadFn&& load);
+
+		detail::AssetEntry* acquire(const UUID& id, std::string_view type);
+
+		Expected<u32> getType(std::string_view name);
+
+		/*
+		* evicts unpinned assets until the type is within its budget or every asset left is
+		* pinned. returns the evicted entries so they can be freed after the lock is released
+		*/
+		std::vector<ptr<detail::AssetEntry>> trim(Type& type, u64 budget);
+
+		void release(detail::AssetEntry* entry);
+	};
+
+	template<typename T>
+	void AssetHandle<T>::reset() {
+		if (entry_) {
+			cache_->release(entry_);
+			cache_ = nullptr;
+			entry_ = nullptr;
+		}
+	}
+}
+
+template<>
+struct std::formatter<qf::AssetCache::TypeStats> {
+	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
+		return ctx.end();
+	}
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		return format_to(ctx.out(), "{}: {} assets, {} of {} bytes, {} hits, {} misses, {} evictions",
+			val.type, val.assetCount, val.residentBytes, val.budget, val.hits, val.misses, val.evictions);
+	}
+};
@@ -0,0 +1,240 @@
+#include "asset_pack.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace qf
+{
+	namespace
+	{
+		constexpr u32 PACK_CHUNK_COUNT = 3;
+
+		u64 alignUp(u64 value) {
+			return (value + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+		}
+
+		static_assert(sizeof(UUID) == 16, "the toc hashes the 16 bytes of the id");
+
+		/*
+		* not std::hash, which is free to change and is only as wide as size_t
+		*/
+		size_t getTocSlot(const UUID& id, size_t mask) {
+			return static_cast<size_t>(hashBytes(&id, sizeof(id)) & mask);
+		}
+	}
+
+	UUID makeAssetId(std::string_view name)
+	{
+		UUID id;
+		const u64 high = hashString(name, 0x5146504bull);
+		const u64 low = hashString(name, high);
+		id.p0 = static_cast<u32>(high >> 32);
+		id.p1 = static_cast<u16>(high >> 16);
+		// version 8, the layout rfc 9562 leaves to the application, variant 10
+		id.p2 = static_cast<u16>((high & 0x0fff) | 0x8000);
+		id.p3 = static_cast<u16>(((low >> 48) & 0x3fff) | 0x8000);
+		for (int i = 0; i != 6; ++i) {
+			id.p4[i] = static_cast<u8>(low >> (40 - 8 * i));
+		}
+		return id;
+	}
+
+	AssetPack::~AssetPack() = default;
+
+	Expected<Box<AssetPack>> AssetPack::open(const fs::path& path)
+	{
+		auto file = MappedFile::open(path);
+		if (!file.has_value()) {
+			return std::unexpected(file.error());
+		}
+		Box<AssetPack> pack(new AssetPack());
+		pack->file_ = std::move(file.value());
+		const auto data = pack->file_->getData();
+
+		PackHeader header;
+		if (data.size() < sizeof(header)) {
+			return std::unexpected(std::format("{} is not an asset pack", path.string()));
+		}
+		std::memcpy(&header, data.data(), sizeof(header));
+		if (header.magic != PACK_MAGIC.getint()) {
+			return std::unexpected(std::format("{} is not an asset pack", path.string()));
+		}
+		if (header.version != PACK_VERSION) {
+			return std::unexpected(std::format("{} is version {}, expected {}", path.string(), header.version, PACK_VERSION));
+		}
+		if (data.size() - sizeof(header) < u64(header.chunkCount) * sizeof(PackChunk)) {
+			return std::unexpected(std::format("{} is truncated", path.string()));
+		}
+
+		// the mapping is page aligned, so the aligned offsets in the file are aligned in memory
+		pack->chunks_ = { reinterpret_cast<const PackChunk*>(data.data() + sizeof(header)), header.chunkCount };
+		for (auto const& chunk : pack->chunks_) {
+			if (chunk.offset % PACK_ALIGNMENT != 0 || chunk.offset > data.size() || data.size() - chunk.offset < chunk.size) {
+				return std::unexpected(std::format("{} has a damaged chunk table", path.string()));
+			}
+		}
+
+		const auto toc = pack->getChunk(PACK_TOC_CHUNK);
+		const size_t tocSize = toc.size() / sizeof(PackTocEntry);
+		if (tocSize == 0 || !std::has_single_bit(tocSize) || toc.size() % sizeof(PackTocEntry) != 0 || header.assetCount >= tocSize) {
+			return std::unexpected(std::format("{} has a damaged table of contents", path.string()));
+		}
+		pack->toc_ = { reinterpret_cast<const PackTocEntry*>(toc.data()), tocSize };
+		const auto names = pack->getChunk(PACK_NAME_CHUNK);
+		pack->names_ = { reinterpret_cast<const char*>(names.data()), names.size() };
+		pack->assetCount_ = header.assetCount;
+		return pack;
+	}
+
+	std::span<const std::byte> AssetPack::getChunk(FourCC tag) const
+	{
+		for (auto const& chunk : chunks_) {
+			if (chunk.tag == tag.getint()) {
+				return file_->getData().subspan(chunk.offset, chunk.size);
+			}
+		}
+		return {};
+	}
+
+	/*
+	* the table always has unused entries, so probing stops at one when the id isn't there
+	*/
+	const PackTocEntry* AssetPack::findEntry(const UUID& id) const
+	{
+		const size_t mask = toc_.size() - 1;
+		for (size_t slot = getTocSlot(id, mask), probes = 0; probes != toc_.size(); slot = (slot + 1) & mask, ++probes) {
+			const PackTocEntry& entry = toc_[slot];
+			if (entry.id == id) {
+				return &entry;
+			}
+			if (entry.id == UUID{}) {
+				return nullptr;
+			}
+		}
+		return nullptr;
+	}
+
+	std::optional<std::span<const std::byte>> AssetPack::find(const UUID& id) const
+	{
+		const PackTocEntry* entry = findEntry(id);
+		if (!entry) {
+			return std::nullopt;
+		}
+		// entries aren't checked when the pack is opened, a damaged one is treated as missing
+		const auto data = file_->getData();
+		if (entry->offset > data.size() || data.size() - entry->offset < entry->size) {
+			return std::nullopt;
+		}
+		return data.subspan(entry->offset, entry->size);
+	}
+
+	std::string_view AssetPack::getName(const UUID& id) const
+	{
+		const PackTocEntry* entry = findEntry(id);
+		if (!entry || entry->nameOffset > names_.size() || names_.size() - entry->nameOffset < entry->nameLength) {
+			return {};
+		}
+		return names_.substr(entry->nameOffset, entry->nameLength);
+	}
+
+	Expected<void> AssetPackBuilder::add(const UUID& id, std::string name, std::vector<std::byte>&& data)
+	{
+		if (id == UUID{}) {
+			return std::unexpected(std::format("asset {} has a nil id", name));
+		}
+		auto [it, inserted] = indices_.emplace(id, static_cast<u32>(assets_.size()));
+		if (!inserted) {
+			return std::unexpected(std::format("assets {} and {} have the same id", assets_[it->second].name, name));
+		}
+		assets_.emplace_back(Asset{ .id = id, .name = std::move(name), .data = std::move(data) });
+		return {};
+	}
+
+	Expected<void> AssetPackBuilder::write(const fs::path& path) const
+	{
+		// at most half full, so probes stay short and always reach an unused entry
+		const size_t tocSize = std::bit_ceil(std::max<size_t>(assets_.size() * 2, 2));
+		std::vector<PackTocEntry> toc(tocSize, PackTocEntry{});
+		std::string names;
+
+		const u64 tocOffset = alignUp(sizeof(PackHeader) + PACK_CHUNK_COUNT * sizeof(PackChunk));
+		const u64 tocBytes = tocSize * sizeof(PackTocEntry);
+		u64 nameBytes = 0;
+		for (auto const& asset : assets_) {
+			nameBytes += asset.name.size();
+		}
+		const u64 nameOffset = alignUp(tocOffset + tocBytes);
+		const u64 dataOffset = alignUp(nameOffset + nameBytes);
+
+		u64 offset = dataOffset;
+		for (auto const& asset : assets_) {
+			size_t slot = getTocSlot(asset.id, tocSize - 1);
+			while (!(toc[slot].id == UUID{})) {
+				slot = (slot + 1) & (tocSize - 1);
+			}
+			toc[slot] = PackTocEntry{
+				.id = asset.id,
+				.offset = offset,
+				.size = asset.data.size(),
+				.nameOffset = static_cast<u32>(names.size()),
+				.nameLength = static_cast<u32>(asset.name.size()),
+			};
+			names += asset.name;
+			offset = alignUp(offset + asset.data.size());
+		}
+
+		const PackHeader header{
+			.magic = PACK_MAGIC.getint(),
+			.version = PACK_VERSION,
+			.chunkCount = PACK_CHUNK_COUNT,
+			.assetCount = static_cast<u32>(assets_.size()),
+		};
+		const PackChunk chunks[PACK_CHUNK_COUNT] = {
+			{ .tag = PACK_TOC_CHUNK.getint(), .reserved = 0, .offset = tocOffset, .size = tocBytes },
+			{ .tag = PACK_NAME_CHUNK.getint(), .reserved = 0, .offset = nameOffset, .size = nameBytes },
+			{ .tag = PACK_DATA_CHUNK.getint(), .reserved = 0, .offset = dataOffset, .size = offset - dataOffset },
+		};
+
+		fs::path temp = path;
+		temp += ".tmp";
+		{
+			std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+			u64 written = 0;
+			auto write = [&](const void* data, u64 size) {
+				out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+				written += size;
+			};
+			auto pad = [&] {
+				static constexpr char zeros[PACK_ALIGNMENT]{};
+				write(zeros, alignUp(written) - written);
+			};
+			write(&header, sizeof(header));
+			write(chunks, sizeof(chunks));
+			pad();
+			write(toc.data(), tocBytes);
+			pad();
+			write(names.data(), names.size());
+			pad();
+			for (auto const& asset : assets_) {
+				write(asset.data.data(), asset.data.size());
+				pad();
+			}
+			if (!out) {
+				return std::unexpected(std::format("can't write {}", temp.string()));
+			}
+		}
+
+		std::error_code ec;
+		fs::rename(temp, path, ec);
+		if (ec) {
+			fs::remove(temp, ec);
+			return std::unexpected(std::format("can't replace {}", path.string()));
+		}
+		return {};
+	}
+}
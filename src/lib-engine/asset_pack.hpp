@@ -0,0 +1,143 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "flat_hash_map.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qf
+{
+	class MappedFile;
+
+	/*
+	* pack file layout: a PackHeader, then chunkCount PackChunks locating the chunks,
+	* each tagged with a FourCC and aligned to PACK_ALIGNMENT:
+	*   "TOC " a hash table of PackTocEntry, a power of two in size, indexed by
+	*          hashBytes() of the 16 bytes of the asset id, seed 0, with linear probing.
+	*          unused entries have a nil id. the hash is part of the format, changing it
+	*          needs a new PACK_VERSION
+	*   "NAME" the asset names the toc entries point into, for tools and error messages
+	*   "DATA" the assets, each aligned to PACK_ALIGNMENT
+	* offsets are from the start of the file and all integers are little endian
+	*/
+	inline constexpr FourCC PACK_MAGIC{ "QFPK" };
+	inline constexpr u32 PACK_VERSION = 2;
+	inline constexpr u64 PACK_ALIGNMENT = 64;
+
+	inline constexpr FourCC PACK_TOC_CHUNK{ "TOC " };
+	inline constexpr FourCC PACK_NAME_CHUNK{ "NAME" };
+	inline constexpr FourCC PACK_DATA_CHUNK{ "DATA" };
+
+	struct PackHeader {
+		u32 magic;
+		u32 version;
+		u32 chunkCount;
+		u32 assetCount;
+	};
+
+	struct PackChunk {
+		u32 tag;
+		u32 reserved;
+		u64 offset;
+		u64 size;
+	};
+
+	struct PackTocEntry {
+		UUID id;
+		u64 offset;
+		u64 size;
+		u32 nameOffset;
+		u32 nameLength;
+	};
+
+	/*
+	* the id of an asset built from a loose file, a name based uuid made from its path relative
+	* to the directory it was packed from, with forward slashes
+	*/
+	UUID makeAssetId(std::string_view name);
+
+	/**
+	 * @brief A read-only pack of assets, mapped into memory.
+	 *
+	 * Opening a pack only maps it and checks its header and chunk table, so it costs the
+	 * same whatever the pack holds. Finding an asset is one probe of the table of contents
+	 * in the common case, and hands out a view of the asset's bytes in the mapping without
+	 * copying them. Views stay valid for the pack's lifetime.
+	 */
+	class AssetPack : NonCopyable
+	{
+		Box<MappedFile> file_{};
+		std::span<const PackTocEntry> toc_{};
+		std::span<const PackChunk> chunks_{};
+		std::string_view names_{};
+		u32 assetCount_ = 0;
+
+		AssetPack() = default;
+
+		const PackTocEntry* findEntry(const UUID& id) const;
+
+	public:
+		static Expected<Box<AssetPack>> open(const std::filesystem::path& path);
+
+		~AssetPack();
+
+		/*
+		* the asset's bytes, or nothing when the pack doesn't have it
+		*/
+		std::optional<std::span<const std::byte>> find(const UUID& id) const;
+
+		/*
+		* the name the asset was packed under, empty when the pack doesn't have it
+		*/
+		std::string_view getName(const UUID& id) const;
+
+		/*
+		* a whole chunk by its tag, empty when the pack has none
+		*/
+		std::span<const std::byte> getChunk(FourCC tag) const;
+
+		u32 getAssetCount() const { return assetCount_; }
+
+		/*
+		* visits the id of every asset in the pack, in table order
+		*/
+		template<typename F>
+		void forEach(F&& fn) const {
+			for (auto const& entry : toc_) {
+				if (!(entry.id == UUID{})) {
+					fn(entry.id);
+				}
+			}
+		}
+	};
+
+	/**
+	 * @brief Collects assets in memory and writes them out as a pack.
+	 */
+	class AssetPackBuilder : NonCopyable
+	{
+		struct Asset {
+			UUID id;
+			std::string name;
+			std::vector<std::byte> data;
+		};
+
+		std::vector<Asset> assets_{};
+		UUIDMap<u32> indices_{};
+
+	public:
+		Expected<void> add(const UUID& id, std::string name, std::vector<std::byte>&& data);
+
+		size_t getAssetCount() const { return assets_.size(); }
+
+		/*
+		* writes the pack next to path and renames it over path, so a reader never sees half a pack
+		*/
+		Expected<void> write(const std::filesystem::path& path) const;
+	};
+}
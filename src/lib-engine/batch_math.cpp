@@ -0,0 +1,268 @@
+#include "batch_math.hpp"
+#include "batch_math_kernels.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+
+#if defined(QF_BATCH_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(GLM_FORCE_QUAT_DATA_WXYZ)
+#error "the batch kernels read quaternions as xyzw"
+#endif
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "the batch kernels read glm::vec3 as packed floats");
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "the batch kernels read glm::mat4 as packed floats");
+static_assert(sizeof(glm::quat) == 4 * sizeof(float), "the batch kernels read glm::quat as packed floats");
+
+namespace qf::batch
+{
+	namespace detail
+	{
+		namespace
+		{
+			void transformPoints(const float* m, const float* in, float* out, size_t count) {
+				for (size_t i = 0; i != count; ++i, in += 3, out += 3) {
+					const float x = in[0], y = in[1], z = in[2];
+					out[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+					out[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+					out[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+				}
+			}
+
+			void transformVectors(const float* m, const float* in, float* out, size_t count) {
+				for (size_t i = 0; i != count; ++i, in += 3, out += 3) {
+					const float x = in[0], y = in[1], z = in[2];
+					out[0] = m[0] * x + m[4] * y + m[8] * z;
+					out[1] = m[1] * x + m[5] * y + m[9] * z;
+					out[2] = m[2] * x + m[6] * y + m[10] * z;
+				}
+			}
+
+			void multiplyMatrices(const float* a, const float* b, float* out, size_t count) {
+				for (size_t i = 0; i != count; ++i, a += 16, b += 16, out += 16) {
+					float result[16];
+					for (int column = 0; column != 4; ++column) {
+						for (int row = 0; row != 4; ++row) {
+							result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1]
+								+ a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+						}
+					}
+					std::copy(result, result + 16, out);
+				}
+			}
+
+			void quatsToMatrices(const float* quats, float* out, size_t count) {
+				for (size_t i = 0; i != count; ++i, quats += 4, out += 16) {
+					const float x = quats[0], y = quats[1], z = quats[2], w = quats[3];
+					const float xx = x * x, yy = y * y, zz = z * z;
+					const float xy = x * y, xz = x * z, yz = y * z;
+					const float wx = w * x, wy = w * y, wz = w * z;
+					const float m[16] = {
+						1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0,
+						2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0,
+						2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0,
+						0, 0, 0, 1,
+					};
+					std::copy(m, m + 16, out);
+				}
+			}
+
+			void dot(const float* ax, const float* ay, const float* az,
+				const float* bx, const float* by, const float* bz, float* out, size_t count) {
+				for (size_t i = 0; i != count; ++i) {
+					out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+				}
+			}
+
+			void normalize(float* x, float* y, float* z, size_t count) {
+				for (size_t i = 0; i != count; ++i) {
+					const float lengthSquared = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+					const float scale = lengthSquared > 0 ? 1 / std::sqrt(lengthSquared) : 0;
+					x[i] *= scale;
+					y[i] *= scale;
+					z[i] *= scale;
+				}
+			}
+		}
+
+		const Kernels SCALAR_KERNELS{
+			.transformPoints = transformPoints,
+			.transformVectors = transformVectors,
+			.multiplyMatrices = multiplyMatrices,
+			.quatsToMatrices = quatsToMatrices,
+			.dot = dot,
+			.normalize = normalize,
+		};
+	}
+
+	namespace
+	{
+		Isa detectIsa() {
+#if defined(QF_BATCH_X86)
+			auto cpuid = [](int leaf, int subleaf, int regs[4]) {
+#if defined(_MSC_VER)
+				__cpuidex(regs, leaf, subleaf);
+#else
+				unsigned a, b, c, d;
+				__cpuid_count(leaf, subleaf, a, b, c, d);
+				regs[0] = a, regs[1] = b, regs[2] = c, regs[3] = d;
+#endif
+			};
+			// the os has to save the ymm registers too, which xgetbv reports
+			auto osSavesYmm = [] {
+#if defined(_MSC_VER)
+				return (_xgetbv(0) & 6) == 6;
+#else
+				unsigned lo, hi;
+				__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+				return (lo & 6) == 6;
+#endif
+			};
+
+			int regs[4];
+			cpuid(0, 0, regs);
+			const int maxLeaf = regs[0];
+			cpuid(1, 0, regs);
+			const bool sse41 = regs[2] & (1 << 19);
+			const bool fma = regs[2] & (1 << 12);
+			const bool osxsave = regs[2] & (1 << 27);
+			const bool avx = regs[2] & (1 << 28);
+			bool avx2 = false;
+			if (maxLeaf >= 7) {
+				cpuid(7, 0, regs);
+				avx2 = regs[1] & (1 << 5);
+			}
+			if (avx && avx2 && fma && osxsave && osSavesYmm()) {
+				return Isa::Avx2;
+			}
+			if (sse41) {
+				return Isa::Sse4;
+			}
+#endif
+			return Isa::Scalar;
+		}
+
+		const detail::Kernels& getKernels(Isa isa) {
+			switch (isa) {
+#if defined(QF_BATCH_X86)
+			case Isa::Avx2:
+				return detail::AVX2_KERNELS;
+			case Isa::Sse4:
+				return detail::SSE4_KERNELS;
+#endif
+			default:
+				return detail::SCALAR_KERNELS;
+			}
+		}
+
+		struct Dispatch {
+			Isa supported;
+			std::atomic<Isa> isa;
+			std::atomic<const detail::Kernels*> kernels;
+
+			Dispatch()
+				: supported(detectIsa()), isa(supported), kernels(&getKernels(supported))
+			{
+				log::info("batch math: {}", getIsaName(supported));
+			}
+		};
+
+		Dispatch& dispatch() {
+			static Dispatch d;
+			return d;
+		}
+
+		const detail::Kernels& kernels() {
+			return *dispatch().kernels.load(std::memory_order_relaxed);
+		}
+
+		const float* floats(const void* p) {
+			return static_cast<const float*>(p);
+		}
+
+		float* floats(void* p) {
+			return static_cast<float*>(p);
+		}
+	}
+
+	Isa getIsa()
+	{
+		return dispatch().isa.load(std::memory_order_relaxed);
+	}
+
+	Isa getSupportedIsa()
+	{
+		return dispatch().supported;
+	}
+
+	Expected<void> setIsa(Isa isa)
+	{
+		auto& d = dispatch();
+		if (isa > d.supported) {
+			return std::unexpected(std::format("the cpu doesn't have {}", getIsaName(isa)));
+		}
+		d.isa.store(isa, std::memory_order_relaxed);
+		d.kernels.store(&getKernels(isa), std::memory_order_relaxed);
+		return {};
+	}
+
+	std::string_view getIsaName(Isa isa)
+	{
+		switch (isa) {
+		case Isa::Avx2:
+			return "avx2";
+		case Isa::Sse4:
+			return "sse4.1";
+		default:
+			return "scalar";
+		}
+	}
+
+	void transformPoints(const glm::mat4& m, std::span<const glm::vec3> points, std::span<glm::vec3> out)
+	{
+		assert(out.size() >= points.size());
+		kernels().transformPoints(floats(&m), floats(points.data()), floats(out.data()), points.size());
+	}
+
+	void transformVectors(const glm::mat4& m, std::span<const glm::vec3> vectors, std::span<glm::vec3> out)
+	{
+		assert(out.size() >= vectors.size());
+		kernels().transformVectors(floats(&m), floats(vectors.data()), floats(out.data()), vectors.size());
+	}
+
+	void multiplyMatrices(std::span<const glm::mat4> a, std::span<const glm::mat4> b, std::span<glm::mat4> out)
+	{
+		assert(b.size() == a.size() && out.size() >= a.size());
+		kernels().multiplyMatrices(floats(a.data()), floats(b.data()), floats(out.data()), a.size());
+	}
+
+	void quatsToMatrices(std::span<const glm::quat> quats, std::span<glm::mat4> out)
+	{
+		assert(out.size() >= quats.size());
+		kernels().quatsToMatrices(floats(quats.data()), floats(out.data()), quats.size());
+	}
+
+	void dot(std::span<const float> ax, std::span<const float> ay, std::span<const float> az,
+		std::span<const float> bx, std::span<const float> by, std::span<const float> bz, std::span<float> out)
+	{
+		const size_t count = ax.size();
+		assert(ay.size() == count && az.size() == count && bx.size() == count && by.size() == count && bz.size() == count);
+		assert(out.size() >= count);
+		kernels().dot(ax.data(), ay.data(), az.data(), bx.data(), by.data(), bz.data(), out.data(), count);
+	}
+
+	void normalize(std::span<float> x, std::span<float> y, std::span<float> z)
+	{
+		assert(y.size() == x.size() && z.size() == x.size());
+		kernels().normalize(x.data(), y.data(), z.data(), x.size());
+	}
+}
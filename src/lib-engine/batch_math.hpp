@@ -0,0 +1,83 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <span>
+#include <string_view>
+
+namespace qf
+{
+	/**
+	 * @brief glm math over whole arrays, with SSE4.1 and AVX2 kernels.
+	 *
+	 * Every function runs the kernel for the best instruction set the cpu has, found with
+	 * cpuid the first time one is called, and falls back to plain C++. The kernels work on
+	 * the arrays as glm lays them out, except the dot product and normalize, which take
+	 * structure-of-arrays streams of x, y and z.
+	 *
+	 * Outputs must be at least as long as the inputs and can be the inputs themselves.
+	 * The vector kernels round differently from the scalar code: normalize uses an
+	 * approximate reciprocal square root refined once, within a few ulp of the exact one.
+	 */
+	namespace batch
+	{
+		enum class Isa : u8 {
+			Scalar,
+			Sse4,
+			Avx2,
+		};
+
+		/*
+		* the instruction set the kernels use
+		*/
+		Isa getIsa();
+
+		/*
+		* the best instruction set the cpu has
+		*/
+		Isa getSupportedIsa();
+
+		/*
+		* runs the kernels for another instruction set, to compare them. fails when the cpu
+		* doesn't have it
+		*/
+		Expected<void> setIsa(Isa isa);
+
+		std::string_view getIsaName(Isa isa);
+
+		/*
+		* out[i] = m * vec4(points[i], 1), without dividing by w
+		*/
+		void transformPoints(const glm::mat4& m, std::span<const glm::vec3> points, std::span<glm::vec3> out);
+
+		/*
+		* out[i] = m * vec4(vectors[i], 0)
+		*/
+		void transformVectors(const glm::mat4& m, std::span<const glm::vec3> vectors, std::span<glm::vec3> out);
+
+		/*
+		* out[i] = a[i] * b[i]
+		*/
+		void multiplyMatrices(std::span<const glm::mat4> a, std::span<const glm::mat4> b, std::span<glm::mat4> out);
+
+		/*
+		* out[i] = glm::mat4_cast(quats[i]) for unit quaternions
+		*/
+		void quatsToMatrices(std::span<const glm::quat> quats, std::span<glm::mat4> out);
+
+		/*
+		* out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i]
+		*/
+		void dot(std::span<const float> ax, std::span<const float> ay, std::span<const float> az,
+			std::span<const float> bx, std::span<const float> by, std::span<const float> bz, std::span<float> out);
+
+		/*
+		* scales every vector to unit length in place. zero vectors stay zero
+		*/
+		void normalize(std::span<float> x, std::span<float> y, std::span<float> z);
+	}
+}
@@ -0,0 +1,186 @@
+#include "batch_math_kernels.hpp"
+
+#if defined(QF_BATCH_X86)
+
+#include <immintrin.h>
+
+/*
+* eight elements at a time, with the rest left to the scalar kernels. built with AVX2 and
+* FMA enabled and only called once cpuid has found both
+*/
+namespace qf::batch::detail
+{
+	namespace
+	{
+		/*
+		* loadXyz4 from the sse4 kernels on two groups of four points at once, points 0-3 in
+		* the low lanes and 4-7 in the high lanes
+		*/
+		inline void loadXyz8(const float* p, __m256& x, __m256& y, __m256& z) {
+			const __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+			const __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+			const __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+			const __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+			const __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+			x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		inline void storeXyz8(float* p, __m256 x, __m256 y, __m256 z) {
+			const __m256 xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+			const __m256 r03 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m256 r14 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			const __m256 r25 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(p, _mm256_castps256_ps128(r03));
+			_mm_storeu_ps(p + 4, _mm256_castps256_ps128(r14));
+			_mm_storeu_ps(p + 8, _mm256_castps256_ps128(r25));
+			_mm_storeu_ps(p + 12, _mm256_extractf128_ps(r03, 1));
+			_mm_storeu_ps(p + 16, _mm256_extractf128_ps(r14, 1));
+			_mm_storeu_ps(p + 20, _mm256_extractf128_ps(r25, 1));
+		}
+
+		/*
+		* transposes the 4x4 in each half
+		*/
+		inline void transpose(__m256& a, __m256& b, __m256& c, __m256& d) {
+			const __m256 t0 = _mm256_unpacklo_ps(a, b);
+			const __m256 t1 = _mm256_unpackhi_ps(a, b);
+			const __m256 t2 = _mm256_unpacklo_ps(c, d);
+			const __m256 t3 = _mm256_unpackhi_ps(c, d);
+			a = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+			b = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+			c = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			d = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		inline __m256 load2(const float* low, const float* high) {
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+		}
+
+		inline void store2(float* low, float* high, __m256 v) {
+			_mm_storeu_ps(low, _mm256_castps256_ps128(v));
+			_mm_storeu_ps(high, _mm256_extractf128_ps(v, 1));
+		}
+
+		template<bool POINTS>
+		void transform(const float* m, const float* in, float* out, size_t count) {
+			const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+			const __m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6 = _mm256_set1_ps(m[6]);
+			const __m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+			const __m256 m12 = _mm256_set1_ps(POINTS ? m[12] : 0), m13 = _mm256_set1_ps(POINTS ? m[13] : 0), m14 = _mm256_set1_ps(POINTS ? m[14] : 0);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x, y, z;
+				loadXyz8(in + i * 3, x, y, z);
+				const __m256 ox = _mm256_fmadd_ps(m0, x, _mm256_fmadd_ps(m4, y, _mm256_fmadd_ps(m8, z, m12)));
+				const __m256 oy = _mm256_fmadd_ps(m1, x, _mm256_fmadd_ps(m5, y, _mm256_fmadd_ps(m9, z, m13)));
+				const __m256 oz = _mm256_fmadd_ps(m2, x, _mm256_fmadd_ps(m6, y, _mm256_fmadd_ps(m10, z, m14)));
+				storeXyz8(out + i * 3, ox, oy, oz);
+			}
+			(POINTS ? SCALAR_KERNELS.transformPoints : SCALAR_KERNELS.transformVectors)(m, in + i * 3, out + i * 3, count - i);
+		}
+
+		void transformPoints(const float* m, const float* in, float* out, size_t count) {
+			transform<true>(m, in, out, count);
+		}
+
+		void transformVectors(const float* m, const float* in, float* out, size_t count) {
+			transform<false>(m, in, out, count);
+		}
+
+		/*
+		* two columns of the result at a time, one in each half
+		*/
+		void multiplyMatrices(const float* a, const float* b, float* out, size_t count) {
+			for (size_t i = 0; i != count; ++i, a += 16, b += 16, out += 16) {
+				const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+				const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+				const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+				const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+				const __m256 b01 = _mm256_loadu_ps(b);
+				const __m256 b23 = _mm256_loadu_ps(b + 8);
+				auto column = [&](__m256 bc) {
+					return _mm256_fmadd_ps(a0, _mm256_shuffle_ps(bc, bc, 0x00), _mm256_fmadd_ps(a1, _mm256_shuffle_ps(bc, bc, 0x55),
+						_mm256_fmadd_ps(a2, _mm256_shuffle_ps(bc, bc, 0xaa), _mm256_mul_ps(a3, _mm256_shuffle_ps(bc, bc, 0xff)))));
+				};
+				const __m256 c01 = column(b01);
+				const __m256 c23 = column(b23);
+				_mm256_storeu_ps(out, c01);
+				_mm256_storeu_ps(out + 8, c23);
+			}
+		}
+
+		void quatsToMatrices(const float* quats, float* out, size_t count) {
+			const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+			const __m128 lastColumn = _mm_setr_ps(0, 0, 0, 1);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				// quaternions 0-3 in the low halves and 4-7 in the high halves
+				const float* q = quats + i * 4;
+				__m256 x = load2(q, q + 16), y = load2(q + 4, q + 20), z = load2(q + 8, q + 24), w = load2(q + 12, q + 28);
+				transpose(x, y, z, w);
+				const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+				const __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+				const __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+				__m256 columns[3][4] = {
+					{ _mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), _mm256_mul_ps(two, _mm256_add_ps(xy, wz)), _mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), _mm256_setzero_ps() },
+					{ _mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), _mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), _mm256_mul_ps(two, _mm256_add_ps(yz, wx)), _mm256_setzero_ps() },
+					{ _mm256_mul_ps(two, _mm256_add_ps(xz, wy)), _mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), _mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), _mm256_setzero_ps() },
+				};
+				float* matrices = out + i * 16;
+				for (int c = 0; c != 3; ++c) {
+					transpose(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+					for (int k = 0; k != 4; ++k) {
+						store2(matrices + k * 16 + c * 4, matrices + (k + 4) * 16 + c * 4, columns[c][k]);
+					}
+				}
+				for (int k = 0; k != 8; ++k) {
+					_mm_storeu_ps(matrices + k * 16 + 12, lastColumn);
+				}
+			}
+			SCALAR_KERNELS.quatsToMatrices(quats + i * 4, out + i * 16, count - i);
+		}
+
+		void dot(const float* ax, const float* ay, const float* az,
+			const float* bx, const float* by, const float* bz, float* out, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				const __m256 d = _mm256_fmadd_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i),
+					_mm256_fmadd_ps(_mm256_loadu_ps(ay + i), _mm256_loadu_ps(by + i), _mm256_mul_ps(_mm256_loadu_ps(az + i), _mm256_loadu_ps(bz + i))));
+				_mm256_storeu_ps(out + i, d);
+			}
+			SCALAR_KERNELS.dot(ax + i, ay + i, az + i, bx + i, by + i, bz + i, out + i, count - i);
+		}
+
+		void normalize(float* x, float* y, float* z, size_t count) {
+			const __m256 half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				const __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+				const __m256 lengthSquared = _mm256_fmadd_ps(vx, vx, _mm256_fmadd_ps(vy, vy, _mm256_mul_ps(vz, vz)));
+				__m256 r = _mm256_rsqrt_ps(lengthSquared);
+				r = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(half, lengthSquared), _mm256_mul_ps(r, r), threeHalves));
+				r = _mm256_and_ps(r, _mm256_cmp_ps(lengthSquared, _mm256_setzero_ps(), _CMP_GT_OQ));
+				_mm256_storeu_ps(x + i, _mm256_mul_ps(vx, r));
+				_mm256_storeu_ps(y + i, _mm256_mul_ps(vy, r));
+				_mm256_storeu_ps(z + i, _mm256_mul_ps(vz, r));
+			}
+			SCALAR_KERNELS.normalize(x + i, y + i, z + i, count - i);
+		}
+	}
+
+	const Kernels AVX2_KERNELS{
+		.transformPoints = transformPoints,
+		.transformVectors = transformVectors,
+		.multiplyMatrices = multiplyMatrices,
+		.quatsToMatrices = quatsToMatrices,
+		.dot = dot,
+		.normalize = normalize,
+	};
+}
+
+#endif
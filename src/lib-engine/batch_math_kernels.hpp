@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+* the kernels behind batch_math.hpp, one table per instruction set. each table is compiled
+* in its own file with that instruction set enabled, so this header must not pull in
+* anything with inline functions the linker could pick from the wrong file
+*/
+namespace qf::batch::detail
+{
+	struct Kernels {
+		// m is a column major 4x4, points and vectors are packed xyz
+		void (*transformPoints)(const float* m, const float* in, float* out, size_t count);
+		void (*transformVectors)(const float* m, const float* in, float* out, size_t count);
+		void (*multiplyMatrices)(const float* a, const float* b, float* out, size_t count);
+		// quaternions are xyzw
+		void (*quatsToMatrices)(const float* quats, float* out, size_t count);
+		void (*dot)(const float* ax, const float* ay, const float* az,
+			const float* bx, const float* by, const float* bz, float* out, size_t count);
+		void (*normalize)(float* x, float* y, float* z, size_t count);
+	};
+
+	extern const Kernels SCALAR_KERNELS;
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QF_BATCH_X86 1
+	extern const Kernels SSE4_KERNELS;
+	extern const Kernels AVX2_KERNELS;
+#endif
+}
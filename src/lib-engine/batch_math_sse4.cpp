@@ -0,0 +1,163 @@
+#include "batch_math_kernels.hpp"
+
+#if defined(QF_BATCH_X86)
+
+#include <smmintrin.h>
+
+/*
+* four elements at a time, with the rest left to the scalar kernels. built with SSE4.1
+* enabled and only called once cpuid has found it
+*/
+namespace qf::batch::detail
+{
+	namespace
+	{
+		/*
+		* x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 to x0..x3, y0..y3, z0..z3
+		*/
+		inline void loadXyz4(const float* p, __m128& x, __m128& y, __m128& z) {
+			const __m128 m0 = _mm_loadu_ps(p);
+			const __m128 m1 = _mm_loadu_ps(p + 4);
+			const __m128 m2 = _mm_loadu_ps(p + 8);
+			const __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			const __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		inline void storeXyz4(float* p, __m128 x, __m128 y, __m128 z) {
+			const __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_ps(p, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+			_mm_storeu_ps(p + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+
+		inline void transpose(__m128& a, __m128& b, __m128& c, __m128& d) {
+			const __m128 t0 = _mm_unpacklo_ps(a, b);
+			const __m128 t1 = _mm_unpackhi_ps(a, b);
+			const __m128 t2 = _mm_unpacklo_ps(c, d);
+			const __m128 t3 = _mm_unpackhi_ps(c, d);
+			a = _mm_movelh_ps(t0, t2);
+			b = _mm_movehl_ps(t2, t0);
+			c = _mm_movelh_ps(t1, t3);
+			d = _mm_movehl_ps(t3, t1);
+		}
+
+		template<bool POINTS>
+		void transform(const float* m, const float* in, float* out, size_t count) {
+			const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+			const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+			const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+			const __m128 m12 = _mm_set1_ps(POINTS ? m[12] : 0), m13 = _mm_set1_ps(POINTS ? m[13] : 0), m14 = _mm_set1_ps(POINTS ? m[14] : 0);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 x, y, z;
+				loadXyz4(in + i * 3, x, y, z);
+				const __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_add_ps(_mm_mul_ps(m8, z), m12));
+				const __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_add_ps(_mm_mul_ps(m9, z), m13));
+				const __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_add_ps(_mm_mul_ps(m10, z), m14));
+				storeXyz4(out + i * 3, ox, oy, oz);
+			}
+			(POINTS ? SCALAR_KERNELS.transformPoints : SCALAR_KERNELS.transformVectors)(m, in + i * 3, out + i * 3, count - i);
+		}
+
+		void transformPoints(const float* m, const float* in, float* out, size_t count) {
+			transform<true>(m, in, out, count);
+		}
+
+		void transformVectors(const float* m, const float* in, float* out, size_t count) {
+			transform<false>(m, in, out, count);
+		}
+
+		void multiplyMatrices(const float* a, const float* b, float* out, size_t count) {
+			for (size_t i = 0; i != count; ++i, a += 16, b += 16, out += 16) {
+				const __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+				const __m128 b0 = _mm_loadu_ps(b), b1 = _mm_loadu_ps(b + 4), b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+				auto column = [&](__m128 bc) {
+					return _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00)), _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, 0x55))),
+						_mm_add_ps(_mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, 0xaa)), _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, 0xff))));
+				};
+				_mm_storeu_ps(out, column(b0));
+				_mm_storeu_ps(out + 4, column(b1));
+				_mm_storeu_ps(out + 8, column(b2));
+				_mm_storeu_ps(out + 12, column(b3));
+			}
+		}
+
+		void quatsToMatrices(const float* quats, float* out, size_t count) {
+			const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+			const __m128 lastColumn = _mm_setr_ps(0, 0, 0, 1);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 x = _mm_loadu_ps(quats + i * 4), y = _mm_loadu_ps(quats + i * 4 + 4);
+				__m128 z = _mm_loadu_ps(quats + i * 4 + 8), w = _mm_loadu_ps(quats + i * 4 + 12);
+				transpose(x, y, z, w);
+				const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+				const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+				const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+				__m128 columns[3][4] = {
+					{ _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, wz)), _mm_mul_ps(two, _mm_sub_ps(xz, wy)), _mm_setzero_ps() },
+					{ _mm_mul_ps(two, _mm_sub_ps(xy, wz)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), _mm_mul_ps(two, _mm_add_ps(yz, wx)), _mm_setzero_ps() },
+					{ _mm_mul_ps(two, _mm_add_ps(xz, wy)), _mm_mul_ps(two, _mm_sub_ps(yz, wx)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), _mm_setzero_ps() },
+				};
+				// each column holds one row of four matrices, transposed it is one column of each
+				float* matrices = out + i * 16;
+				for (int c = 0; c != 3; ++c) {
+					transpose(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+					for (int k = 0; k != 4; ++k) {
+						_mm_storeu_ps(matrices + k * 16 + c * 4, columns[c][k]);
+					}
+				}
+				for (int k = 0; k != 4; ++k) {
+					_mm_storeu_ps(matrices + k * 16 + 12, lastColumn);
+				}
+			}
+			SCALAR_KERNELS.quatsToMatrices(quats + i * 4, out + i * 16, count - i);
+		}
+
+		void dot(const float* ax, const float* ay, const float* az,
+			const float* bx, const float* by, const float* bz, float* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const __m128 d = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(bx + i)), _mm_mul_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(by + i))),
+					_mm_mul_ps(_mm_loadu_ps(az + i), _mm_loadu_ps(bz + i)));
+				_mm_storeu_ps(out + i, d);
+			}
+			SCALAR_KERNELS.dot(ax + i, ay + i, az + i, bx + i, by + i, bz + i, out + i, count - i);
+		}
+
+		void normalize(float* x, float* y, float* z, size_t count) {
+			const __m128 half = _mm_set1_ps(0.5f), threeHalves = _mm_set1_ps(1.5f);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+				const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+				// one newton step takes the 12 bit estimate to nearly full precision
+				__m128 r = _mm_rsqrt_ps(lengthSquared);
+				r = _mm_mul_ps(r, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSquared), _mm_mul_ps(r, r))));
+				r = _mm_blendv_ps(_mm_setzero_ps(), r, _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps()));
+				_mm_storeu_ps(x + i, _mm_mul_ps(vx, r));
+				_mm_storeu_ps(y + i, _mm_mul_ps(vy, r));
+				_mm_storeu_ps(z + i, _mm_mul_ps(vz, r));
+			}
+			SCALAR_KERNELS.normalize(x + i, y + i, z + i, count - i);
+		}
+	}
+
+	const Kernels SSE4_KERNELS{
+		.transformPoints = transformPoints,
+		.transformVectors = transformVectors,
+		.multiplyMatrices = multiplyMatrices,
+		.quatsToMatrices = quatsToMatrices,
+		.dot = dot,
+		.normalize = normalize,
+	};
+}
+
+#endif
@@ -15,7 +15,7 @@ namespace qf
 	class TClassFactory : public AbstractClassFactory
 	{
 		virtual ptr<Serializable> create() const override {
-			auto obj = std::make_shared<T>();
+			auto obj = makeShared<T>();
 			if (obj) {
 				if (auto res = obj->postConstruct(); res.has_value()) {
 					return obj;
@@ -4,5 +4,18 @@
 
 namespace qf
 {
-	constexpr UUID Sdl2PlatformInterfaceClassId("b7e7852c-35a1-4502-b4eb-231876ab7ed4");
+	inline constexpr UUID Sdl2PlatformInterfaceClassId("b7e7852c-35a1-4502-b4eb-231876ab7ed4");
+	inline constexpr UUID HeadlessPlatformInterfaceClassId("d3a85f10-6c2b-4e97-a1f4-87b0c5e2d619");
+	inline constexpr UUID WorkStealingJobSystemClassId("4f0c2d7e-9a61-4b3e-8d25-1c7f60e9a3b2");
+	inline constexpr UUID AsyncIoSystemClassId("8e2b6c41-0d7f-4a93-b5e8-3f19c6a7d240");
 }
+
+/*
+* every class id built into the engine's compile time class registry. each one needs an
+* IMPLEMENT_CLASS_FACTORY_UUID(Class, Id) in the translation unit that defines the class
+*/
+#define QF_FOR_EACH_CLASS_ID(X) \
+	X(Sdl2PlatformInterfaceClassId) \
+	X(HeadlessPlatformInterfaceClassId) \
+	X(WorkStealingJobSystemClassId) \
+	X(AsyncIoSystemClassId)
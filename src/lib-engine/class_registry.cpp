@@ -0,0 +1,81 @@
+#include "class_registry.hpp"
+#include "class_ids.hpp"
+
+#include <array>
+#include <bit>
+
+namespace qf
+{
+	// the create functions are defined by IMPLEMENT_CLASS_FACTORY_UUID next to each class
+#define QF_DECLARE_CLASS_FACTORY(ID) \
+	template<> ptr<Serializable> internalCreateInstanceById<ID>();
+	QF_FOR_EACH_CLASS_ID(QF_DECLARE_CLASS_FACTORY)
+#undef QF_DECLARE_CLASS_FACTORY
+}
+
+namespace
+{
+	using qf::ClassRegistry;
+
+	constexpr ClassRegistry::Entry CLASSES[] = {
+#define QF_CLASS_ENTRY(ID) ClassRegistry::Entry{ qf::ID, &qf::internalCreateInstanceById<qf::ID> },
+		QF_FOR_EACH_CLASS_ID(QF_CLASS_ENTRY)
+#undef QF_CLASS_ENTRY
+	};
+
+	constexpr size_t CLASS_COUNT = std::size(CLASSES);
+
+	/*
+	* at most half full, so a seed without collisions turns up after a few tries
+	*/
+	constexpr size_t TABLE_SIZE = std::bit_ceil(CLASS_COUNT * 2);
+
+	constexpr size_t MAX_SEED_TRIES = 1 << 16;
+
+	struct Table {
+		bool found = false;
+		qf::u64 seed = 0;
+		std::array<ClassRegistry::Entry, TABLE_SIZE> slots{};
+	};
+
+	constexpr Table buildTable() {
+		for (qf::u64 seed = 0; seed != MAX_SEED_TRIES; ++seed) {
+			Table table{ .found = true, .seed = seed };
+			bool collided = false;
+			for (auto const& entry : CLASSES) {
+				auto& slot = table.slots[ClassRegistry::hash(entry.id, seed) & (TABLE_SIZE - 1)];
+				if (slot.create) {
+					collided = true;
+					break;
+				}
+				slot = entry;
+			}
+			if (!collided) {
+				return table;
+			}
+		}
+		return {};
+	}
+
+	constexpr Table TABLE = buildTable();
+
+	static_assert(TABLE.found,
+		"no perfect hash seed found for the class ids, two of them are probably the same");
+}
+
+namespace qf
+{
+	auto ClassRegistry::find(const UUID& clsid) -> CreateFn
+	{
+		auto const& slot = TABLE.slots[hash(clsid, TABLE.seed) & (TABLE_SIZE - 1)];
+		if (slot.id == clsid) {
+			return slot.create;
+		}
+		return nullptr;
+	}
+
+	size_t ClassRegistry::getClassCount()
+	{
+		return CLASS_COUNT;
+	}
+}
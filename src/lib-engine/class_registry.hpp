@@ -0,0 +1,35 @@
+#pragma once
+
+#include "engine80.hpp"
+
+namespace qf
+{
+	/**
+	 * @brief Compile time table of the engine's built-in classes.
+	 *
+	 * The classes listed in QF_FOR_EACH_CLASS_ID are put in a perfect hash table when the
+	 * engine is compiled, so the table needs no initialization at startup and finding a
+	 * class is one hash, one indexed load and one id compare, followed by a direct call.
+	 */
+	class ClassRegistry
+	{
+	public:
+		using CreateFn = ptr<Serializable>(*)();
+
+		struct Entry {
+			UUID id{};
+			CreateFn create{};
+		};
+
+		static constexpr u64 hash(const UUID& id, u64 seed) {
+			return detail::mix64(id.high() ^ detail::mix64(id.low() ^ seed));
+		}
+
+		/*
+		* the create function of a built-in class, nullptr if clsid isn't one
+		*/
+		static CreateFn find(const UUID& clsid);
+
+		static size_t getClassCount();
+	};
+}
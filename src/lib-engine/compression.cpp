@@ -0,0 +1,286 @@
+#include "compression.hpp"
+#include "job_system.hpp"
+#include "profiler.hpp"
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <mutex>
+#include <optional>
+
+namespace qf
+{
+	namespace
+	{
+		/*
+		* one decompression context per thread, so zstd doesn't allocate one for every chunk
+		*/
+		struct ZstdContext : NonCopyable {
+			ZSTD_DCtx* dctx = ZSTD_createDCtx();
+
+			~ZstdContext() { ZSTD_freeDCtx(dctx); }
+		};
+
+		Expected<size_t> compressChunk(Codec codec, int level, std::span<const std::byte> in, std::span<std::byte> out) {
+			switch (codec) {
+			case Codec::Lz4: {
+				const int size = LZ4_compress_default(reinterpret_cast<const char*>(in.data()), reinterpret_cast<char*>(out.data()),
+					static_cast<int>(in.size()), static_cast<int>(out.size()));
+				if (size <= 0) {
+					return std::unexpected("lz4 compression failed");
+				}
+				return static_cast<size_t>(size);
+			}
+			case Codec::Zstd: {
+				const size_t size = ZSTD_compress(out.data(), out.size(), in.data(), in.size(), level != 0 ? level : ZSTD_CLEVEL_DEFAULT);
+				if (ZSTD_isError(size)) {
+					return std::unexpected(std::format("zstd compression failed: {}", ZSTD_getErrorName(size)));
+				}
+				return size;
+			}
+			case Codec::None:
+				break;
+			}
+			return std::unexpected("unknown codec");
+		}
+
+		size_t getCompressBound(Codec codec, size_t size) {
+			switch (codec) {
+			case Codec::Lz4:
+				return static_cast<size_t>(LZ4_compressBound(static_cast<int>(size)));
+			case Codec::Zstd:
+				return ZSTD_compressBound(size);
+			case Codec::None:
+				break;
+			}
+			return size;
+		}
+	}
+
+	Expected<std::vector<std::byte>> compress(std::span<const std::byte> data, const CompressSettings& settings)
+	{
+		QF_PROFILE_ZONE("compress");
+		if (settings.chunkSize == 0 || settings.chunkSize > INT_MAX / 2) {
+			return std::unexpected(std::format("chunk size {} is out of range", settings.chunkSize));
+		}
+		const u64 chunkCount = (data.size() + settings.chunkSize - 1) / settings.chunkSize;
+		if (chunkCount > UINT32_MAX) {
+			return std::unexpected("too much data for one compressed block");
+		}
+
+		const CompressedHeader header{
+			.magic = COMPRESSED_MAGIC.getint(),
+			.version = COMPRESSED_VERSION,
+			.rawSize = data.size(),
+			.chunkSize = settings.chunkSize,
+			.chunkCount = static_cast<u32>(chunkCount),
+		};
+		std::vector<CompressedChunk> chunks(chunkCount);
+		const size_t tableSize = sizeof(header) + chunkCount * sizeof(CompressedChunk);
+		std::vector<std::byte> out(tableSize);
+		out.reserve(tableSize + data.size() / 2);
+
+		std::vector<std::byte> scratch(getCompressBound(settings.codec, settings.chunkSize));
+		for (u64 i = 0; i != chunkCount; ++i) {
+			const auto raw = data.subspan(i * settings.chunkSize, std::min<size_t>(settings.chunkSize, data.size() - i * settings.chunkSize));
+			chunks[i] = CompressedChunk{ .offset = out.size(), .size = static_cast<u32>(raw.size()), .codec = Codec::None, .reserved = {} };
+			if (settings.codec != Codec::None) {
+				auto size = compressChunk(settings.codec, settings.level, raw, scratch);
+				if (!size.has_value()) {
+					return std::unexpected(size.error());
+				}
+				// a chunk that doesn't shrink is stored as is, so it costs a copy to read
+				if (size.value() < raw.size()) {
+					chunks[i].size = static_cast<u32>(size.value());
+					chunks[i].codec = settings.codec;
+					out.insert(out.end(), scratch.begin(), scratch.begin() + size.value());
+					continue;
+				}
+			}
+			out.insert(out.end(), raw.begin(), raw.end());
+		}
+
+		std::memcpy(out.data(), &header, sizeof(header));
+		std::memcpy(out.data() + sizeof(header), chunks.data(), chunkCount * sizeof(CompressedChunk));
+		return out;
+	}
+
+	bool CompressedBlock::isCompressed(std::span<const std::byte> data)
+	{
+		u32 magic = 0;
+		if (data.size() < sizeof(CompressedHeader)) {
+			return false;
+		}
+		std::memcpy(&magic, data.data(), sizeof(magic));
+		return magic == COMPRESSED_MAGIC.getint();
+	}
+
+	Expected<CompressedBlock> CompressedBlock::open(std::span<const std::byte> data)
+	{
+		if (!isCompressed(data)) {
+			return std::unexpected("not a compressed block");
+		}
+		CompressedHeader header;
+		std::memcpy(&header, data.data(), sizeof(header));
+		if (header.version != COMPRESSED_VERSION) {
+			return std::unexpected(std::format("compressed block is version {}, expected {}", header.version, COMPRESSED_VERSION));
+		}
+		if (header.chunkSize == 0 || header.chunkCount != (header.rawSize + header.chunkSize - 1) / header.chunkSize) {
+			return std::unexpected("compressed block has a damaged header");
+		}
+		if ((data.size() - sizeof(header)) / sizeof(CompressedChunk) < header.chunkCount) {
+			return std::unexpected("compressed block is truncated");
+		}
+
+		CompressedBlock block;
+		block.data_ = data;
+		block.rawSize_ = header.rawSize;
+		block.chunkSize_ = header.chunkSize;
+		block.chunkCount_ = header.chunkCount;
+		return block;
+	}
+
+	/*
+	* the table isn't necessarily aligned, blocks can sit anywhere in an asset
+	*/
+	CompressedChunk CompressedBlock::getChunk(u32 index) const
+	{
+		CompressedChunk chunk;
+		std::memcpy(&chunk, data_.data() + sizeof(CompressedHeader) + index * sizeof(CompressedChunk), sizeof(chunk));
+		return chunk;
+	}
+
+	u32 CompressedBlock::getChunkRawSize(u32 index) const
+	{
+		return static_cast<u32>(std::min<u64>(chunkSize_, rawSize_ - u64(index) * chunkSize_));
+	}
+
+	Expected<void> CompressedBlock::decompressChunk(u32 index, std::span<std::byte> out) const
+	{
+		return decodeChunk(index, out, index < chunkCount_ ? getChunkRawSize(index) : 0);
+	}
+
+	Expected<void> CompressedBlock::decodeChunk(u32 index, std::span<std::byte> out, u32 wanted) const
+	{
+		if (index >= chunkCount_) {
+			return std::unexpected(std::format("chunk {} is out of range", index));
+		}
+		const u32 rawSize = getChunkRawSize(index);
+		if (out.size() < rawSize) {
+			return std::unexpected(std::format("chunk {} needs {} bytes", index, rawSize));
+		}
+		const CompressedChunk chunk = getChunk(index);
+		if (chunk.offset > data_.size() || data_.size() - chunk.offset < chunk.size) {
+			return std::unexpected(std::format("chunk {} is out of bounds", index));
+		}
+		const auto in = data_.subspan(chunk.offset, chunk.size);
+
+		switch (chunk.codec) {
+		case Codec::None:
+			if (in.size() != rawSize) {
+				return std::unexpected(std::format("chunk {} is damaged", index));
+			}
+			std::memcpy(out.data(), in.data(), rawSize);
+			return {};
+		case Codec::Lz4: {
+			if (wanted < rawSize) {
+				// lz4 can stop once it has decoded enough, zstd always decodes a whole chunk
+				const int size = LZ4_decompress_safe_partial(reinterpret_cast<const char*>(in.data()), reinterpret_cast<char*>(out.data()),
+					static_cast<int>(in.size()), static_cast<int>(wanted), static_cast<int>(rawSize));
+				if (size < 0 || static_cast<u32>(size) < wanted) {
+					return std::unexpected(std::format("chunk {} is damaged", index));
+				}
+				return {};
+			}
+			const int size = LZ4_decompress_safe(reinterpret_cast<const char*>(in.data()), reinterpret_cast<char*>(out.data()),
+				static_cast<int>(in.size()), static_cast<int>(rawSize));
+			if (size < 0 || static_cast<u32>(size) != rawSize) {
+				return std::unexpected(std::format("chunk {} is damaged", index));
+			}
+			return {};
+		}
+		case Codec::Zstd: {
+			thread_local ZstdContext context;
+			const size_t size = ZSTD_decompressDCtx(context.dctx, out.data(), rawSize, in.data(), in.size());
+			if (ZSTD_isError(size)) {
+				return std::unexpected(std::format("chunk {} is damaged: {}", index, ZSTD_getErrorName(size)));
+			}
+			if (size != rawSize) {
+				return std::unexpected(std::format("chunk {} is damaged", index));
+			}
+			return {};
+		}
+		}
+		return std::unexpected(std::format("chunk {} has an unknown codec", index));
+	}
+
+	Expected<void> CompressedBlock::decompress(std::span<std::byte> out) const
+	{
+		QF_PROFILE_ZONE("CompressedBlock::decompress");
+		if (out.size() < rawSize_) {
+			return std::unexpected(std::format("decompressing needs {} bytes", rawSize_));
+		}
+		for (u32 i = 0; i != chunkCount_; ++i) {
+			TRY_EXPR_IGNORE_VALUE(decompressChunk(i, out.subspan(u64(i) * chunkSize_)));
+		}
+		return {};
+	}
+
+	Expected<void> CompressedBlock::decompress(jobs::JobSystem& jobs, std::span<std::byte> out) const
+	{
+		QF_PROFILE_ZONE("CompressedBlock::decompress");
+		if (out.size() < rawSize_) {
+			return std::unexpected(std::format("decompressing needs {} bytes", rawSize_));
+		}
+
+		// every chunk writes its own part of out, so only the first error needs a lock
+		std::mutex mutex;
+		std::optional<Err> error;
+		std::atomic<bool> failed = false;
+		jobs.parallelFor(0, chunkCount_, 1, [&](u32 first, u32 last) {
+			for (u32 i = first; i != last && !failed.load(std::memory_order_relaxed); ++i) {
+				if (auto res = decompressChunk(i, out.subspan(u64(i) * chunkSize_)); !res.has_value()) {
+					std::lock_guard lock(mutex);
+					if (!error) {
+						error.emplace(res.error());
+					}
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+		});
+		if (error) {
+			return std::unexpected(*error);
+		}
+		return {};
+	}
+
+	Expected<void> CompressedBlock::read(u64 offset, std::span<std::byte> out) const
+	{
+		if (offset > rawSize_ || rawSize_ - offset < out.size()) {
+			return std::unexpected(std::format("reading {} bytes at {} is past the end of {} bytes", out.size(), offset, rawSize_));
+		}
+		thread_local std::vector<std::byte> scratch;
+		const u64 end = offset + out.size();
+		for (u64 position = offset; position != end;) {
+			const u32 index = static_cast<u32>(position / chunkSize_);
+			const u64 chunkStart = u64(index) * chunkSize_;
+			const u32 rawSize = getChunkRawSize(index);
+			const u64 count = std::min<u64>(chunkStart + rawSize, end) - position;
+			auto target = out.subspan(position - offset, count);
+			if (position == chunkStart && count == rawSize) {
+				TRY_EXPR_IGNORE_VALUE(decompressChunk(index, target));
+			}
+			else {
+				// only part of the chunk is wanted, so it is decoded up to the end of that part
+				scratch.resize(std::max<size_t>(scratch.size(), chunkSize_));
+				TRY_EXPR_IGNORE_VALUE(decodeChunk(index, scratch, static_cast<u32>(position - chunkStart + count)));
+				std::memcpy(target.data(), scratch.data() + (position - chunkStart), count);
+			}
+			position += count;
+		}
+		return {};
+	}
+}
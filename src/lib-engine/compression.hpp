@@ -0,0 +1,122 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <span>
+#include <vector>
+
+namespace qf
+{
+	namespace jobs
+	{
+		class JobSystem;
+	}
+
+	enum class Codec : u8 {
+		// stored as is, used for chunks that don't get any smaller
+		None,
+		// fast to decompress, for data loaded on demand
+		Lz4,
+		// smaller and slower, for data where disk size matters more
+		Zstd,
+	};
+
+	/*
+	* compressed block layout: a CompressedHeader, then chunkCount CompressedChunks, then the
+	* compressed chunks. every chunk but the last holds chunkSize bytes of the raw data and is
+	* compressed on its own, so chunks can be decompressed in any order and in parallel, and
+	* a range of the raw data can be read without decompressing the chunks before it.
+	* offsets are from the start of the block and all integers are little endian
+	*/
+	inline constexpr FourCC COMPRESSED_MAGIC{ "QFCB" };
+	inline constexpr u32 COMPRESSED_VERSION = 1;
+
+	struct CompressedHeader {
+		u32 magic;
+		u32 version;
+		u64 rawSize;
+		u32 chunkSize;
+		u32 chunkCount;
+	};
+
+	struct CompressedChunk {
+		u64 offset;
+		u32 size;
+		Codec codec;
+		u8 reserved[3];
+	};
+
+	struct CompressSettings {
+		Codec codec = Codec::Lz4;
+		// bytes of raw data per chunk. smaller chunks spread over more threads and make
+		// reading a range cheaper, larger ones compress a little better
+		u32 chunkSize = 256 * 1024;
+		// the codec's compression level, 0 for its default. lz4 ignores it
+		int level = 0;
+	};
+
+	Expected<std::vector<std::byte>> compress(std::span<const std::byte> data, const CompressSettings& settings = {});
+
+	/**
+	 * @brief Reads a compressed block in place.
+	 *
+	 * The block isn't copied, so the data must outlive the CompressedBlock. Chunks are only
+	 * checked as they are decompressed. A chunk the codec can't decode, or that decodes to
+	 * the wrong size, fails that call, but there is no checksum to catch every damaged byte.
+	 */
+	class CompressedBlock
+	{
+		std::span<const std::byte> data_{};
+		u64 rawSize_ = 0;
+		u32 chunkSize_ = 0;
+		u32 chunkCount_ = 0;
+
+		CompressedChunk getChunk(u32 index) const;
+
+		/*
+		* decompresses at least the first wanted bytes of a chunk into out, which must hold
+		* all of it
+		*/
+		Expected<void> decodeChunk(u32 index, std::span<std::byte> out, u32 wanted) const;
+
+	public:
+		/*
+		* whether data starts like a compressed block, to tell compressed assets from raw ones
+		*/
+		static bool isCompressed(std::span<const std::byte> data);
+
+		static Expected<CompressedBlock> open(std::span<const std::byte> data);
+
+		u64 getRawSize() const { return rawSize_; }
+
+		u32 getChunkSize() const { return chunkSize_; }
+
+		u32 getChunkCount() const { return chunkCount_; }
+
+		/*
+		* the bytes of raw data in a chunk, chunkSize for all but the last
+		*/
+		u32 getChunkRawSize(u32 index) const;
+
+		/*
+		* decompresses one chunk into out, which must hold getChunkRawSize(index) bytes
+		*/
+		Expected<void> decompressChunk(u32 index, std::span<std::byte> out) const;
+
+		/*
+		* decompresses the whole block into out, which must hold getRawSize() bytes
+		*/
+		Expected<void> decompress(std::span<std::byte> out) const;
+
+		/*
+		* the same, with the chunks spread over the job system's workers
+		*/
+		Expected<void> decompress(jobs::JobSystem& jobs, std::span<std::byte> out) const;
+
+		/*
+		* decompresses out.size() bytes of the raw data starting at offset, touching only the
+		* chunks that range overlaps
+		*/
+		Expected<void> read(u64 offset, std::span<std::byte> out) const;
+	};
+}
@@ -0,0 +1,486 @@
+#include "config_index.hpp"
+#include "logger.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	using qf::ConfigIndex;
+	using qf::u32;
+	using qf::u64;
+
+	/*
+	* a value while the tree is flattened, before its strings are moved into the index.
+	* the alternatives are in the same order as ConfigIndex::Value
+	*/
+	using ParsedValue = std::variant<bool, qf::s64, double, std::string, std::vector<std::string>, ConfigIndex::SequenceSize>;
+
+	struct ParsedEntry {
+		std::string path;
+		ParsedValue value;
+	};
+
+	/*
+	* plain scalars are typed by their text, quoted ones are always strings
+	*/
+	ParsedValue scalarValue(const YAML::Node& node) {
+		if (node.Tag() != "!") {
+			if (qf::s64 i; YAML::convert<qf::s64>::decode(node, i)) {
+				return i;
+			}
+			if (double f; YAML::convert<double>::decode(node, f)) {
+				return f;
+			}
+			if (bool b; YAML::convert<bool>::decode(node, b)) {
+				return b;
+			}
+		}
+		return node.Scalar();
+	}
+
+	void flatten(const YAML::Node& node, std::string& path, std::vector<ParsedEntry>& entries) {
+		const size_t length = path.size();
+		auto child = [&](std::string_view name) {
+			if (!path.empty()) {
+				path += '.';
+			}
+			path += name;
+		};
+
+		switch (node.Type()) {
+		case YAML::NodeType::Scalar:
+			entries.push_back({ path, scalarValue(node) });
+			break;
+
+		case YAML::NodeType::Sequence: {
+			const bool scalars = std::all_of(node.begin(), node.end(), [](const YAML::Node& item) { return item.IsScalar(); });
+			if (scalars) {
+				std::vector<std::string> list;
+				for (auto const& item : node) {
+					list.push_back(item.Scalar());
+				}
+				entries.push_back({ path, std::move(list) });
+				break;
+			}
+			entries.push_back({ path, ConfigIndex::SequenceSize{ node.size() } });
+			for (size_t i = 0; i != node.size(); ++i) {
+				child(std::to_string(i));
+				flatten(node[i], path, entries);
+				path.resize(length);
+			}
+			break;
+		}
+
+		case YAML::NodeType::Map:
+			for (auto const& item : node) {
+				child(item.first.Scalar());
+				flatten(item.second, path, entries);
+				path.resize(length);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	/*
+	* cache file layout: a Header, entryCount Entries, itemCount Items, then stringBytes of
+	* string data that paths, strings and list items are offsets into
+	*/
+	static constexpr u32 CACHE_MAGIC = 0x46434651; // "QFCF"
+	static constexpr u32 CACHE_VERSION = 1;
+
+	struct CacheHeader {
+		u32 magic;
+		u32 version;
+		u64 sourceHash;
+		u32 entryCount;
+		u32 itemCount;
+		u64 stringBytes;
+	};
+
+	struct CacheEntry {
+		u32 pathOffset;
+		u32 pathLength;
+
+		/*
+		* index of the ConfigIndex::Value alternative
+		*/
+		u32 type;
+
+		/*
+		* string length, or list item count
+		*/
+		u32 length;
+
+		/*
+		* the bits of a bool, integer or float, a string offset, a list's first item or
+		* a sequence size
+		*/
+		u64 payload;
+	};
+
+	struct CacheItem {
+		u32 offset;
+		u32 length;
+	};
+
+	template<typename T>
+	T readAt(const std::byte* base, size_t index) {
+		T value;
+		std::memcpy(&value, base + index * sizeof(T), sizeof(T));
+		return value;
+	}
+}
+
+namespace qf
+{
+	auto ConfigIndex::fromYaml(const YAML::Node& root) -> Expected<ConfigIndex>
+	{
+		std::vector<ParsedEntry> entries;
+		try {
+			std::string path;
+			flatten(root, path, entries);
+		}
+		catch (const YAML::Exception& e) {
+			return std::unexpected(std::format("bad config: {}", e.what()));
+		}
+
+		size_t stringBytes = 0;
+		size_t itemCount = 0;
+		for (auto const& entry : entries) {
+			stringBytes += entry.path.size();
+			if (auto s = std::get_if<std::string>(&entry.value)) {
+				stringBytes += s->size();
+			}
+			else if (auto list = std::get_if<std::vector<std::string>>(&entry.value)) {
+				itemCount += list->size();
+				for (auto const& item : *list) {
+					stringBytes += item.size();
+				}
+			}
+		}
+
+		ConfigIndex index;
+		index.strings_ = makeBox<char[]>(std::max<size_t>(stringBytes, 1));
+		index.listItems_.reserve(itemCount);
+		index.values_.reserve(entries.size());
+
+		char* cursor = index.strings_.get();
+		auto store = [&](std::string_view s) {
+			std::memcpy(cursor, s.data(), s.size());
+			cursor += s.size();
+			return std::string_view(cursor - s.size(), s.size());
+		};
+
+		for (auto& entry : entries) {
+			const std::string_view path = store(entry.path);
+			Value value = std::visit([&](auto const& parsed) -> Value {
+				using T = std::decay_t<decltype(parsed)>;
+				if constexpr (std::is_same_v<T, std::string>) {
+					return store(parsed);
+				}
+				else if constexpr (std::is_same_v<T, std::vector<std::string>>) {
+					const size_t first = index.listItems_.size();
+					for (auto const& item : parsed) {
+						index.listItems_.push_back(store(item));
+					}
+					return StringList{ std::span(index.listItems_).subspan(first, parsed.size()) };
+				}
+				else {
+					return parsed;
+				}
+			}, entry.value);
+
+			if (!index.values_.emplace(path, value).second) {
+				return std::unexpected(std::format("config key {} appears more than once", path));
+			}
+		}
+		return index;
+	}
+
+	auto ConfigIndex::parseYaml(std::string_view text) -> Expected<ConfigIndex>
+	{
+		YAML::Node root;
+		try {
+			root = YAML::Load(std::string(text));
+		}
+		catch (const YAML::Exception& e) {
+			return std::unexpected(std::format("bad config: {}", e.what()));
+		}
+		return fromYaml(root);
+	}
+
+	auto ConfigIndex::loadCache(const fs::path& path, u64 sourceHash) -> Expected<ConfigIndex>
+	{
+		auto file = MappedFile::open(path);
+		if (!file.has_value()) {
+			return std::unexpected(file.error());
+		}
+
+		const auto data = file.value()->getData();
+		if (data.size() < sizeof(CacheHeader)) {
+			return std::unexpected("config cache is truncated");
+		}
+		const auto header = readAt<CacheHeader>(data.data(), 0);
+		if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+			return std::unexpected("config cache is from another version");
+		}
+		if (header.sourceHash != sourceHash) {
+			return std::unexpected("config cache is out of date");
+		}
+
+		const u64 expectedSize = sizeof(CacheHeader)
+			+ u64(header.entryCount) * sizeof(CacheEntry)
+			+ u64(header.itemCount) * sizeof(CacheItem)
+			+ header.stringBytes;
+		if (data.size() != expectedSize) {
+			return std::unexpected("config cache is damaged");
+		}
+
+		const std::byte* entries = data.data() + sizeof(CacheHeader);
+		const std::byte* items = entries + size_t(header.entryCount) * sizeof(CacheEntry);
+		const char* strings = reinterpret_cast<const char*>(items + size_t(header.itemCount) * sizeof(CacheItem));
+
+		bool valid = true;
+		auto string = [&](u64 offset, u64 length) {
+			if (offset + length > header.stringBytes) {
+				valid = false;
+				return std::string_view{};
+			}
+			return std::string_view(strings + offset, length);
+		};
+
+		ConfigIndex index;
+		index.listItems_.reserve(header.itemCount);
+		for (u32 i = 0; i != header.itemCount; ++i) {
+			const auto item = readAt<CacheItem>(items, i);
+			index.listItems_.push_back(string(item.offset, item.length));
+		}
+
+		index.values_.reserve(header.entryCount);
+		for (u32 i = 0; i != header.entryCount && valid; ++i) {
+			const auto entry = readAt<CacheEntry>(entries, i);
+			Value value;
+			switch (entry.type) {
+			case 0: value = entry.payload != 0; break;
+			case 1: value = std::bit_cast<s64>(entry.payload); break;
+			case 2: value = std::bit_cast<double>(entry.payload); break;
+			case 3: value = string(entry.payload, entry.length); break;
+			case 4:
+				if (entry.payload + entry.length > header.itemCount) {
+					valid = false;
+					break;
+				}
+				value = StringList{ std::span(index.listItems_).subspan(entry.payload, entry.length) };
+				break;
+			case 5: value = SequenceSize{ static_cast<size_t>(entry.payload) }; break;
+			default: valid = false; break;
+			}
+			valid = valid && index.values_.emplace(string(entry.pathOffset, entry.pathLength), value).second;
+		}
+		if (!valid) {
+			return std::unexpected("config cache is damaged");
+		}
+
+		index.mapping_ = std::move(file.value());
+		return index;
+	}
+
+	Expected<void> ConfigIndex::writeCache(const fs::path& path, u64 sourceHash) const
+	{
+		std::vector<CacheEntry> entries;
+		std::vector<CacheItem> items;
+		std::string strings;
+		entries.reserve(values_.size());
+		items.reserve(listItems_.size());
+
+		auto store = [&](std::string_view s) {
+			const CacheItem item{ u32(strings.size()), u32(s.size()) };
+			strings += s;
+			return item;
+		};
+
+		for (auto const& [path, value] : values_) {
+			const CacheItem pathItem = store(path);
+			CacheEntry entry{ .pathOffset = pathItem.offset, .pathLength = pathItem.length, .type = u32(value.index()) };
+			std::visit([&](auto const& v) {
+				using T = std::decay_t<decltype(v)>;
+				if constexpr (std::is_same_v<T, bool>) {
+					entry.payload = v;
+				}
+				else if constexpr (std::is_same_v<T, s64> || std::is_same_v<T, double>) {
+					entry.payload = std::bit_cast<u64>(v);
+				}
+				else if constexpr (std::is_same_v<T, std::string_view>) {
+					const CacheItem item = store(v);
+					entry.payload = item.offset;
+					entry.length = item.length;
+				}
+				else if constexpr (std::is_same_v<T, StringList>) {
+					entry.payload = items.size();
+					entry.length = u32(v.items.size());
+					for (auto const& item : v.items) {
+						items.push_back(store(item));
+					}
+				}
+				else {
+					entry.payload = v.count;
+				}
+			}, value);
+			entries.push_back(entry);
+		}
+
+		const CacheHeader header{
+			.magic = CACHE_MAGIC,
+			.version = CACHE_VERSION,
+			.sourceHash = sourceHash,
+			.entryCount = u32(entries.size()),
+			.itemCount = u32(items.size()),
+			.stringBytes = strings.size(),
+		};
+
+		// written next to the cache and renamed over it, so a reader never sees half a file
+		fs::path temp = path;
+		temp += ".tmp";
+		{
+			std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(CacheEntry));
+			out.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(CacheItem));
+			out.write(strings.data(), strings.size());
+			if (!out) {
+				return std::unexpected(std::format("can't write {}", temp.string()));
+			}
+		}
+
+		std::error_code ec;
+		fs::rename(temp, path, ec);
+		if (ec) {
+			fs::remove(temp, ec);
+			return std::unexpected(std::format("can't replace {}", path.string()));
+		}
+		return {};
+	}
+
+	auto ConfigIndex::load(const fs::path& yamlPath, const fs::path& cachePath) -> Expected<ConfigIndex>
+	{
+		std::ifstream in(yamlPath, std::ios::binary);
+		if (!in) {
+			return std::unexpected(std::format("can't read {}", yamlPath.string()));
+		}
+		const std::string text(std::istreambuf_iterator<char>(in), {});
+		return loadSource(text, cachePath);
+	}
+
+	auto ConfigIndex::loadSource(std::string_view text, const fs::path& cachePath) -> Expected<ConfigIndex>
+	{
+		const u64 sourceHash = hashSource(text);
+		if (auto cached = loadCache(cachePath, sourceHash); cached.has_value()) {
+			return cached;
+		}
+
+		auto index = parseYaml(text);
+		if (index.has_value()) {
+			if (auto res = index->writeCache(cachePath, sourceHash); !res.has_value()) {
+				log::info("config cache not written, {}", res.error().str());
+			}
+		}
+		return index;
+	}
+
+	u64 ConfigIndex::hashSource(std::string_view text)
+	{
+		return hashString(text, CACHE_VERSION);
+	}
+
+	auto ConfigIndex::find(std::string_view path) const -> const Value*
+	{
+		auto it = values_.find(path);
+		return it != values_.end() ? &it->second : nullptr;
+	}
+
+	std::optional<bool> ConfigIndex::getBool(std::string_view path) const
+	{
+		if (auto value = findAs<bool>(path)) {
+			return *value;
+		}
+		return std::nullopt;
+	}
+
+	std::optional<s64> ConfigIndex::getInt(std::string_view path) const
+	{
+		if (auto value = findAs<s64>(path)) {
+			return *value;
+		}
+		return std::nullopt;
+	}
+
+	std::optional<double> ConfigIndex::getFloat(std::string_view path) const
+	{
+		if (auto value = findAs<double>(path)) {
+			return *value;
+		}
+		if (auto value = findAs<s64>(path)) {
+			return static_cast<double>(*value);
+		}
+		return std::nullopt;
+	}
+
+	std::optional<std::string_view> ConfigIndex::getString(std::string_view path) const
+	{
+		if (auto value = findAs<std::string_view>(path)) {
+			return *value;
+		}
+		return std::nullopt;
+	}
+
+	std::span<const std::string_view> ConfigIndex::getStringList(std::string_view path) const
+	{
+		if (auto value = findAs<StringList>(path)) {
+			return value->items;
+		}
+		return {};
+	}
+
+	std::vector<std::string_view> ConfigIndex::getChangedPaths(const ConfigIndex& other) const
+	{
+		std::vector<std::string_view> changed;
+		for (auto const& [path, value] : values_) {
+			const Value* otherValue = other.find(path);
+			if (!otherValue || *otherValue != value) {
+				changed.push_back(path);
+			}
+		}
+		for (auto const& [path, value] : other.values_) {
+			if (!find(path)) {
+				changed.push_back(path);
+			}
+		}
+		return changed;
+	}
+
+	bool ConfigIndex::isInSubtree(std::string_view path, std::string_view subtree)
+	{
+		return subtree.empty()
+			|| (path.starts_with(subtree) && (path.size() == subtree.size() || path[subtree.size()] == '.'));
+	}
+
+	size_t ConfigIndex::getSize(std::string_view path) const
+	{
+		if (auto value = findAs<StringList>(path)) {
+			return value->items.size();
+		}
+		if (auto value = findAs<SequenceSize>(path)) {
+			return value->count;
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "flat_hash_map.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace YAML {
+	class Node;
+}
+
+namespace qf
+{
+	/**
+	 * @brief Immutable, flattened view of the configuration.
+	 *
+	 * Every value in the config tree is stored under its dotted path, eg
+	 * "graphics.vulkan.enable-validation", already converted to its type, so a lookup is one
+	 * hash probe and never allocates. Maps are flattened into their children. A sequence of
+	 * scalars is stored as a string list. Any other sequence stores its length under its own
+	 * path and its elements under path.0, path.1 and so on.
+	 *
+	 * An index can be written to a binary cache file and loaded back from it without parsing
+	 * YAML. A cached index keeps the file mapped and its strings point straight into it.
+	 */
+	class ConfigIndex
+	{
+	public:
+		struct SequenceSize {
+			size_t count;
+
+			bool operator==(const SequenceSize&) const = default;
+		};
+
+		struct StringList {
+			std::span<const std::string_view> items;
+
+			bool operator==(const StringList& other) const {
+				return std::equal(items.begin(), items.end(), other.items.begin(), other.items.end());
+			}
+		};
+
+		using Value = std::variant<bool, s64, double, std::string_view, StringList, SequenceSize>;
+
+		ConfigIndex() = default;
+		ConfigIndex(ConfigIndex&&) = default;
+		ConfigIndex& operator=(ConfigIndex&&) = default;
+
+		static Expected<ConfigIndex> fromYaml(const YAML::Node& root);
+
+		static Expected<ConfigIndex> parseYaml(std::string_view text);
+
+		/*
+		* loads an index written by writeCache(), failing if the file is missing, damaged,
+		* from another version, or was written for a source with a different hash
+		*/
+		static Expected<ConfigIndex> loadCache(const std::filesystem::path& path, u64 sourceHash);
+
+		/*
+		* writes the index to path, replacing it atomically
+		*/
+		Expected<void> writeCache(const std::filesystem::path& path, u64 sourceHash) const;
+
+		/*
+		* loads the YAML at yamlPath, through the cache at cachePath when it was written for the
+		* same YAML, and rewrites the cache when it wasn't
+		*/
+		static Expected<ConfigIndex> load(const std::filesystem::path& yamlPath, const std::filesystem::path& cachePath);
+
+		/*
+		* the same for YAML already read into memory
+		*/
+		static Expected<ConfigIndex> loadSource(std::string_view text, const std::filesystem::path& cachePath);
+
+		static u64 hashSource(std::string_view text);
+
+		/*
+		* the value at path, or nullptr when there is none
+		*/
+		const Value* find(std::string_view path) const;
+
+		bool contains(std::string_view path) const { return find(path) != nullptr; }
+
+		std::optional<bool> getBool(std::string_view path) const;
+
+		std::optional<s64> getInt(std::string_view path) const;
+
+		/*
+		* integers are converted
+		*/
+		std::optional<double> getFloat(std::string_view path) const;
+
+		std::optional<std::string_view> getString(std::string_view path) const;
+
+		/*
+		* empty when there is no list at path
+		*/
+		std::span<const std::string_view> getStringList(std::string_view path) const;
+
+		/*
+		* number of elements of the sequence at path, 0 when there is none
+		*/
+		size_t getSize(std::string_view path) const;
+
+		size_t size() const { return values_.size(); }
+
+		/*
+		* true when the index was loaded from a cache file rather than parsed
+		*/
+		bool isCached() const { return mapping_ != nullptr; }
+
+		/*
+		* paths whose value differs between this and other, including paths only one of them has
+		*/
+		std::vector<std::string_view> getChangedPaths(const ConfigIndex& other) const;
+
+		/*
+		* true when path is subtree or lies below it
+		*/
+		static bool isInSubtree(std::string_view path, std::string_view subtree);
+
+	private:
+		struct KeyHash {
+			size_t operator()(std::string_view key) const {
+				return static_cast<size_t>(hashString(key));
+			}
+		};
+
+		/*
+		* the bytes of every path and string, either owned or in the mapped cache file
+		*/
+		Box<char[]> strings_{};
+		Box<MappedFile> mapping_{};
+
+		/*
+		* the items of every string list, which the lists are spans of
+		*/
+		std::vector<std::string_view> listItems_{};
+
+		FlatHashMap<std::string_view, Value, KeyHash> values_{};
+
+		template<typename T>
+		const T* findAs(std::string_view path) const {
+			const Value* value = find(path);
+			return value ? std::get_if<T>(value) : nullptr;
+		}
+	};
+}
@@ -0,0 +1,145 @@
+#include "config_watcher.hpp"
+#include "logger.hpp"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+#if defined(__linux__)
+	/*
+	* inotify on the file's directory, closed with the watcher thread
+	*/
+	class DirectoryWatch : qf::NonCopyable
+	{
+		int fd_ = -1;
+		std::string name_;
+
+	public:
+		DirectoryWatch(const fs::path& file)
+			: name_(file.filename().string())
+		{
+			fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd_ >= 0 && inotify_add_watch(fd_, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+				close(fd_);
+				fd_ = -1;
+			}
+		}
+
+		~DirectoryWatch() {
+			if (fd_ >= 0) {
+				close(fd_);
+			}
+		}
+
+		bool isValid() const { return fd_ >= 0; }
+
+		/*
+		* waits up to timeout and returns true if the file changed in that time
+		*/
+		bool wait(std::chrono::milliseconds timeout) {
+			pollfd pfd{ .fd = fd_, .events = POLLIN };
+			if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) {
+				return false;
+			}
+
+			alignas(inotify_event) char buffer[4096];
+			bool changed = false;
+			for (;;) {
+				const ssize_t length = read(fd_, buffer, sizeof(buffer));
+				if (length <= 0) {
+					break;
+				}
+				for (ssize_t offset = 0; offset < length;) {
+					auto const* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+					changed |= event->len != 0 && name_ == event->name;
+					offset += sizeof(inotify_event) + event->len;
+				}
+			}
+			return changed;
+		}
+	};
+#else
+	/*
+	* polls the file's write time
+	*/
+	class DirectoryWatch : qf::NonCopyable
+	{
+		fs::path file_;
+		fs::file_time_type lastWrite_{};
+
+		fs::file_time_type lastWriteTime() const {
+			std::error_code ec;
+			return fs::last_write_time(file_, ec);
+		}
+
+	public:
+		DirectoryWatch(const fs::path& file)
+			: file_(file)
+			, lastWrite_(lastWriteTime()) {}
+
+		bool isValid() const { return true; }
+
+		bool wait(std::chrono::milliseconds timeout) {
+			std::this_thread::sleep_for(std::min(timeout, qf::ConfigWatcher::POLL_INTERVAL));
+			const auto lastWrite = lastWriteTime();
+			return std::exchange(lastWrite_, lastWrite) != lastWrite;
+		}
+	};
+#endif
+}
+
+namespace qf
+{
+	ConfigWatcher::ConfigWatcher(std::filesystem::path file, Callback&& onChange)
+		: file_(fs::absolute(file))
+		, onChange_(std::move(onChange))
+	{
+	}
+
+	ConfigWatcher::~ConfigWatcher()
+	{
+		stop();
+	}
+
+	Expected<void> ConfigWatcher::start()
+	{
+		if (running_.exchange(true)) {
+			return std::unexpected("config watcher is already running");
+		}
+		thread_ = std::thread([this] { run(); });
+		return {};
+	}
+
+	void ConfigWatcher::stop()
+	{
+		running_.store(false);
+		if (thread_.joinable()) {
+			thread_.join();
+		}
+	}
+
+	void ConfigWatcher::run()
+	{
+		DirectoryWatch watch(file_);
+		if (!watch.isValid()) {
+			log::info("can't watch {} for changes", file_.string());
+			return;
+		}
+
+		while (running_.load(std::memory_order_relaxed)) {
+			if (!watch.wait(POLL_INTERVAL)) {
+				continue;
+			}
+			// let the writer finish before reading the file
+			while (running_.load(std::memory_order_relaxed) && watch.wait(SETTLE_TIME)) {
+			}
+			onChange_();
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+namespace qf
+{
+	/**
+	 * @brief Calls back on a thread of its own whenever a file changes on disk.
+	 *
+	 * The file's directory is watched rather than the file, because editors often save by
+	 * writing a new file and renaming it over the old one. Bursts of changes are collapsed
+	 * into one callback once the file has been quiet for SETTLE_TIME.
+	 *
+	 * Uses inotify on Linux and polls the file's write time elsewhere.
+	 */
+	class ConfigWatcher : NonCopyable
+	{
+	public:
+		using Callback = std::function<void()>;
+
+		static constexpr std::chrono::milliseconds SETTLE_TIME{ 50 };
+		static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+		ConfigWatcher(std::filesystem::path file, Callback&& onChange);
+
+		~ConfigWatcher();
+
+		Expected<void> start();
+
+		void stop();
+
+	private:
+		std::filesystem::path file_;
+		Callback onChange_;
+		std::atomic<bool> running_{};
+		std::thread thread_{};
+
+		void run();
+	};
+}
@@ -0,0 +1,276 @@
+#include "ecs.hpp"
+#include "hash.hpp"
+#include "logger.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace qf::ecs
+{
+	namespace
+	{
+		std::array<ComponentInfo, MAX_COMPONENTS> components_{};
+		std::atomic<u32> componentCount_{};
+
+		size_t alignUp(size_t offset, size_t alignment) {
+			return (offset + alignment - 1) & ~(alignment - 1);
+		}
+
+		void relocate(const ComponentInfo& info, void* dst, void* src) {
+			if (info.relocate) {
+				info.relocate(dst, src);
+			}
+			else {
+				std::memcpy(dst, src, info.size);
+			}
+		}
+	}
+
+	namespace detail
+	{
+		ComponentId registerComponent(const ComponentInfo& info)
+		{
+			const u32 id = componentCount_.fetch_add(1, std::memory_order_relaxed);
+			if (id >= MAX_COMPONENTS) {
+				log::error("more than {} component types", MAX_COMPONENTS);
+				std::abort();
+			}
+			components_[id] = info;
+			return static_cast<ComponentId>(id);
+		}
+
+		const ComponentInfo& getComponentInfo(ComponentId id)
+		{
+			return components_[id];
+		}
+	}
+
+	Archetype::Archetype(std::vector<ComponentId>&& components)
+		: components_(std::move(components))
+	{
+		columns_.fill(NO_COLUMN);
+		size_t rowBytes = sizeof(Entity);
+		for (size_t i = 0; i != components_.size(); ++i) {
+			auto const& info = detail::getComponentInfo(components_[i]);
+			mask_.set(components_[i]);
+			columns_[components_[i]] = static_cast<u8>(i);
+			rowBytes += info.size;
+			chunkAlignment_ = std::max<size_t>(chunkAlignment_, info.alignment);
+		}
+
+		// the entity ids first, then each component's array at its alignment
+		offsets_.resize(components_.size());
+		auto layout = [&](u32 capacity) {
+			size_t offset = sizeof(Entity) * capacity;
+			for (size_t i = 0; i != components_.size(); ++i) {
+				auto const& info = detail::getComponentInfo(components_[i]);
+				offset = alignUp(offset, info.alignment);
+				offsets_[i] = static_cast<u32>(offset);
+				offset += size_t(info.size) * capacity;
+			}
+			return offset;
+		};
+		capacity_ = std::max<u32>(1, static_cast<u32>(CHUNK_SIZE / rowBytes));
+		while (capacity_ > 1 && layout(capacity_) > CHUNK_SIZE) {
+			--capacity_;
+		}
+		// a row too big for a chunk gets a chunk of its own
+		chunkBytes_ = std::max(CHUNK_SIZE, layout(capacity_));
+	}
+
+	Archetype::~Archetype()
+	{
+		for (u32 column = 0; column != components_.size(); ++column) {
+			auto const& info = detail::getComponentInfo(components_[column]);
+			if (!info.destroy) {
+				continue;
+			}
+			for (u32 row = 0; row != size_; ++row) {
+				info.destroy(getComponent(row, column));
+			}
+		}
+		for (std::byte* chunk : chunks_) {
+			::operator delete(chunk, std::align_val_t{ chunkAlignment_ });
+		}
+	}
+
+	u32 Archetype::pushRow(Entity entity)
+	{
+		const u32 row = size_;
+		if (row / capacity_ == chunks_.size()) {
+			chunks_.push_back(static_cast<std::byte*>(::operator new(chunkBytes_, std::align_val_t{ chunkAlignment_ })));
+		}
+		getEntity(row) = entity;
+		++size_;
+		return row;
+	}
+
+	World::World()
+	{
+		empty_ = getArchetype(std::span<ComponentId>{});
+	}
+
+	World::~World() = default;
+
+	const World::Record* World::findRecord(Entity entity) const
+	{
+		if (entity.index >= records_.size()) {
+			return nullptr;
+		}
+		const Record& record = records_[entity.index];
+		return record.generation == entity.generation && record.archetype ? &record : nullptr;
+	}
+
+	Archetype* World::getArchetype(std::span<ComponentId> components)
+	{
+		std::sort(components.begin(), components.end());
+		components = components.first(std::unique(components.begin(), components.end()) - components.begin());
+		const u64 hash = hashBytes(components.data(), components.size() * sizeof(ComponentId));
+
+		auto it = archetypeIndex_.find(hash);
+		auto matches = [&](const Archetype& archetype) { return std::ranges::equal(archetype.components_, components); };
+		if (it != archetypeIndex_.end() && matches(*it->second)) {
+			return it->second;
+		}
+		if (it != archetypeIndex_.end()) {
+			// two sets of components with the same hash, the second is only found by searching
+			for (auto const& archetype : archetypes_) {
+				if (matches(*archetype)) {
+					return archetype.get();
+				}
+			}
+		}
+
+		if (components.size() >= Archetype::NO_COLUMN) {
+			log::error("an archetype can't have {} components", components.size());
+			std::abort();
+		}
+		archetypes_.push_back(Box<Archetype>(new Archetype(std::vector<ComponentId>(components.begin(), components.end()))));
+		Archetype* archetype = archetypes_.back().get();
+		archetypeIndex_.emplace(hash, archetype);
+		return archetype;
+	}
+
+	Archetype* World::getAddTarget(Archetype& archetype, ComponentId id)
+	{
+		auto it = archetype.addEdges_.find(id);
+		if (it != archetype.addEdges_.end()) {
+			return it->second;
+		}
+		std::vector<ComponentId> components = archetype.components_;
+		components.push_back(id);
+		Archetype* target = getArchetype(components);
+		archetype.addEdges_.emplace(id, target);
+		target->removeEdges_.emplace(id, &archetype);
+		return target;
+	}
+
+	Archetype* World::getRemoveTarget(Archetype& archetype, ComponentId id)
+	{
+		auto it = archetype.removeEdges_.find(id);
+		if (it != archetype.removeEdges_.end()) {
+			return it->second;
+		}
+		std::vector<ComponentId> components = archetype.components_;
+		std::erase(components, id);
+		Archetype* target = getArchetype(components);
+		archetype.removeEdges_.emplace(id, target);
+		target->addEdges_.emplace(id, &archetype);
+		return target;
+	}
+
+	Entity World::allocateEntity()
+	{
+		++entityCount_;
+		if (!freeIndices_.empty()) {
+			const u32 index = freeIndices_.back();
+			freeIndices_.pop_back();
+			return Entity{ index, records_[index].generation };
+		}
+		records_.push_back(Record{ .archetype = nullptr, .row = 0, .generation = 1 });
+		return Entity{ static_cast<u32>(records_.size() - 1), 1 };
+	}
+
+	void World::moveEntity(Record& record, Archetype& target)
+	{
+		Archetype& source = *record.archetype;
+		const u32 row = record.row;
+		const u32 targetRow = target.pushRow(source.getEntity(row));
+		for (u32 column = 0; column != source.components_.size(); ++column) {
+			const ComponentId id = source.components_[column];
+			auto const& info = detail::getComponentInfo(id);
+			void* component = source.getComponent(row, column);
+			if (target.has(id)) {
+				relocate(info, target.getComponent(targetRow, target.columns_[id]), component);
+			}
+			else if (info.destroy) {
+				info.destroy(component);
+			}
+		}
+		removeRow(source, row);
+		record.archetype = &target;
+		record.row = targetRow;
+	}
+
+	void World::removeRow(Archetype& archetype, u32 row)
+	{
+		const u32 last = archetype.size_ - 1;
+		if (row != last) {
+			for (u32 column = 0; column != archetype.components_.size(); ++column) {
+				relocate(detail::getComponentInfo(archetype.components_[column]),
+					archetype.getComponent(row, column), archetype.getComponent(last, column));
+			}
+			const Entity moved = archetype.getEntity(last);
+			archetype.getEntity(row) = moved;
+			records_[moved.index].row = row;
+		}
+		--archetype.size_;
+
+		// one spare chunk is kept so an entity moving back and forth doesn't allocate each time
+		while (archetype.chunks_.size() > archetype.getChunkCount() + 1) {
+			::operator delete(archetype.chunks_.back(), std::align_val_t{ archetype.chunkAlignment_ });
+			archetype.chunks_.pop_back();
+		}
+	}
+
+	void* World::getComponent(Entity entity, ComponentId id) const
+	{
+		const Record* record = findRecord(entity);
+		if (!record || !record->archetype->has(id)) {
+			return nullptr;
+		}
+		return record->archetype->getComponent(record->row, record->archetype->columns_[id]);
+	}
+
+	Entity World::create()
+	{
+		const Entity entity = allocateEntity();
+		records_[entity.index].archetype = empty_;
+		records_[entity.index].row = empty_->pushRow(entity);
+		return entity;
+	}
+
+	bool World::destroy(Entity entity)
+	{
+		if (!findRecord(entity)) {
+			return false;
+		}
+		Record& record = records_[entity.index];
+		Archetype& archetype = *record.archetype;
+		for (u32 column = 0; column != archetype.components_.size(); ++column) {
+			auto const& info = detail::getComponentInfo(archetype.components_[column]);
+			if (info.destroy) {
+				info.destroy(archetype.getComponent(record.row, column));
+			}
+		}
+		removeRow(archetype, record.row);
+
+		record.archetype = nullptr;
+		// generation 0 is never handed out, so a default Entity never matches a live one
+		record.generation = record.generation + 1 == 0 ? 1 : record.generation + 1;
+		freeIndices_.push_back(entity.index);
+		--entityCount_;
+		return true;
+	}
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "flat_hash_map.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace qf::ecs
+{
+	inline constexpr size_t CHUNK_SIZE = 16 * 1024;
+	inline constexpr size_t CHUNK_ALIGNMENT = 64;
+	inline constexpr size_t MAX_COMPONENTS = 256;
+
+	/*
+	* an index into the world's entities and the generation of that index when the entity
+	* was created, so the id of a destroyed entity never matches the one reusing its index
+	*/
+	struct Entity {
+		u32 index = 0;
+		u32 generation = 0;
+
+		constexpr bool operator==(const Entity&) const = default;
+
+		explicit operator bool() const { return generation != 0; }
+	};
+
+	using ComponentId = u16;
+	using ComponentMask = std::bitset<MAX_COMPONENTS>;
+
+	/*
+	* how to move and destroy a component without knowing its type
+	*/
+	struct ComponentInfo {
+		u32 size;
+		u32 alignment;
+		// move constructs dst from src and destroys src. nullptr for types copied with memcpy
+		void (*relocate)(void* dst, void* src);
+		// nullptr for trivially destructible types
+		void (*destroy)(void* p);
+	};
+
+	namespace detail
+	{
+		ComponentId registerComponent(const ComponentInfo& info);
+
+		const ComponentInfo& getComponentInfo(ComponentId id);
+	}
+
+	/*
+	* any type that can be moved without throwing can be a component. ids are handed out on
+	* first use, so they differ from one run to the next
+	*/
+	template<typename T>
+	ComponentId getComponentId() {
+		static_assert(std::is_same_v<T, std::remove_cvref_t<T>>, "components are plain value types");
+		static_assert(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_destructible_v<T>, "components are moved between chunks");
+		static const ComponentId id = detail::registerComponent(ComponentInfo{
+			.size = sizeof(T),
+			.alignment = alignof(T),
+			.relocate = std::is_trivially_copyable_v<T> ? nullptr : +[](void* dst, void* src) {
+				new (dst) T(std::move(*static_cast<T*>(src)));
+				static_cast<T*>(src)->~T();
+			},
+			.destroy = std::is_trivially_destructible_v<T> ? nullptr : +[](void* p) { static_cast<T*>(p)->~T(); },
+		});
+		return id;
+	}
+
+	/*
+	* a query's components. const ones are only read
+	*/
+	template<typename... Ts>
+	ComponentMask getComponentMask() {
+		ComponentMask mask;
+		(mask.set(getComponentId<std::remove_const_t<Ts>>()), ...);
+		return mask;
+	}
+
+	/**
+	 * @brief The entities that have exactly one set of components.
+	 *
+	 * Entities are kept in chunks of CHUNK_SIZE bytes. A chunk holds the entity ids and then
+	 * one array per component, so a query reads each component it wants as a dense array.
+	 * Rows are kept packed: removing one moves the archetype's last row into the hole, so
+	 * only the last chunk is ever partly full.
+	 */
+	class Archetype : NonCopyable
+	{
+		friend class World;
+
+		static constexpr u8 NO_COLUMN = 0xff;
+
+		std::vector<ComponentId> components_{};
+		ComponentMask mask_{};
+		// column of each component id, NO_COLUMN when the archetype doesn't have it
+		std::array<u8, MAX_COMPONENTS> columns_{};
+		std::vector<u32> offsets_{};
+		u32 capacity_ = 0;
+		size_t chunkBytes_ = 0;
+		size_t chunkAlignment_ = CHUNK_ALIGNMENT;
+		std::vector<std::byte*> chunks_{};
+		u32 size_ = 0;
+
+		// the archetype an entity moves to when one component is added or removed
+		FlatHashMap<ComponentId, Archetype*> addEdges_{};
+		FlatHashMap<ComponentId, Archetype*> removeEdges_{};
+
+		explicit Archetype(std::vector<ComponentId>&& components);
+
+		/*
+		* appends a row for entity, with its components left unconstructed
+		*/
+		u32 pushRow(Entity entity);
+
+		Entity& getEntity(u32 row) const {
+			return reinterpret_cast<Entity*>(chunks_[row / capacity_])[row % capacity_];
+		}
+
+		/*
+		* the component's address in a row, which must be in the archetype
+		*/
+		void* getComponent(u32 row, u32 column) const {
+			return chunks_[row / capacity_] + offsets_[column] + size_t(row % capacity_) * detail::getComponentInfo(components_[column]).size;
+		}
+
+	public:
+		~Archetype();
+
+		const std::vector<ComponentId>& getComponents() const { return components_; }
+
+		const ComponentMask& getMask() const { return mask_; }
+
+		bool has(ComponentId id) const { return columns_[id] != NO_COLUMN; }
+
+		u32 getSize() const { return size_; }
+
+		u32 getChunkCapacity() const { return capacity_; }
+
+		u32 getChunkCount() const { return (size_ + capacity_ - 1) / capacity_; }
+
+		/*
+		* rows in use in a chunk, capacity for all but the last
+		*/
+		u32 getChunkSize(u32 chunk) const { return std::min(capacity_, size_ - chunk * capacity_); }
+
+		const Entity* getEntities(u32 chunk) const { return reinterpret_cast<const Entity*>(chunks_[chunk]); }
+
+		/*
+		* the chunk's array of T, which the archetype must have. T can be const
+		*/
+		template<typename T>
+		T* getColumn(u32 chunk) const {
+			return reinterpret_cast<T*>(chunks_[chunk] + offsets_[columns_[getComponentId<std::remove_const_t<T>>()]]);
+		}
+	};
+
+	/**
+	 * @brief Entities and their components, stored by archetype.
+	 *
+	 * Adding or removing a component moves the entity to the archetype with the new set of
+	 * components. The move follows an edge cached on the archetype, so after the first time
+	 * it costs one hash lookup and a move of each component.
+	 *
+	 * Creating, destroying, adding and removing invalidate pointers to components and must
+	 * not happen inside each() or eachChunk().
+	 */
+	class World : NonCopyable
+	{
+		struct Record {
+			Archetype* archetype;
+			u32 row;
+			u32 generation;
+		};
+
+		std::vector<Record> records_{};
+		std::vector<u32> freeIndices_{};
+		std::vector<Box<Archetype>> archetypes_{};
+		// archetypes by the hash of their sorted components
+		FlatHashMap<u64, Archetype*> archetypeIndex_{};
+		Archetype* empty_{};
+		u32 entityCount_ = 0;
+
+		const Record* findRecord(Entity entity) const;
+
+		/*
+		* the archetype with the components, created the first time. sorts them in place
+		*/
+		Archetype* getArchetype(std::span<ComponentId> components);
+
+		Archetype* getAddTarget(Archetype& archetype, ComponentId id);
+
+		Archetype* getRemoveTarget(Archetype& archetype, ComponentId id);
+
+		Entity allocateEntity();
+
+		/*
+		* moves an entity's components to a new row in target, destroying those target
+		* doesn't have. components target has and the entity didn't are left unconstructed
+		*/
+		void moveEntity(Record& record, Archetype& target);
+
+		/*
+		* fills a row whose components are already gone with the archetype's last row
+		*/
+		void removeRow(Archetype& archetype, u32 row);
+
+		void* getComponent(Entity entity, ComponentId id) const;
+
+		template<typename T, typename Arg>
+		static void construct(Archetype& archetype, u32 row, Arg&& value) {
+			new (archetype.getComponent(row, archetype.columns_[getComponentId<T>()])) T(std::forward<Arg>(value));
+		}
+
+	public:
+		World();
+
+		~World();
+
+		Entity create();
+
+		/*
+		* creates an entity with the given components, which must all be of different types
+		*/
+		template<typename... Ts>
+		Entity create(Ts&&... components) {
+			if constexpr (sizeof...(Ts) == 0) {
+				return create();
+			}
+			else {
+				std::array<ComponentId, sizeof...(Ts)> ids{ getComponentId<std::remove_cvref_t<Ts>>()... };
+				Archetype* archetype = getArchetype(ids);
+				const Entity entity = allocateEntity();
+				const u32 row = archetype->pushRow(entity);
+				records_[entity.index].archetype = archetype;
+				records_[entity.index].row = row;
+				(construct<std::remove_cvref_t<Ts>>(*archetype, row, std::forward<Ts>(components)), ...);
+				return entity;
+			}
+		}
+
+		/*
+		* false when the entity was already destroyed
+		*/
+		bool destroy(Entity entity);
+
+		bool isAlive(Entity entity) const { return findRecord(entity) != nullptr; }
+
+		u32 getEntityCount() const { return entityCount_; }
+
+		size_t getArchetypeCount() const { return archetypes_.size(); }
+
+		/*
+		* adds the component, or replaces it when the entity already has one. nullptr when the
+		* entity was destroyed
+		*/
+		template<typename T, typename... Args>
+		T* add(Entity entity, Args&&... args) {
+			const Record* found = findRecord(entity);
+			if (!found) {
+				return nullptr;
+			}
+			Record& record = records_[entity.index];
+			const ComponentId id = getComponentId<T>();
+			if (record.archetype->has(id)) {
+				T* component = static_cast<T*>(record.archetype->getComponent(record.row, record.archetype->columns_[id]));
+				*component = T(std::forward<Args>(args)...);
+				return component;
+			}
+			moveEntity(record, *getAddTarget(*record.archetype, id));
+			return new (record.archetype->getComponent(record.row, record.archetype->columns_[id])) T(std::forward<Args>(args)...);
+		}
+
+		/*
+		* false when the entity was destroyed or didn't have the component
+		*/
+		template<typename T>
+		bool remove(Entity entity) {
+			const Record* found = findRecord(entity);
+			const ComponentId id = getComponentId<T>();
+			if (!found || !found->archetype->has(id)) {
+				return false;
+			}
+			Record& record = records_[entity.index];
+			moveEntity(record, *getRemoveTarget(*record.archetype, id));
+			return true;
+		}
+
+		/*
+		* nullptr when the entity was destroyed or doesn't have the component
+		*/
+		template<typename T>
+		T* get(Entity entity) const {
+			return static_cast<T*>(getComponent(entity, getComponentId<T>()));
+		}
+
+		template<typename T>
+		bool has(Entity entity) const {
+			return getComponent(entity, getComponentId<T>()) != nullptr;
+		}
+
+		/*
+		* calls fn for every archetype with all of the mask's components
+		*/
+		template<typename F>
+		void forEachArchetype(const ComponentMask& mask, F&& fn) const {
+			for (auto const& archetype : archetypes_) {
+				if (archetype->size_ != 0 && (archetype->mask_ & mask) == mask) {
+					fn(*archetype);
+				}
+			}
+		}
+
+		/*
+		* calls fn(std::span<const Entity>, std::span<Ts>...) for every chunk of entities with
+		* all of Ts, for loops over whole arrays
+		*/
+		template<typename... Ts, typename F>
+		void eachChunk(F&& fn) const {
+			forEachArchetype(getComponentMask<Ts...>(), [&](const Archetype& archetype) {
+				for (u32 chunk = 0; chunk != archetype.getChunkCount(); ++chunk) {
+					const u32 size = archetype.getChunkSize(chunk);
+					fn(std::span<const Entity>(archetype.getEntities(chunk), size), std::span<Ts>(archetype.getColumn<Ts>(chunk), size)...);
+				}
+			});
+		}
+
+		/*
+		* calls fn(Ts&...), or fn(Entity, Ts&...), for every entity with all of Ts. a const T is
+		* passed as a const reference
+		*/
+		template<typename... Ts, typename F>
+		void each(F&& fn) const {
+			eachChunk<Ts...>([&](std::span<const Entity> entities, std::span<Ts>... columns) {
+				for (size_t i = 0; i != entities.size(); ++i) {
+					if constexpr (std::is_invocable_v<F, Entity, Ts&...>) {
+						fn(entities[i], columns[i]...);
+					}
+					else {
+						fn(columns[i]...);
+					}
+				}
+			});
+		}
+	};
+}
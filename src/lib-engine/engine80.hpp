@@ -4,7 +4,9 @@
 
 #include "uuid.hpp"
 #include "noncopyable.hpp"
+#include "object_pool.hpp"
 
+#include <atomic>
 #include <format>
 #include <memory>
 #include <expected>
@@ -17,23 +19,22 @@ template<> struct std::formatter<glm::vec3> {
 	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
 		return ctx.end();
 	}
-	auto format(auto&& val, auto&& ctx) -> decltype(ctx.out()) {
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
 		return format_to(ctx.out(), "({},{},{})", val.x, val.y, val.z);
 	}
 };
 
-template<typename T>
-struct std::formatter<std::vector<T>> {
+template<typename T, typename A>
+struct std::formatter<std::vector<T, A>> {
 	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
 		return ctx.end();
 	}
-	auto format(auto&& val, auto&& ctx) -> decltype(ctx.out()) {
-		std::string res = "[\n";
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		auto out = format_to(ctx.out(), "[\n");
 		for (auto const& item : val) {
-			res += "   \"" + std::format("{}",item) + "\",\n";
+			out = format_to(out, "   \"{}\",\n", item);
 		}
-		res += "]\n";
-		return format_to(ctx.out(), "{}", res);
+		return format_to(out, "]\n");
 	}
 };
 
@@ -140,11 +141,12 @@ namespace qf
 {
 	class AbstractClassFactory;
 
+	/*
+	* the built-in classes are in the compile time ClassRegistry. this is the place for
+	* runtime registrations made with registerFactory()
+	*/
 	void registerFactories();
 
-	template<typename T>
-	void registerFactory();
-
 	void registerFactory(const UUID& clsid, ptr<AbstractClassFactory> const& cf);
 
 	ptr<Serializable> createInstance_(const UUID& clsid);
@@ -154,6 +156,16 @@ namespace qf
 		return std::static_pointer_cast<T>(createInstance_(clsid));
 	}
 
+	template<UUID const &> ptr<qf::Serializable> internalCreateInstanceById();
+
+	/*
+	* creates a built-in class whose id is known at compile time, calling its factory directly
+	*/
+	template<typename T, UUID const& ID>
+	ptr<T> createInstance() {
+		return std::static_pointer_cast<T>(internalCreateInstanceById<ID>());
+	}
+
 	struct Result {
 		enum class Code {
 			OK = 0,
@@ -210,24 +222,82 @@ namespace qf
 	template<typename T>
 	struct Deleter_ {
 		void operator()(T* p) const {
-			if(p)
+			if (p) {
 				p->dispose();
+				ObjectPool<T>::instance().destroy(p);
+			}
 		}
 	};
+
+	/*
+	* creates a shared object in the pool for its type. the control block comes from a pool
+	* as well, so neither goes to the heap once the pools are warm
+	*/
 	template<typename T, typename... Args>
 	std::shared_ptr<T> makeShared(Args&&... args) {
-		return std::shared_ptr<T>(new T(args...), Deleter_<T>());
+		return std::shared_ptr<T>(
+			ObjectPool<T>::instance().create(std::forward<Args>(args)...),
+			Deleter_<T>(),
+			PoolAllocator<T>());
 	}
 
 	class Serializable : public EnableSharedFromThis<Serializable> {
+		template<typename T, typename... Args>
+		friend Ref<T> makeRef(Args&&... args);
+
+		/*
+		* intrusive count used by Ref, objects owned through shared_ptr leave it at zero
+		*/
+		mutable std::atomic<u32> refCount_{};
+		void (*release_)(Serializable*) = nullptr;
+
 	public:
 		virtual std::expected<void, std::string> postConstruct() { return {}; }
 
+		/*
+		* the id of the factory that recreates the object when it is read from an Archive.
+		* objects without one can't be archived
+		*/
+		virtual UUID getClassId() const { return {}; }
+
+		/*
+		* writes the object's state to the archive, or reads it back into an object that was
+		* just created through its class id
+		*/
+		virtual Expected<void> serialize(Archive&) { return {}; }
+
 		Serializable(Archive&);
 
 		Serializable() = default;
+
+		void addRef() const {
+			refCount_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void release() const {
+			if (refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1 && release_) {
+				release_(const_cast<Serializable*>(this));
+			}
+		}
 	};
 
+	/*
+	* creates an intrusively counted object in the pool for its type. once the last Ref to it
+	* is gone it is disposed and its slot goes back to the pool.
+	* objects created this way aren't owned by a shared_ptr, so sharedFromThis() can't be used
+	*/
+	template<typename T, typename... Args>
+	Ref<T> makeRef(Args&&... args) {
+		static_assert(std::is_base_of_v<Serializable, T>, "makeRef needs a Serializable");
+		T* obj = ObjectPool<T>::instance().create(std::forward<Args>(args)...);
+		obj->release_ = [](Serializable* p) {
+			auto* t = static_cast<T*>(p);
+			t->dispose();
+			ObjectPool<T>::instance().destroy(t);
+		};
+		return Ref<T>(obj);
+	}
+
 
 
 	//template<typename ClsId, typename T = ClsId::DefaultInterface>
@@ -242,21 +312,21 @@ namespace qf
 
 	
 	template<typename T> [[nodiscard]] ptr<qf::Serializable> internalCreateInstance_() {
-		auto obj = std::make_shared<T>();
+		auto obj = makeShared<T>();
 		obj->postConstruct();
 		return obj;
 	}
 
 	template<typename T, UUID const&> [[nodiscard]] ptr<qf::Serializable> internalCreateInstanceById_() {
-		auto obj = std::make_shared<T>();
-		obj->postConstruct();
+		auto obj = makeShared<T>();
+		if (auto res = obj->postConstruct(); !res.has_value()) {
+			return nullptr;
+		}
 		return obj;
 	}
 
 	template<typename T> ptr<qf::Serializable> internalCreateInstance();
 
-	template<UUID const &> ptr<qf::Serializable> internalCreateInstanceById();
-
 }
 
 #define IMPLEMENT_CLASS_FACTORY(C) \
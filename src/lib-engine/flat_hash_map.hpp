@@ -0,0 +1,449 @@
+#pragma once
+
+#include "uuid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QF_FLAT_HASH_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace qf
+{
+	namespace detail
+	{
+		/*
+		* one control byte per slot. full slots hold the low 7 bits of the key's hash, empty
+		* and deleted slots have the sign bit set so both are found with a single movemask
+		*/
+		using Ctrl = int8_t;
+		constexpr Ctrl CTRL_EMPTY = -128;
+		constexpr Ctrl CTRL_DELETED = -2;
+
+		/*
+		* a set of slots within a group, one bit per slot
+		*/
+		class BitMask
+		{
+			uint32_t bits_;
+
+		public:
+			explicit BitMask(uint32_t bits)
+				: bits_(bits) {}
+
+			explicit operator bool() const { return bits_ != 0; }
+
+			uint32_t lowest() const { return std::countr_zero(bits_); }
+
+			/*
+			* iterates the set bits lowest first
+			*/
+			BitMask begin() const { return *this; }
+			BitMask end() const { return BitMask(0); }
+			uint32_t operator*() const { return lowest(); }
+			BitMask& operator++() { bits_ &= bits_ - 1; return *this; }
+			bool operator!=(const BitMask& other) const { return bits_ != other.bits_; }
+		};
+
+		/*
+		* sixteen control bytes compared at once
+		*/
+		class CtrlGroup
+		{
+#if defined(QF_FLAT_HASH_MAP_SSE2)
+			__m128i ctrl_;
+
+			BitMask matchByte(Ctrl value) const {
+				return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), ctrl_))));
+			}
+
+		public:
+			static constexpr size_t WIDTH = 16;
+
+			explicit CtrlGroup(const Ctrl* ctrl)
+				: ctrl_(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+			BitMask match(Ctrl h2) const { return matchByte(h2); }
+
+			BitMask matchEmpty() const { return matchByte(CTRL_EMPTY); }
+
+			BitMask matchEmptyOrDeleted() const {
+				return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(ctrl_)));
+			}
+#else
+			const Ctrl* ctrl_;
+
+			template<typename P>
+			BitMask matchIf(P&& predicate) const {
+				uint32_t bits = 0;
+				for (uint32_t i = 0; i != WIDTH; ++i) {
+					bits |= uint32_t(predicate(ctrl_[i])) << i;
+				}
+				return BitMask(bits);
+			}
+
+		public:
+			static constexpr size_t WIDTH = 16;
+
+			explicit CtrlGroup(const Ctrl* ctrl)
+				: ctrl_(ctrl) {}
+
+			BitMask match(Ctrl h2) const { return matchIf([h2](Ctrl c) { return c == h2; }); }
+
+			BitMask matchEmpty() const { return matchIf([](Ctrl c) { return c == CTRL_EMPTY; }); }
+
+			BitMask matchEmptyOrDeleted() const { return matchIf([](Ctrl c) { return c < 0; }); }
+#endif
+		};
+	}
+
+	/**
+	 * @brief Open addressing hash map with SIMD probing, laid out like a Swiss table.
+	 *
+	 * Keys and values live in one flat array of slots next to an array of control bytes.
+	 * A lookup hashes the key once, then compares 16 control bytes at a time against 7 bits
+	 * of the hash, so only slots that very likely hold the key are compared with it. Slots
+	 * are probed a group of 16 at a time, and a lookup stops at the first group with an
+	 * empty slot.
+	 *
+	 * The table grows when it is 7/8 full. Growing, rehashing and erasing move elements, so
+	 * pointers and iterators into the map are invalidated by any insert or erase.
+	 *
+	 * Relies on Hash mixing all of its bits; std::hash<UUID> does.
+	 */
+	template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+	class FlatHashMap
+	{
+	public:
+		using key_type = K;
+		using mapped_type = V;
+		using value_type = std::pair<K, V>;
+
+	private:
+		using Ctrl = detail::Ctrl;
+		using CtrlGroup = detail::CtrlGroup;
+
+		static constexpr size_t GROUP_WIDTH = CtrlGroup::WIDTH;
+
+		Ctrl* ctrl_{};
+		value_type* slots_{};
+		size_t capacity_ = 0;
+		size_t size_ = 0;
+
+		/*
+		* inserts left before the table has to grow, deleted slots don't give any back
+		*/
+		size_t growthLeft_ = 0;
+
+		Hash hash_{};
+		Eq eq_{};
+
+		static size_t h1(size_t hash) { return hash >> 7; }
+
+		static Ctrl h2(size_t hash) { return static_cast<Ctrl>(hash & 0x7f); }
+
+		static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+		/*
+		* visits groups in triangular order, which reaches every group of a power of two table
+		*/
+		struct ProbeSeq {
+			size_t group;
+			size_t mask;
+			size_t step = 0;
+
+			size_t offset() const { return group * GROUP_WIDTH; }
+
+			void next() {
+				group = (group + ++step) & mask;
+			}
+		};
+
+		ProbeSeq probe(size_t hash) const {
+			const size_t groupMask = capacity_ / GROUP_WIDTH - 1;
+			return ProbeSeq{ .group = h1(hash) & groupMask, .mask = groupMask };
+		}
+
+		template<typename Key>
+		size_t findIndex(const Key& key, size_t hash) const {
+			if (capacity_ == 0) {
+				return capacity_;
+			}
+			for (auto seq = probe(hash);; seq.next()) {
+				const CtrlGroup group(ctrl_ + seq.offset());
+				for (uint32_t i : group.match(h2(hash))) {
+					const size_t index = seq.offset() + i;
+					if (eq_(slots_[index].first, key)) [[likely]] {
+						return index;
+					}
+				}
+				if (group.matchEmpty()) {
+					return capacity_;
+				}
+			}
+		}
+
+		/*
+		* first empty or deleted slot on the key's probe sequence
+		*/
+		size_t findInsertIndex(size_t hash) const {
+			for (auto seq = probe(hash);; seq.next()) {
+				if (auto free = CtrlGroup(ctrl_ + seq.offset()).matchEmptyOrDeleted()) {
+					return seq.offset() + free.lowest();
+				}
+			}
+		}
+
+		void allocate(size_t capacity) {
+			ctrl_ = static_cast<Ctrl*>(::operator new(capacity, std::align_val_t{ GROUP_WIDTH }));
+			std::fill_n(ctrl_, capacity, detail::CTRL_EMPTY);
+			slots_ = std::allocator<value_type>{}.allocate(capacity);
+			capacity_ = capacity;
+			growthLeft_ = maxLoad(capacity) - size_;
+		}
+
+		void release(Ctrl* ctrl, value_type* slots, size_t capacity) {
+			if (!ctrl) {
+				return;
+			}
+			for (size_t i = 0; i != capacity; ++i) {
+				if (ctrl[i] >= 0) {
+					std::destroy_at(&slots[i]);
+				}
+			}
+			::operator delete(ctrl, std::align_val_t{ GROUP_WIDTH });
+			std::allocator<value_type>{}.deallocate(slots, capacity);
+		}
+
+		/*
+		* moves every element into a fresh table, which also drops the deleted markers
+		*/
+		void rehash(size_t capacity) {
+			Ctrl* oldCtrl = std::exchange(ctrl_, nullptr);
+			value_type* oldSlots = std::exchange(slots_, nullptr);
+			const size_t oldCapacity = capacity_;
+
+			allocate(capacity);
+			for (size_t i = 0; i != oldCapacity; ++i) {
+				if (oldCtrl[i] >= 0) {
+					const size_t hash = hash_(oldSlots[i].first);
+					const size_t index = findInsertIndex(hash);
+					ctrl_[index] = h2(hash);
+					std::construct_at(&slots_[index], std::move(oldSlots[i]));
+				}
+			}
+			release(oldCtrl, oldSlots, oldCapacity);
+		}
+
+		void makeRoomForInsert() {
+			if (growthLeft_ != 0) {
+				return;
+			}
+			if (capacity_ == 0) {
+				allocate(GROUP_WIDTH);
+			}
+			else if (size_ < maxLoad(capacity_) / 2) {
+				// mostly deleted markers, clean them out in place of growing
+				rehash(capacity_);
+			}
+			else {
+				rehash(capacity_ * 2);
+			}
+		}
+
+	public:
+		template<bool Const>
+		class Iterator
+		{
+			friend class FlatHashMap;
+
+			using Map = std::conditional_t<Const, const FlatHashMap, FlatHashMap>;
+
+			Map* map_{};
+			size_t index_ = 0;
+
+			void skipFree() {
+				while (index_ != map_->capacity_ && map_->ctrl_[index_] < 0) {
+					++index_;
+				}
+			}
+
+		public:
+			using value_type = typename FlatHashMap::value_type;
+			using reference = std::conditional_t<Const, const value_type&, value_type&>;
+			using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+			Iterator() = default;
+
+			/*
+			* the first element at or after index
+			*/
+			Iterator(Map* map, size_t index)
+				: map_(map), index_(index)
+			{
+				skipFree();
+			}
+
+			operator Iterator<true>() const { return Iterator<true>(map_, index_); }
+
+			reference operator*() const { return map_->slots_[index_]; }
+
+			pointer operator->() const { return &map_->slots_[index_]; }
+
+			Iterator& operator++() {
+				++index_;
+				skipFree();
+				return *this;
+			}
+
+			bool operator==(const Iterator& other) const { return index_ == other.index_; }
+		};
+
+		using iterator = Iterator<false>;
+		using const_iterator = Iterator<true>;
+
+		FlatHashMap() = default;
+
+		explicit FlatHashMap(size_t capacity) {
+			reserve(capacity);
+		}
+
+		FlatHashMap(const FlatHashMap&) = delete;
+		FlatHashMap& operator=(const FlatHashMap&) = delete;
+
+		FlatHashMap(FlatHashMap&& other) noexcept
+			: ctrl_(std::exchange(other.ctrl_, nullptr))
+			, slots_(std::exchange(other.slots_, nullptr))
+			, capacity_(std::exchange(other.capacity_, 0))
+			, size_(std::exchange(other.size_, 0))
+			, growthLeft_(std::exchange(other.growthLeft_, 0))
+		{
+		}
+
+		FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+			FlatHashMap tmp(std::move(other));
+			std::swap(ctrl_, tmp.ctrl_);
+			std::swap(slots_, tmp.slots_);
+			std::swap(capacity_, tmp.capacity_);
+			std::swap(size_, tmp.size_);
+			std::swap(growthLeft_, tmp.growthLeft_);
+			return *this;
+		}
+
+		~FlatHashMap() {
+			release(ctrl_, slots_, capacity_);
+		}
+
+		iterator begin() { return iterator(this, 0); }
+		iterator end() { return iterator(this, capacity_); }
+		const_iterator begin() const { return const_iterator(this, 0); }
+		const_iterator end() const { return const_iterator(this, capacity_); }
+
+		size_t size() const { return size_; }
+
+		bool empty() const { return size_ == 0; }
+
+		size_t capacity() const { return capacity_; }
+
+		/*
+		* makes room for count elements without growing again
+		*/
+		void reserve(size_t count) {
+			size_t capacity = std::max(GROUP_WIDTH, capacity_);
+			while (maxLoad(capacity) < count) {
+				capacity *= 2;
+			}
+			if (capacity != capacity_) {
+				rehash(capacity);
+			}
+		}
+
+		void clear() {
+			release(ctrl_, slots_, capacity_);
+			ctrl_ = nullptr;
+			slots_ = nullptr;
+			capacity_ = 0;
+			size_ = 0;
+			growthLeft_ = 0;
+		}
+
+		iterator find(const K& key) {
+			return iterator(this, findIndex(key, hash_(key)));
+		}
+
+		const_iterator find(const K& key) const {
+			return const_iterator(this, findIndex(key, hash_(key)));
+		}
+
+		bool contains(const K& key) const {
+			return findIndex(key, hash_(key)) != capacity_;
+		}
+
+		/*
+		* inserts key with a value made from args, unless the key is already in the map
+		*/
+		template<typename... Args>
+		std::pair<iterator, bool> emplace(const K& key, Args&&... args) {
+			const size_t hash = hash_(key);
+			if (const size_t index = findIndex(key, hash); index != capacity_) {
+				return { iterator(this, index), false };
+			}
+
+			makeRoomForInsert();
+			const size_t index = findInsertIndex(hash);
+			std::construct_at(&slots_[index], std::piecewise_construct,
+				std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+			growthLeft_ -= ctrl_[index] == detail::CTRL_EMPTY;
+			ctrl_[index] = h2(hash);
+			++size_;
+			return { iterator(this, index), true };
+		}
+
+		V& operator[](const K& key) {
+			return emplace(key).first->second;
+		}
+
+		void erase(iterator it) {
+			const size_t index = it.index_;
+			std::destroy_at(&slots_[index]);
+			--size_;
+
+			// a lookup only moves past a group that has never had an empty slot, so if this
+			// group still has one no probe sequence can depend on the slot staying occupied
+			const size_t groupStart = index & ~(GROUP_WIDTH - 1);
+			if (CtrlGroup(ctrl_ + groupStart).matchEmpty()) {
+				ctrl_[index] = detail::CTRL_EMPTY;
+				++growthLeft_;
+			}
+			else {
+				ctrl_[index] = detail::CTRL_DELETED;
+			}
+		}
+
+		/*
+		* returns the number of elements removed, 0 or 1
+		*/
+		size_t erase(const K& key) {
+			const size_t index = findIndex(key, hash_(key));
+			if (index == capacity_) {
+				return 0;
+			}
+			erase(iterator(this, index));
+			return 1;
+		}
+	};
+
+	/*
+	* the map used for anything keyed by class, asset or entity UUIDs
+	*/
+	template<typename V>
+	using UUIDMap = FlatHashMap<UUID, V>;
+}
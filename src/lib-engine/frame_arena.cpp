@@ -0,0 +1,328 @@
+#include "frame_arena.hpp"
+#include "application_context.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace
+{
+	static constexpr std::string_view CAPACITY_PROP_NAME{ "memory.frame-arena.capacity" };
+	static constexpr std::string_view BUFFER_COUNT_PROP_NAME{ "memory.frame-arena.buffer-count" };
+
+	std::atomic<qf::u64> heapAllocationCount_{};
+}
+
+namespace qf
+{
+	LinearArena::LinearArena(size_t capacity)
+	{
+		grow(capacity);
+	}
+
+	LinearArena::~LinearArena()
+	{
+		for (auto const& chunk : chunks_) {
+			::operator delete(chunk.data, std::align_val_t{ alignof(std::max_align_t) });
+		}
+	}
+
+	void LinearArena::grow(size_t minimumSize)
+	{
+		const size_t size = std::max(minimumSize, chunks_.empty() ? size_t{} : chunks_.back().size * 2);
+		auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t{ alignof(std::max_align_t) }));
+		chunks_.push_back(Chunk{ data, size });
+		cursor_ = data;
+		end_ = data + size;
+		++growCount_;
+	}
+
+	void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+	{
+		auto aligned = [&] {
+			const auto address = reinterpret_cast<uintptr_t>(cursor_);
+			return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+		};
+
+		std::byte* p = aligned();
+		if (p + bytes > end_) {
+			grow(bytes + alignment);
+			p = aligned();
+		}
+		cursor_ = p + bytes;
+		bytesUsed_ += bytes;
+		return p;
+	}
+
+	void LinearArena::reset()
+	{
+		if (chunks_.size() > 1) {
+			// fold the chunks into one that fits everything the arena has needed so far
+			size_t total = 0;
+			for (auto const& chunk : chunks_) {
+				total += chunk.size;
+				::operator delete(chunk.data, std::align_val_t{ alignof(std::max_align_t) });
+			}
+			chunks_.clear();
+			grow(total);
+		}
+		cursor_ = chunks_.front().data;
+		end_ = cursor_ + chunks_.front().size;
+		bytesUsed_ = 0;
+	}
+
+	namespace
+	{
+		struct Totals {
+			u64 allocations = 0;
+			u64 bytes = 0;
+			u64 growths = 0;
+		};
+
+		class ThreadArenas;
+
+		struct Globals {
+			FrameArena::Settings settings{};
+			std::atomic<u64> frameIndex{};
+
+			std::mutex mutex{};
+			std::vector<ThreadArenas*> threads{};
+			Totals retired{};
+			Totals lastTotals{};
+			u64 lastHeapAllocations = 0;
+			FrameArena::Stats stats{};
+		};
+
+		Globals& globals() {
+			static Globals instance;
+			return instance;
+		}
+
+		/*
+		* the arenas of one thread. allocations are routed to the buffer of the current frame,
+		* which is reset the first time the thread allocates in a new frame
+		*/
+		class ThreadArenas
+			: public std::pmr::memory_resource
+		{
+			std::vector<Box<LinearArena>> buffers_{};
+			LinearArena* current_{};
+			u64 frameIndex_ = ~0ull;
+
+			/*
+			* written by the owning thread only, read by beginFrame() on the main thread
+			*/
+			std::atomic<u64> allocations_{};
+			std::atomic<u64> bytes_{};
+			std::atomic<u64> growths_{};
+
+			static void bump(std::atomic<u64>& counter, u64 amount) {
+				counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+			}
+
+		protected:
+			virtual void* do_allocate(size_t bytes, size_t alignment) override {
+				const u64 frameIndex = globals().frameIndex.load(std::memory_order_relaxed);
+				if (frameIndex != frameIndex_) {
+					frameIndex_ = frameIndex;
+					current_ = buffers_[frameIndex % buffers_.size()].get();
+					current_->reset();
+				}
+
+				const u64 grown = current_->getGrowCount();
+				void* p = current_->allocate(bytes, alignment);
+				if (current_->getGrowCount() != grown) {
+					bump(growths_, 1);
+				}
+				bump(allocations_, 1);
+				bump(bytes_, bytes);
+				return p;
+			}
+
+			virtual void do_deallocate(void*, size_t, size_t) override {}
+
+			virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+				return this == &other;
+			}
+
+		public:
+			ThreadArenas() {
+				auto& g = globals();
+				std::lock_guard lock(g.mutex);
+				for (u32 i = 0; i != std::max(1u, g.settings.bufferCount); ++i) {
+					buffers_.emplace_back(makeBox<LinearArena>(g.settings.capacity));
+				}
+				g.threads.push_back(this);
+			}
+
+			virtual ~ThreadArenas() override {
+				auto& g = globals();
+				std::lock_guard lock(g.mutex);
+				std::erase(g.threads, this);
+				addTo(g.retired);
+			}
+
+			void addTo(Totals& totals) const {
+				totals.allocations += allocations_.load(std::memory_order_relaxed);
+				totals.bytes += bytes_.load(std::memory_order_relaxed);
+				totals.growths += growths_.load(std::memory_order_relaxed);
+			}
+		};
+
+		ThreadArenas& threadArenas() {
+			static thread_local ThreadArenas arenas;
+			return arenas;
+		}
+	}
+
+	auto FrameArena::Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		if (auto value = config->getInt(CAPACITY_PROP_NAME)) {
+			settings.capacity = static_cast<size_t>(*value);
+		}
+		if (auto value = config->getInt(BUFFER_COUNT_PROP_NAME)) {
+			settings.bufferCount = static_cast<u32>(*value);
+		}
+		return settings;
+	}
+
+	void FrameArena::initialize(const Settings& settings)
+	{
+		auto& g = globals();
+		std::lock_guard lock(g.mutex);
+		g.settings = settings;
+	}
+
+	void FrameArena::beginFrame(u64 frameIndex)
+	{
+		auto& g = globals();
+		const u64 previousFrame = g.frameIndex.exchange(frameIndex, std::memory_order_relaxed);
+
+		std::lock_guard lock(g.mutex);
+		Totals totals = g.retired;
+		for (auto const* thread : g.threads) {
+			thread->addTo(totals);
+		}
+		const u64 heapAllocations = getHeapAllocationCount();
+
+		g.stats = Stats{
+			.frameIndex = previousFrame,
+			.arenaAllocations = totals.allocations - g.lastTotals.allocations,
+			.arenaBytes = totals.bytes - g.lastTotals.bytes,
+			.arenaGrowths = totals.growths - g.lastTotals.growths,
+			.heapAllocations = heapAllocations - g.lastHeapAllocations,
+		};
+		g.lastTotals = totals;
+		g.lastHeapAllocations = heapAllocations;
+	}
+
+	std::pmr::memory_resource* FrameArena::get()
+	{
+		return &threadArenas();
+	}
+
+	auto FrameArena::getLastFrameStats() -> const Stats&
+	{
+		return globals().stats;
+	}
+
+	u64 FrameArena::getHeapAllocationCount()
+	{
+		return heapAllocationCount_.load(std::memory_order_relaxed);
+	}
+}
+
+#if defined(QF_TRACK_HEAP_ALLOCATIONS)
+
+/*
+* global allocation functions that count every call, so steady state frames can be
+* checked for heap allocations. the aligned forms have to be replaced as a set because
+* msvc can't free aligned_alloc memory with free()
+*/
+
+namespace
+{
+	void* countedAllocate(size_t size) {
+		heapAllocationCount_.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+
+	void* countedAllocateAligned(size_t size, std::align_val_t alignment) {
+		heapAllocationCount_.fetch_add(1, std::memory_order_relaxed);
+		const size_t align = static_cast<size_t>(alignment);
+#if defined(_MSC_VER)
+		return _aligned_malloc(size ? size : 1, align);
+#else
+		return std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) & ~(align - 1));
+#endif
+	}
+
+	void freeAligned(void* p) {
+#if defined(_MSC_VER)
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+void* operator new(size_t size) {
+	if (void* p = countedAllocate(size)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return countedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	if (void* p = countedAllocateAligned(size, alignment)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return countedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return countedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+
+#endif
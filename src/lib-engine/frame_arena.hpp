@@ -0,0 +1,143 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <memory_resource>
+#include <vector>
+
+namespace qf
+{
+	/**
+	 * @brief A bump allocator exposed as a std::pmr::memory_resource.
+	 *
+	 * Allocating moves a cursor through the current chunk and deallocating does nothing; all
+	 * memory is released at once by reset(). When a chunk runs out another one is taken from
+	 * the global heap, and the next reset() folds them into a single chunk big enough for
+	 * everything, so an arena stops touching the heap once it has seen its peak usage.
+	 */
+	class LinearArena
+		: public std::pmr::memory_resource
+		, NonCopyable
+	{
+		struct Chunk {
+			std::byte* data;
+			size_t size;
+		};
+
+		std::vector<Chunk> chunks_{};
+		std::byte* cursor_{};
+		std::byte* end_{};
+		size_t bytesUsed_ = 0;
+		u64 growCount_ = 0;
+
+		void grow(size_t minimumSize);
+
+	protected:
+		virtual void* do_allocate(size_t bytes, size_t alignment) override;
+
+		virtual void do_deallocate(void*, size_t, size_t) override {}
+
+		virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+	public:
+		explicit LinearArena(size_t capacity);
+
+		virtual ~LinearArena() override;
+
+		/*
+		* releases everything allocated since the last reset
+		*/
+		void reset();
+
+		size_t getBytesUsed() const { return bytesUsed_; }
+
+		/*
+		* number of times the arena had to take another chunk from the heap
+		*/
+		u64 getGrowCount() const { return growCount_; }
+	};
+
+	/**
+	 * @brief Per-thread, multi-buffered linear arenas that reset at frame boundaries.
+	 *
+	 * Every thread gets bufferCount arenas and allocates from the one for the current frame.
+	 * Memory handed out during frame N stays valid until frame N + bufferCount begins, so work
+	 * started in one frame can keep using its scratch memory while the next frame is built.
+	 * Nothing allocated from a frame arena may be kept longer than that.
+	 *
+	 * Containers use it through std::pmr, eg std::pmr::vector<u32> v(FrameArena::get()).
+	 */
+	class FrameArena
+	{
+	public:
+		struct Settings {
+			/*
+			* initial size of each thread's arena per buffer, arenas grow past it when needed
+			*/
+			size_t capacity = 1 << 20;
+
+			u32 bufferCount = 2;
+
+			static Settings fromConfig();
+		};
+
+		struct Stats {
+			u64 frameIndex;
+
+			/*
+			* allocations and bytes served by the frame arenas, over all threads
+			*/
+			u64 arenaAllocations;
+			u64 arenaBytes;
+
+			/*
+			* times an arena outgrew its chunk and went to the heap
+			*/
+			u64 arenaGrowths;
+
+			/*
+			* global operator new calls, only counted in builds with QF_TRACK_HEAP_ALLOCATIONS
+			*/
+			u64 heapAllocations;
+		};
+
+		/*
+		* must be called before any thread uses a frame arena
+		*/
+		static void initialize(const Settings& settings);
+
+		/*
+		* starts a frame. each thread resets its arena for the frame the first time it
+		* allocates from it
+		*/
+		static void beginFrame(u64 frameIndex);
+
+		/*
+		* the calling thread's arena for the current frame
+		*/
+		static std::pmr::memory_resource* get();
+
+		/*
+		* totals for the frame before the one most recently started with beginFrame()
+		*/
+		static const Stats& getLastFrameStats();
+
+		/*
+		* global operator new calls since startup, 0 unless built with QF_TRACK_HEAP_ALLOCATIONS
+		*/
+		static u64 getHeapAllocationCount();
+	};
+}
+
+template<>
+struct std::formatter<qf::FrameArena::Stats> {
+	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
+		return ctx.end();
+	}
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		return format_to(ctx.out(), "frame {} arena: {} allocations, {} bytes, {} growths, {} heap allocations",
+			val.frameIndex, val.arenaAllocations, val.arenaBytes, val.arenaGrowths, val.heapAllocations);
+	}
+};
@@ -0,0 +1,198 @@
+#include "frame_graph.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <unordered_map>
+
+namespace qf
+{
+	namespace
+	{
+		constexpr u32 NO_STAGE = TaskDependencies::NO_TASK;
+
+		using Clock = std::chrono::steady_clock;
+
+		double millisecondsSince(Clock::time_point start, Clock::time_point now) {
+			return std::chrono::duration<double, std::milli>(now - start).count();
+		}
+
+		bool intersects(const std::vector<u32>& a, const std::vector<u32>& b) {
+			return std::any_of(a.begin(), a.end(), [&](u32 r) {
+				return std::find(b.begin(), b.end(), r) != b.end();
+			});
+		}
+	}
+
+	Expected<void> FrameGraph::addStage(StageDesc&& desc)
+	{
+		if (compiled_) {
+			return std::unexpected("frame graph is already compiled");
+		}
+		if (!desc.fn) {
+			return std::unexpected(std::format("stage {} has no function", desc.name));
+		}
+		auto sameName = [&](const StageDesc& stage) { return stage.name == desc.name; };
+		if (std::any_of(stages_.begin(), stages_.end(), sameName)) {
+			return std::unexpected(std::format("duplicate stage {}", desc.name));
+		}
+		stages_.emplace_back(std::move(desc));
+		return {};
+	}
+
+	Expected<void> FrameGraph::compile()
+	{
+		if (compiled_) {
+			return std::unexpected("frame graph is already compiled");
+		}
+
+		// resources are only named while building, stages compare them by index
+		std::unordered_map<std::string, u32> resourceIds;
+		auto resolve = [&](const std::vector<std::string>& names) {
+			std::vector<u32> ids;
+			for (auto const& name : names) {
+				auto [it, inserted] = resourceIds.emplace(name, static_cast<u32>(resourceIds.size()));
+				ids.push_back(it->second);
+			}
+			return ids;
+		};
+
+		std::vector<std::vector<u32>> reads, writes;
+		for (auto const& stage : stages_) {
+			reads.emplace_back(resolve(stage.reads));
+			writes.emplace_back(resolve(stage.writes));
+		}
+
+		// declaration order is the tie breaker, so dependencies always point at earlier stages
+		for (u32 i = 0; i != stages_.size(); ++i) {
+			dependencies_.addTask();
+			for (u32 j = 0; j != i; ++j) {
+				const bool conflict = intersects(reads[i], writes[j])
+					|| intersects(writes[i], reads[j])
+					|| intersects(writes[i], writes[j]);
+				if (conflict) {
+					dependencies_.addDependency(i, j);
+				}
+			}
+		}
+
+		const auto count = stages_.size();
+		remaining_ = std::make_unique<std::atomic<u32>[]>(count);
+		mainThreadReady_.reserve(count);
+		finishMs_.resize(count);
+		stats_.stages.resize(count);
+		for (u32 i = 0; i != count; ++i) {
+			stats_.stages[i].name = stages_[i].name;
+			stats_.stages[i].mainThread = stages_[i].mainThread;
+		}
+
+		compiled_ = true;
+		return {};
+	}
+
+	Expected<void> FrameGraph::execute(jobs::JobSystem& jobSystem, const FrameInfo& info)
+	{
+		if (!compiled_) {
+			return std::unexpected("frame graph must be compiled before it is executed");
+		}
+
+		const u32 count = static_cast<u32>(stages_.size());
+		frameStart_ = Clock::now();
+		completed_.store(0, std::memory_order_relaxed);
+		error_.reset();
+		for (u32 i = 0; i != count; ++i) {
+			remaining_[i].store(static_cast<u32>(dependencies_.getDependencies(i).size()), std::memory_order_relaxed);
+		}
+
+		jobs::Counter counter;
+		jobSystem_ = &jobSystem;
+		info_ = &info;
+		counter_ = &counter;
+
+		for (u32 i = 0; i != count; ++i) {
+			if (dependencies_.getDependencies(i).empty()) {
+				schedule(i);
+			}
+		}
+
+		// the calling thread runs main thread stages as they become ready and helps with
+		// the rest in between
+		while (completed_.load(std::memory_order_acquire) != count) {
+			u32 next = NO_STAGE;
+			{
+				std::lock_guard lock(mainThreadMutex_);
+				if (!mainThreadReady_.empty()) {
+					next = mainThreadReady_.back();
+					mainThreadReady_.pop_back();
+				}
+			}
+			if (next != NO_STAGE) {
+				runStage(next);
+			}
+			else if (!jobSystem.runOne()) {
+				std::this_thread::yield();
+			}
+		}
+		jobSystem.wait(counter);
+		jobSystem_ = nullptr;
+		info_ = nullptr;
+		counter_ = nullptr;
+
+		stats_.frameIndex = info.frameIndex;
+		stats_.frameMs = millisecondsSince(frameStart_, Clock::now());
+		stats_.criticalPathMs = dependencies_.markCriticalPath(finishMs_, stats_.stages);
+		if (error_) {
+			return std::unexpected(std::move(*error_));
+		}
+		return {};
+	}
+
+	void FrameGraph::schedule(u32 index)
+	{
+		if (stages_[index].mainThread) {
+			std::lock_guard lock(mainThreadMutex_);
+			mainThreadReady_.push_back(index);
+			return;
+		}
+		jobSystem_->run([this, index] { runStage(index); }, counter_);
+	}
+
+	void FrameGraph::setError(std::string&& error)
+	{
+		std::lock_guard lock(errorMutex_);
+		if (!error_) {
+			error_.emplace(std::move(error));
+		}
+	}
+
+	void FrameGraph::runStage(u32 index)
+	{
+		const auto start = Clock::now();
+		// a stage that throws still counts as finished, so its dependents run and the frame
+		// ends. the first error is returned from execute()
+		try {
+			QF_PROFILE_ZONE(stages_[index].name.c_str());
+			stages_[index].fn(*info_);
+		}
+		catch (const std::exception& e) {
+			setError(std::format("stage {} threw: {}", stages_[index].name, e.what()));
+		}
+		catch (...) {
+			setError(std::format("stage {} threw", stages_[index].name));
+		}
+		const auto end = Clock::now();
+
+		auto& timing = stats_.stages[index];
+		timing.startMs = millisecondsSince(frameStart_, start);
+		timing.durationMs = millisecondsSince(start, end);
+		finishMs_[index] = millisecondsSince(frameStart_, end);
+
+		for (u32 dependent : dependencies_.getDependents(index)) {
+			if (remaining_[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				schedule(dependent);
+			}
+		}
+		completed_.fetch_add(1, std::memory_order_acq_rel);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "job_system.hpp"
+#include "task_graph.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace qf
+{
+	struct FrameInfo {
+		u64 frameIndex;
+		float timeDelta;
+
+		/*
+		* number of fixed simulation steps of fixedTimeDelta seconds to run this frame
+		*/
+		u32 fixedSteps;
+		float fixedTimeDelta;
+		float interpolationAlpha;
+	};
+
+	/**
+	 * @brief Runs the stages of a frame in dependency order, in parallel where possible.
+	 *
+	 * Stages name the pieces of engine state they read and write, eg "platform.events".
+	 * A stage runs after every earlier stage it conflicts with: one that writes what it reads,
+	 * reads what it writes, or writes what it writes. Stages that don't conflict run at the
+	 * same time on the job system. Stages that must stay on the thread calling execute(),
+	 * such as pumping SDL events, set mainThread.
+	 *
+	 * After each frame getLastFrameStats() holds the time spent in every stage and the
+	 * critical path: the chain of dependent stages that limited the frame time.
+	 */
+	class FrameGraph : NonCopyable
+	{
+	public:
+		using StageFn = std::function<void(const FrameInfo&)>;
+
+		struct StageDesc {
+			std::string name;
+			std::vector<std::string> reads;
+			std::vector<std::string> writes;
+			StageFn fn;
+			bool mainThread = false;
+		};
+
+		using StageTiming = TaskTiming;
+
+		struct FrameStats {
+			u64 frameIndex;
+			double frameMs;
+			double criticalPathMs;
+			std::vector<StageTiming> stages;
+		};
+
+		/*
+		* adds a stage. stages can only be added before compile()
+		*/
+		Expected<void> addStage(StageDesc&& desc);
+
+		/*
+		* resolves the dependencies between the stages added so far
+		*/
+		Expected<void> compile();
+
+		/*
+		* runs every stage once and returns when they have all finished. a stage that throws
+		* doesn't hold up the rest, execute() returns the first such error once they're done
+		*/
+		Expected<void> execute(jobs::JobSystem& jobSystem, const FrameInfo& info);
+
+		const FrameStats& getLastFrameStats() const { return stats_; }
+
+	private:
+		std::vector<StageDesc> stages_{};
+		TaskDependencies dependencies_{};
+		bool compiled_ = false;
+
+		/*
+		* per frame execution state
+		*/
+		Box<std::atomic<u32>[]> remaining_{};
+		std::atomic<u32> completed_{};
+		std::mutex mainThreadMutex_{};
+		std::vector<u32> mainThreadReady_{};
+		std::vector<double> finishMs_{};
+		std::chrono::steady_clock::time_point frameStart_{};
+		std::mutex errorMutex_{};
+		std::optional<Err> error_{};
+
+		/*
+		* only valid during execute(). kept here rather than captured so the job
+		* closures stay small enough for std::function not to allocate
+		*/
+		jobs::JobSystem* jobSystem_{};
+		const FrameInfo* info_{};
+		jobs::Counter* counter_{};
+
+		FrameStats stats_{};
+
+		void schedule(u32 index);
+		void runStage(u32 index);
+		void setError(std::string&& error);
+	};
+}
+
+template<>
+struct std::formatter<qf::FrameGraph::FrameStats> {
+	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
+		return ctx.end();
+	}
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		auto out = format_to(ctx.out(), "frame {}: {:.3f} ms, critical path {:.3f} ms\n",
+			val.frameIndex, val.frameMs, val.criticalPathMs);
+		for (auto const& stage : val.stages) {
+			out = format_to(out, "{}", stage);
+		}
+		return out;
+	}
+};
@@ -0,0 +1,169 @@
+#include "frame_pacer.hpp"
+#include "platform_interface.hpp"
+#include "application_context.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	static constexpr std::string_view TARGET_RATE_PROP_NAME{ "frame.target-rate" };
+	static constexpr std::string_view FIXED_RATE_PROP_NAME{ "frame.fixed-rate" };
+	static constexpr std::string_view MAX_FIXED_STEPS_PROP_NAME{ "frame.max-fixed-steps" };
+
+	/*
+	* longest frame time fed to the fixed step accumulator, so a stall doesn't turn
+	* into a burst of catch up steps
+	*/
+	static constexpr std::chrono::milliseconds MAX_FRAME_TIME{ 250 };
+
+	/*
+	* blocking waits are whole slices. platform waits count in milliseconds, and one asked to
+	* wait less returns straight away, so what is left short of a slice is spun
+	*/
+	static constexpr std::chrono::microseconds WAIT_SLICE{ 1000 };
+
+	/*
+	* the most time kept back for blocking waits to return late in, however late they do
+	*/
+	static constexpr std::chrono::duration<double> MAX_SPIN{ 2e-3 };
+
+	void cpuRelax() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		_mm_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	std::chrono::steady_clock::duration periodFromRate(double rate) {
+		if (rate <= 0) {
+			return {};
+		}
+		return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+	}
+}
+
+namespace qf
+{
+	auto FramePacer::Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		settings.targetRate = config->getFloat(TARGET_RATE_PROP_NAME).value_or(settings.targetRate);
+		settings.fixedRate = config->getFloat(FIXED_RATE_PROP_NAME).value_or(settings.fixedRate);
+		if (auto value = config->getInt(MAX_FIXED_STEPS_PROP_NAME)) {
+			settings.maxFixedSteps = static_cast<u32>(*value);
+		}
+		return settings;
+	}
+
+	FramePacer::FramePacer(const Settings& settings)
+		: settings_(settings)
+		, period_(periodFromRate(settings.targetRate))
+		, fixedPeriod_(periodFromRate(settings.fixedRate))
+	{
+	}
+
+	void FramePacer::setSettings(const Settings& settings)
+	{
+		settings_ = settings;
+		period_ = periodFromRate(settings.targetRate);
+		fixedPeriod_ = periodFromRate(settings.fixedRate);
+		accumulator_ = {};
+	}
+
+	auto FramePacer::beginFrame() -> FrameTiming
+	{
+		const auto now = Clock::now();
+		const auto elapsed = lastFrame_ == Clock::time_point{} ? Clock::duration{} : now - lastFrame_;
+		lastFrame_ = now;
+
+		FrameTiming timing{
+			.timeDelta = std::chrono::duration<float>(elapsed).count(),
+			.fixedSteps = 1,
+			.fixedTimeDelta = std::chrono::duration<float>(elapsed).count(),
+			.interpolationAlpha = 1.f,
+		};
+
+		if (fixedPeriod_ == Clock::duration{}) {
+			return timing;
+		}
+
+		accumulator_ += std::min<Clock::duration>(elapsed, MAX_FRAME_TIME);
+		const auto steps = accumulator_ / fixedPeriod_;
+		accumulator_ -= steps * fixedPeriod_;
+		if (steps > settings_.maxFixedSteps) {
+			// can't keep up, let the simulation run slower rather than fall further behind
+			accumulator_ = {};
+		}
+
+		timing.fixedSteps = static_cast<u32>(std::min<s64>(steps, settings_.maxFixedSteps));
+		timing.fixedTimeDelta = std::chrono::duration<float>(fixedPeriod_).count();
+		timing.interpolationAlpha = std::chrono::duration<float>(accumulator_).count() / timing.fixedTimeDelta;
+		return timing;
+	}
+
+	void FramePacer::waitForNextFrame(PlatformInterface* platform)
+	{
+		if (period_ == Clock::duration{}) {
+			return;
+		}
+
+		const auto now = Clock::now();
+		nextDeadline_ += period_;
+		if (nextDeadline_ < now - period_ || nextDeadline_ > now + period_) {
+			// more than a frame late, or the first frame. restart the schedule from now
+			// instead of rushing out frames to catch up
+			nextDeadline_ = now + period_;
+		}
+
+		// block a slice at a time while a whole one fits before the time a wait might
+		// overshoot by, spin the rest
+		const std::chrono::duration<double> spin{ std::min(overshootEstimate_, MAX_SPIN.count()) };
+		while (nextDeadline_ - Clock::now() - spin >= WAIT_SLICE) {
+			blockFor(platform, WAIT_SLICE);
+		}
+
+		while (Clock::now() < nextDeadline_) {
+			cpuRelax();
+		}
+	}
+
+	void FramePacer::blockFor(PlatformInterface* platform, std::chrono::microseconds timeout)
+	{
+		const auto start = Clock::now();
+		if (platform) {
+			platform->waitEvents(timeout);
+		}
+		else {
+			std::this_thread::sleep_for(timeout);
+		}
+		const double overshoot = std::chrono::duration<double>(Clock::now() - start - timeout).count();
+
+		// an event cut the wait short, it says nothing about how late waits return
+		if (overshoot < 0) {
+			return;
+		}
+
+		// Welford's running variance, the estimate is one standard deviation above the mean
+		++waitCount_;
+		const double delta = overshoot - overshootMean_;
+		overshootMean_ += delta / waitCount_;
+		overshootM2_ += delta * (overshoot - overshootMean_);
+		if (waitCount_ > 1) {
+			overshootEstimate_ = overshootMean_ + std::sqrt(overshootM2_ / (waitCount_ - 1));
+		}
+	}
+}
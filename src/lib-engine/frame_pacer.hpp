@@ -0,0 +1,96 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <chrono>
+
+namespace qf
+{
+	class PlatformInterface;
+
+	/**
+	 * @brief Paces the main loop to a target frame rate and splits frame time into fixed
+	 * simulation steps.
+	 *
+	 * Waiting is done in two parts. Most of the time until the next frame is spent blocked in
+	 * the platform's event wait, which returns early when input arrives, and the last part is
+	 * spun so the deadline is hit to within a few microseconds. How much to spin is learned
+	 * from how late the blocking waits return on this machine, and is less than a 1 ms wait
+	 * slice plus at most 2 ms kept back for waits that return late.
+	 */
+	class FramePacer : NonCopyable
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Settings {
+			/*
+			* frames per second to pace to, 0 runs uncapped
+			*/
+			double targetRate = 0;
+
+			/*
+			* simulation steps per second, 0 steps the simulation once per frame
+			*/
+			double fixedRate = 0;
+
+			/*
+			* most fixed steps run in one frame, the rest of a long frame is dropped
+			*/
+			u32 maxFixedSteps = 5;
+
+			static Settings fromConfig();
+		};
+
+		struct FrameTiming {
+			float timeDelta;
+			u32 fixedSteps;
+			float fixedTimeDelta;
+
+			/*
+			* how far the frame is between the last fixed step and the next one, for
+			* interpolating the simulation state when rendering
+			*/
+			float interpolationAlpha;
+		};
+
+		FramePacer(const Settings& settings);
+
+		/*
+		* changes the rates, taking effect from the next frame
+		*/
+		void setSettings(const Settings& settings);
+
+		/*
+		* starts a frame and measures the time since the previous one
+		*/
+		FrameTiming beginFrame();
+
+		/*
+		* returns once the next frame is due, blocking in platform->waitEvents() when
+		* a platform is given
+		*/
+		void waitForNextFrame(PlatformInterface* platform);
+
+	private:
+		Settings settings_;
+		Clock::duration period_{};
+		Clock::duration fixedPeriod_{};
+
+		Clock::time_point lastFrame_{};
+		Clock::time_point nextDeadline_{};
+		Clock::duration accumulator_{};
+
+		/*
+		* running mean and variance of how much later than asked blocking waits return, and
+		* the estimate spun for at the end of a frame. it starts small and is only replaced
+		* once two real waits have been measured
+		*/
+		double overshootEstimate_ = 200e-6;
+		double overshootMean_ = 0;
+		double overshootM2_ = 0;
+		u64 waitCount_ = 0;
+
+		void blockFor(PlatformInterface* platform, std::chrono::microseconds timeout);
+	};
+}
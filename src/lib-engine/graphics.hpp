@@ -1,6 +1,7 @@
 #pragma once
 
 #include "engine80.hpp"
+#include "service_slot.hpp"
 #include <optional>
 
 
@@ -10,7 +11,24 @@ namespace qf {
 
 	struct Graphics : public Serializable
 	{
-		virtual Expected<void> initialize() = 0;
+		static constexpr std::string_view SERVICE_NAME{ "graphics" };
+		static constexpr ServiceSlot SERVICE_SLOT = ServiceSlot::Graphics;
+
+		/*
+		* the part of initialize() that doesn't need the platform's window, so it can run on
+		* another thread while the platform starts up
+		*/
+		virtual Expected<void> initializeInstance() = 0;
+
+		/*
+		* the rest of initialize(), once the platform has created its window
+		*/
+		virtual Expected<void> initializeSurface() = 0;
+
+		Expected<void> initialize() {
+			TRY_EXPR_IGNORE_VALUE(initializeInstance());
+			return initializeSurface();
+		}
 
 		virtual std::optional<ptr<PlatformInterface>> getPlatform() const = 0;
 
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+namespace qf
+{
+	namespace detail
+	{
+		/*
+		* splitmix64 finalizer, every input bit affects every output bit
+		*/
+		constexpr uint64_t mix64(uint64_t x) {
+			x ^= x >> 30;
+			x *= 0xbf58476d1ce4e5b9ull;
+			x ^= x >> 27;
+			x *= 0x94d049bb133111ebull;
+			return x ^ (x >> 31);
+		}
+	}
+
+	/*
+	* 64 bit hash of a block of memory, eight bytes at a time. stable across runs and
+	* machines of the same endianness, so it can be stored in files
+	*/
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+		auto const* p = static_cast<const unsigned char*>(data);
+		uint64_t h = detail::mix64(seed ^ size);
+		for (; size >= 8; p += 8, size -= 8) {
+			uint64_t word;
+			std::memcpy(&word, p, 8);
+			h = detail::mix64(h ^ word) * 0x9e3779b97f4a7c15ull;
+		}
+		uint64_t tail = 0;
+		if (size != 0) {
+			std::memcpy(&tail, p, size);
+		}
+		return detail::mix64(h ^ tail);
+	}
+
+	inline uint64_t hashString(std::string_view s, uint64_t seed = 0) {
+		return hashBytes(s.data(), s.size(), seed);
+	}
+}
@@ -0,0 +1,118 @@
+#include "headless_platform_interface.hpp"
+#include "application_context.hpp"
+#include "class_ids.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	static constexpr std::string_view WINDOW_WIDTH_PROP_NAME{ "platform.headless.window.width" };
+	static constexpr std::string_view WINDOW_HEIGHT_PROP_NAME{ "platform.headless.window.height" };
+	static constexpr std::string_view TICK_RATE_PROP_NAME{ "platform.headless.tick-rate" };
+	static constexpr std::string_view EVENTS_PROP_NAME{ "platform.headless.events" };
+}
+
+namespace qf
+{
+	std::expected<void, std::string> HeadlessPlatformInterface::postConstruct()
+	{
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return {};
+		}
+
+		const auto config = ctx->getConfig();
+		width_ = static_cast<int>(config->getInt(WINDOW_WIDTH_PROP_NAME).value_or(width_));
+		height_ = static_cast<int>(config->getInt(WINDOW_HEIGHT_PROP_NAME).value_or(height_));
+		if (const double rate = config->getFloat(TICK_RATE_PROP_NAME).value_or(0); rate > 0) {
+			tickDuration_ = std::chrono::duration_cast<Duration>(std::chrono::duration<double>(1.0 / rate));
+		}
+
+		for (size_t i = 0; i != config->getSize(EVENTS_PROP_NAME); ++i) {
+			const std::string item = std::format("{}.{}.", EVENTS_PROP_NAME, i);
+			const auto time = config->getFloat(item + "time");
+			const auto type = config->getString(item + "type");
+			if (!time || !type) {
+				return std::unexpected(std::format("headless event {} needs a time and a type", i));
+			}
+
+			Event event{
+				.type = Event::Type::Quit,
+				.time = std::chrono::duration_cast<Duration>(std::chrono::duration<double>(*time)),
+			};
+			if (*type == "resize") {
+				event.type = Event::Type::Resize;
+				event.width = static_cast<int>(config->getInt(item + "width").value_or(width_));
+				event.height = static_cast<int>(config->getInt(item + "height").value_or(height_));
+			}
+			else if (*type != "quit") {
+				return std::unexpected(std::format("unknown headless event type {}", *type));
+			}
+			scheduleEvent(event);
+		}
+		return {};
+	}
+
+	std::expected<void, std::string> HeadlessPlatformInterface::initialize()
+	{
+		return {};
+	}
+
+	bool HeadlessPlatformInterface::update(float timeDelta)
+	{
+		++tickCount_;
+		time_ += tickDuration_ != Duration{}
+			? tickDuration_
+			: std::chrono::duration_cast<Duration>(std::chrono::duration<float>(timeDelta));
+
+		while (nextEvent_ != events_.size() && events_[nextEvent_].time <= time_) {
+			fire(events_[nextEvent_++]);
+		}
+		return !quit_;
+	}
+
+	void HeadlessPlatformInterface::waitEvents(std::chrono::microseconds timeout)
+	{
+		// scripted events don't arrive in real time, so there is nothing to wake up for
+		std::this_thread::sleep_for(timeout);
+	}
+
+	Expected<intptr_t> HeadlessPlatformInterface::getNativeWindowHandle() const
+	{
+		return std::unexpected("headless platform has no window");
+	}
+
+	std::optional<std::tuple<int, int>> HeadlessPlatformInterface::getWindowExtents() const
+	{
+		return std::make_tuple(width_, height_);
+	}
+
+	void HeadlessPlatformInterface::scheduleEvent(const Event& event)
+	{
+		auto byTime = [](const Event& a, const Event& b) { return a.time < b.time; };
+		auto it = std::upper_bound(events_.begin() + nextEvent_, events_.end(), event, byTime);
+		events_.insert(it, event);
+	}
+
+	void HeadlessPlatformInterface::setWindowExtents(int width, int height)
+	{
+		width_ = width;
+		height_ = height;
+	}
+
+	void HeadlessPlatformInterface::fire(const Event& event)
+	{
+		switch (event.type) {
+		case Event::Type::Quit:
+			quit_ = true;
+			break;
+		case Event::Type::Resize:
+			setWindowExtents(event.width, event.height);
+			break;
+		}
+	}
+}
+
+IMPLEMENT_CLASS_FACTORY(qf::HeadlessPlatformInterface);
+IMPLEMENT_CLASS_FACTORY_UUID(qf::HeadlessPlatformInterface, qf::HeadlessPlatformInterfaceClassId);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "platform_interface.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace qf
+{
+	/**
+	 * @brief A platform without a window or an OS event loop, for servers, CI and load tests.
+	 *
+	 * Time is virtual: every update() advances the clock by a fixed tick, or by the time delta
+	 * it is given when no tick rate is configured, so runs are deterministic and not tied to
+	 * the wall clock. Events are scripted ahead of time, either from the platform.headless.events
+	 * list in the configuration or through scheduleEvent(), and fire on the first update()
+	 * whose virtual time reaches them.
+	 */
+	class HeadlessPlatformInterface
+		: public PlatformInterface
+	{
+	public:
+		using Duration = std::chrono::nanoseconds;
+
+		struct Event {
+			enum class Type {
+				Quit,
+				Resize,
+			} type;
+
+			Duration time;
+			int width = 0;
+			int height = 0;
+		};
+
+		virtual std::expected<void, std::string> postConstruct() override;
+
+		virtual std::expected<void, std::string> initialize() override;
+
+		virtual bool update(float timeDelta) override;
+
+		virtual void waitEvents(std::chrono::microseconds timeout) override;
+
+		virtual Expected<intptr_t> getNativeWindowHandle() const override;
+
+		virtual std::optional<std::tuple<int, int>> getWindowExtents() const override;
+
+		/*
+		* queues an event to fire once the virtual clock reaches event.time
+		*/
+		void scheduleEvent(const Event& event);
+
+		void setWindowExtents(int width, int height);
+
+		/*
+		* advance the clock by this much on every update, 0 uses the update's time delta
+		*/
+		void setTickDuration(Duration tick) { tickDuration_ = tick; }
+
+		Duration getTime() const { return time_; }
+
+		u64 getTickCount() const { return tickCount_; }
+
+	private:
+		int width_ = 1920;
+		int height_ = 1080;
+
+		Duration time_{};
+		Duration tickDuration_{};
+		u64 tickCount_ = 0;
+		bool quit_ = false;
+
+		/*
+		* sorted by time, events before nextEvent_ have already fired
+		*/
+		std::vector<Event> events_{};
+		size_t nextEvent_ = 0;
+
+		void fire(const Event& event);
+	};
+}
@@ -0,0 +1,885 @@
+#include "io_system.hpp"
+#include "application_context.hpp"
+#include "class_ids.hpp"
+#include "flat_hash_map.hpp"
+#include "logger.hpp"
+#include "profiler.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define QF_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+	static constexpr std::string_view BACKEND_PROP_NAME{ "io.backend" };
+	static constexpr std::string_view QUEUE_DEPTH_PROP_NAME{ "io.queue-depth" };
+	static constexpr std::string_view THREAD_COUNT_PROP_NAME{ "io.thread-count" };
+}
+
+namespace qf::io
+{
+	namespace
+	{
+#if defined(_WIN32)
+		using NativeFile = HANDLE;
+		const NativeFile INVALID_FILE = INVALID_HANDLE_VALUE;
+#else
+		using NativeFile = int;
+		constexpr NativeFile INVALID_FILE = -1;
+#endif
+
+		struct Pending {
+			RequestId id;
+			NativeFile file;
+			u64 offset;
+			std::span<std::byte> buffer;
+			ReadCallback callback;
+		};
+
+		std::string getSystemErrorMessage(int error) {
+			return std::system_category().message(error);
+		}
+
+		/*
+		* reads until the buffer is full or the file ends
+		*/
+		Expected<size_t> readAt(NativeFile file, std::span<std::byte> buffer, u64 offset) {
+			size_t done = 0;
+			while (done != buffer.size()) {
+#if defined(_WIN32)
+				const u64 position = offset + done;
+				OVERLAPPED overlapped{};
+				overlapped.Offset = static_cast<DWORD>(position);
+				overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+				DWORD read = 0;
+				const DWORD size = static_cast<DWORD>(std::min<size_t>(buffer.size() - done, 1u << 30));
+				if (!ReadFile(file, buffer.data() + done, size, &read, &overlapped)) {
+					if (GetLastError() == ERROR_HANDLE_EOF) {
+						break;
+					}
+					return std::unexpected(std::format("read failed: {}", getSystemErrorMessage(static_cast<int>(GetLastError()))));
+				}
+#else
+				const ssize_t read = ::pread(file, buffer.data() + done, buffer.size() - done, static_cast<off_t>(offset + done));
+				if (read < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					return std::unexpected(std::format("read failed: {}", getSystemErrorMessage(errno)));
+				}
+#endif
+				if (read == 0) {
+					break;
+				}
+				done += static_cast<size_t>(read);
+			}
+			return done;
+		}
+
+		/**
+		 * @brief The priority queues and the bookkeeping of started reads, shared by the backends.
+		 */
+		class Requests : NonCopyable
+		{
+			std::mutex mutex_{};
+			std::condition_variable available_{};
+			std::array<std::deque<Pending>, PRIORITY_COUNT> queues_{};
+			size_t queued_ = 0;
+
+			/*
+			* reads handed to the backend, and whether they have been cancelled since
+			*/
+			FlatHashMap<RequestId, bool> started_{};
+
+			RequestId nextId_ = 1;
+			bool stopping_ = true;
+
+			bool takeLocked(Pending& out) {
+				for (auto& queue : queues_) {
+					if (!queue.empty()) {
+						out = std::move(queue.front());
+						queue.pop_front();
+						--queued_;
+						started_.emplace(out.id, false);
+						return true;
+					}
+				}
+				return false;
+			}
+
+		public:
+			void start() {
+				std::lock_guard lock(mutex_);
+				stopping_ = false;
+			}
+
+			/*
+			* fails every queued request and every one pushed from now on
+			*/
+			void stop() {
+				std::vector<Pending> failed;
+				{
+					std::lock_guard lock(mutex_);
+					stopping_ = true;
+					for (auto& queue : queues_) {
+						std::move(queue.begin(), queue.end(), std::back_inserter(failed));
+						queue.clear();
+					}
+					queued_ = 0;
+				}
+				available_.notify_all();
+				for (auto& pending : failed) {
+					pending.callback(std::unexpected("the io system was shut down"));
+				}
+			}
+
+			bool isStopping() {
+				std::lock_guard lock(mutex_);
+				return stopping_;
+			}
+
+			/*
+			* queues the requests under one lock and returns the id of the first, the rest
+			* follow it in order
+			*/
+			RequestId push(std::span<std::pair<Priority, Pending>> requests) {
+				RequestId first;
+				bool stopping;
+				{
+					std::lock_guard lock(mutex_);
+					first = nextId_;
+					nextId_ += requests.size();
+					stopping = stopping_;
+					for (size_t i = 0; i != requests.size(); ++i) {
+						auto& [priority, pending] = requests[i];
+						pending.id = first + i;
+						if (!stopping) {
+							queues_[static_cast<size_t>(priority)].emplace_back(std::move(pending));
+						}
+					}
+					if (!stopping) {
+						queued_ += requests.size();
+					}
+				}
+				if (stopping) {
+					for (auto& [priority, pending] : requests) {
+						pending.callback(std::unexpected("the io system isn't running"));
+					}
+					return first;
+				}
+				if (requests.size() == 1) {
+					available_.notify_one();
+				}
+				else {
+					available_.notify_all();
+				}
+				return first;
+			}
+
+			/*
+			* the highest priority queued request, if there is one
+			*/
+			bool tryTake(Pending& out) {
+				std::lock_guard lock(mutex_);
+				return takeLocked(out);
+			}
+
+			/*
+			* blocks until there is a request to take. false once stopping
+			*/
+			bool waitTake(Pending& out) {
+				std::unique_lock lock(mutex_);
+				available_.wait(lock, [this] { return queued_ != 0 || stopping_; });
+				return takeLocked(out);
+			}
+
+			/*
+			* calls the callback of a started request with its result, or with an error if it was
+			* cancelled while it was running
+			*/
+			void finish(Pending& pending, Expected<size_t>&& result) {
+				bool cancelled = false;
+				{
+					std::lock_guard lock(mutex_);
+					if (auto it = started_.find(pending.id); it != started_.end()) {
+						cancelled = it->second;
+						started_.erase(it);
+					}
+				}
+				auto callback = std::move(pending.callback);
+				if (cancelled) {
+					callback(std::unexpected("read was cancelled"));
+				}
+				else {
+					callback(std::move(result));
+				}
+			}
+
+			bool cancel(RequestId id) {
+				Pending cancelled{};
+				{
+					std::lock_guard lock(mutex_);
+					if (auto it = started_.find(id); it != started_.end()) {
+						it->second = true;
+						return true;
+					}
+					bool found = false;
+					for (auto& queue : queues_) {
+						auto it = std::find_if(queue.begin(), queue.end(), [&](const Pending& pending) { return pending.id == id; });
+						if (it != queue.end()) {
+							cancelled = std::move(*it);
+							queue.erase(it);
+							--queued_;
+							found = true;
+							break;
+						}
+					}
+					if (!found) {
+						return false;
+					}
+				}
+				cancelled.callback(std::unexpected("read was cancelled"));
+				return true;
+			}
+		};
+
+		class Backend : NonCopyable
+		{
+		public:
+			virtual ~Backend() = default;
+
+			virtual std::string_view getName() const = 0;
+
+			/*
+			* called after requests have been queued
+			*/
+			virtual void wake() = 0;
+
+			/*
+			* waits for the started reads to finish once the requests are stopping
+			*/
+			virtual void stop() = 0;
+		};
+
+		/**
+		 * @brief Blocking positional reads on a pool of threads.
+		 */
+		class ThreadPoolBackend : public Backend
+		{
+			Requests& requests_;
+			std::vector<std::thread> threads_{};
+
+			void run(u32 index) {
+				QF_PROFILE_THREAD_NAME(std::format("io {}", index));
+				Pending pending;
+				while (requests_.waitTake(pending)) {
+					Expected<size_t> result = [&] {
+						QF_PROFILE_ZONE("read");
+						return readAt(pending.file, pending.buffer, pending.offset);
+					}();
+					requests_.finish(pending, std::move(result));
+				}
+			}
+
+		public:
+			ThreadPoolBackend(Requests& requests, u32 threadCount)
+				: requests_(requests)
+			{
+				for (u32 i = 0; i != std::max(1u, threadCount); ++i) {
+					threads_.emplace_back(&ThreadPoolBackend::run, this, i);
+				}
+			}
+
+			virtual std::string_view getName() const override { return "threads"; }
+
+			// the threads wait on the requests' condition variable, which push() notifies
+			virtual void wake() override {}
+
+			virtual void stop() override {
+				for (auto& thread : threads_) {
+					thread.join();
+				}
+				threads_.clear();
+			}
+		};
+
+#if defined(QF_IO_URING)
+		/**
+		 * @brief Keeps up to queueDepth reads in the kernel through an io_uring, from one thread.
+		 *
+		 * The ring is driven with the raw system calls. The thread blocks in io_uring_enter()
+		 * until a read completes, and is woken for new requests by a read of an eventfd kept
+		 * in the ring, which wake() writes to.
+		 */
+		class IoUringBackend : public Backend
+		{
+			static constexpr u64 WAKE_TAG = ~0ull;
+			static constexpr u64 CANCEL_TAG = ~0ull - 1;
+
+			struct Slot {
+				Pending pending;
+				size_t done;
+			};
+
+			Requests& requests_;
+			int ringFd_ = -1;
+			int wakeFd_ = -1;
+			u64 wakeValue_ = 0;
+			std::atomic<bool> wakePending_{};
+
+			void* sqRing_ = MAP_FAILED;
+			size_t sqRingSize_ = 0;
+			void* cqRing_ = MAP_FAILED;
+			size_t cqRingSize_ = 0;
+			io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+			size_t sqesSize_ = 0;
+
+			unsigned* sqHead_{};
+			unsigned* sqTail_{};
+			unsigned sqMask_ = 0;
+			unsigned* sqArray_{};
+			unsigned* cqHead_{};
+			unsigned* cqTail_{};
+			unsigned cqMask_ = 0;
+			io_uring_cqe* cqes_{};
+
+			std::vector<Slot> slots_{};
+			std::vector<u32> freeSlots_{};
+			u32 unsubmitted_ = 0;
+			u32 inFlight_ = 0;
+			std::thread thread_{};
+
+			explicit IoUringBackend(Requests& requests)
+				: requests_(requests) {}
+
+			io_uring_sqe& nextSqe() {
+				const unsigned tail = *sqTail_;
+				const unsigned index = tail & sqMask_;
+				io_uring_sqe& sqe = sqes_[index];
+				std::memset(&sqe, 0, sizeof(sqe));
+				sqArray_[index] = index;
+				return sqe;
+			}
+
+			/*
+			* makes the sqe filled in by nextSqe() visible to the kernel
+			*/
+			void pushSqe() {
+				std::atomic_ref<unsigned>(*sqTail_).store(*sqTail_ + 1, std::memory_order_release);
+				++unsubmitted_;
+			}
+
+			void prepareRead(u32 index) {
+				const Slot& slot = slots_[index];
+				io_uring_sqe& sqe = nextSqe();
+				sqe.opcode = IORING_OP_READ;
+				sqe.fd = slot.pending.file;
+				sqe.addr = reinterpret_cast<u64>(slot.pending.buffer.data() + slot.done);
+				// a read longer than this finishes as a series of short ones
+				sqe.len = static_cast<u32>(std::min<size_t>(slot.pending.buffer.size() - slot.done, 1u << 30));
+				sqe.off = slot.pending.offset + slot.done;
+				sqe.user_data = index;
+				pushSqe();
+			}
+
+			void armWake() {
+				io_uring_sqe& sqe = nextSqe();
+				sqe.opcode = IORING_OP_READ;
+				sqe.fd = wakeFd_;
+				sqe.addr = reinterpret_cast<u64>(&wakeValue_);
+				sqe.len = sizeof(wakeValue_);
+				sqe.user_data = WAKE_TAG;
+				pushSqe();
+			}
+
+			/*
+			* IORING_OP_READ arrived in linux 5.6, as did IORING_REGISTER_PROBE, so a kernel that
+			* can't answer the probe can't read either
+			*/
+			static bool supportsRead(int ringFd) {
+				constexpr unsigned OP_COUNT = 256;
+				std::vector<std::byte> buffer(sizeof(io_uring_probe) + OP_COUNT * sizeof(io_uring_probe_op));
+				auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+				if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, OP_COUNT) < 0) {
+					return false;
+				}
+				return IORING_OP_READ < probe->ops_len && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0;
+			}
+
+			void complete(u32 index, Expected<size_t>&& result) {
+				requests_.finish(slots_[index].pending, std::move(result));
+				freeSlots_.push_back(index);
+				--inFlight_;
+			}
+
+			/*
+			* hands out finished reads and queues the rest of short ones. returns false when the
+			* wake up read failed for good, since the thread could then sleep through new requests
+			*/
+			bool reap() {
+				bool wakeable = true;
+				unsigned head = *cqHead_;
+				const unsigned tail = std::atomic_ref<unsigned>(*cqTail_).load(std::memory_order_acquire);
+				for (; head != tail; ++head) {
+					const u64 tag = cqes_[head & cqMask_].user_data;
+					const s32 res = cqes_[head & cqMask_].res;
+					if (tag == WAKE_TAG) {
+						if (res < 0 && res != -EINTR && res != -EAGAIN) {
+							log::error("io_uring wake up read failed: {}", getSystemErrorMessage(-res));
+							wakeable = false;
+							continue;
+						}
+						wakePending_.store(false);
+						armWake();
+						continue;
+					}
+					const u32 index = static_cast<u32>(tag);
+					Slot& slot = slots_[index];
+					if (res < 0) {
+						complete(index, std::unexpected(std::format("read failed: {}", getSystemErrorMessage(-res))));
+						continue;
+					}
+					slot.done += static_cast<size_t>(res);
+					if (res != 0 && slot.done != slot.pending.buffer.size()) {
+						prepareRead(index);
+						continue;
+					}
+					complete(index, slot.done);
+				}
+				std::atomic_ref<unsigned>(*cqHead_).store(head, std::memory_order_release);
+				return wakeable;
+			}
+
+			void run() {
+				QF_PROFILE_THREAD_NAME("io");
+				armWake();
+				while (true) {
+					while (!freeSlots_.empty()) {
+						const u32 index = freeSlots_.back();
+						if (!requests_.tryTake(slots_[index].pending)) {
+							break;
+						}
+						freeSlots_.pop_back();
+						slots_[index].done = 0;
+						++inFlight_;
+						prepareRead(index);
+					}
+					if (inFlight_ == 0 && requests_.isStopping()) {
+						break;
+					}
+
+					const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, unsubmitted_, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+					if (submitted < 0) {
+						if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+							if (!reap()) {
+								failAll();
+								return;
+							}
+							continue;
+						}
+						log::error("io_uring_enter failed: {}", getSystemErrorMessage(errno));
+						failAll();
+						return;
+					}
+					unsubmitted_ -= static_cast<u32>(submitted);
+					if (!reap()) {
+						failAll();
+						return;
+					}
+				}
+			}
+
+			bool isInFlight(u32 index) const {
+				return std::find(freeSlots_.begin(), freeSlots_.end(), index) == freeSlots_.end();
+			}
+
+			/*
+			* takes back the entries the kernel hasn't read from the submission queue yet and
+			* fails their reads, which the kernel never saw
+			*/
+			void retractUnsubmitted() {
+				const unsigned head = std::atomic_ref<unsigned>(*sqHead_).load(std::memory_order_acquire);
+				for (unsigned position = head; position != *sqTail_; ++position) {
+					const u64 tag = sqes_[sqArray_[position & sqMask_]].user_data;
+					if (tag != WAKE_TAG && tag != CANCEL_TAG) {
+						complete(static_cast<u32>(tag), std::unexpected("io_uring failed"));
+					}
+				}
+				std::atomic_ref<unsigned>(*sqTail_).store(head, std::memory_order_release);
+				unsubmitted_ = 0;
+			}
+
+			/*
+			* fails what is in flight, and everything queued from now on, after the ring broke.
+			* a read the kernel has is cancelled and only failed once its completion arrives,
+			* so no buffer is handed back while the kernel may still write to it
+			*/
+			void failAll() {
+				retractUnsubmitted();
+				for (u32 i = 0; i != slots_.size(); ++i) {
+					if (isInFlight(i)) {
+						io_uring_sqe& sqe = nextSqe();
+						sqe.opcode = IORING_OP_ASYNC_CANCEL;
+						sqe.addr = i;
+						sqe.user_data = CANCEL_TAG;
+						pushSqe();
+					}
+				}
+
+				while (inFlight_ != 0) {
+					const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, ringFd_, unsubmitted_, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+					if (submitted >= 0) {
+						unsubmitted_ -= static_cast<u32>(submitted);
+					}
+					else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+						// the reads finish without being cancelled, their completions are polled for
+						retractUnsubmitted();
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+
+					unsigned head = *cqHead_;
+					const unsigned tail = std::atomic_ref<unsigned>(*cqTail_).load(std::memory_order_acquire);
+					for (; head != tail; ++head) {
+						const u64 tag = cqes_[head & cqMask_].user_data;
+						if (tag != WAKE_TAG && tag != CANCEL_TAG) {
+							complete(static_cast<u32>(tag), std::unexpected("io_uring failed"));
+						}
+					}
+					std::atomic_ref<unsigned>(*cqHead_).store(head, std::memory_order_release);
+				}
+
+				Pending pending;
+				while (requests_.waitTake(pending)) {
+					requests_.finish(pending, std::unexpected("io_uring failed"));
+				}
+			}
+
+		public:
+			static Expected<Box<IoUringBackend>> create(Requests& requests, u32 queueDepth) {
+				Box<IoUringBackend> backend(new IoUringBackend(requests));
+				const u32 depth = std::max(1u, queueDepth);
+
+				// one more entry for the wake up read
+				io_uring_params params{};
+				backend->ringFd_ = static_cast<int>(syscall(__NR_io_uring_setup, depth + 1, &params));
+				if (backend->ringFd_ < 0) {
+					return std::unexpected(std::format("io_uring_setup failed: {}", getSystemErrorMessage(errno)));
+				}
+				if (!supportsRead(backend->ringFd_)) {
+					return std::unexpected("io_uring can't read files on this kernel");
+				}
+				backend->wakeFd_ = eventfd(0, EFD_CLOEXEC);
+				if (backend->wakeFd_ < 0) {
+					return std::unexpected(std::format("eventfd failed: {}", getSystemErrorMessage(errno)));
+				}
+
+				backend->sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				backend->cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if (singleMap) {
+					backend->sqRingSize_ = backend->cqRingSize_ = std::max(backend->sqRingSize_, backend->cqRingSize_);
+				}
+				backend->sqRing_ = mmap(nullptr, backend->sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend->ringFd_, IORING_OFF_SQ_RING);
+				if (backend->sqRing_ == MAP_FAILED) {
+					return std::unexpected("can't map the io_uring submission queue");
+				}
+				if (!singleMap) {
+					backend->cqRing_ = mmap(nullptr, backend->cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend->ringFd_, IORING_OFF_CQ_RING);
+					if (backend->cqRing_ == MAP_FAILED) {
+						return std::unexpected("can't map the io_uring completion queue");
+					}
+				}
+				backend->sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+				backend->sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, backend->sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend->ringFd_, IORING_OFF_SQES));
+				if (backend->sqes_ == MAP_FAILED) {
+					return std::unexpected("can't map the io_uring submission entries");
+				}
+
+				auto* sq = static_cast<std::byte*>(backend->sqRing_);
+				auto* cq = static_cast<std::byte*>(singleMap ? backend->sqRing_ : backend->cqRing_);
+				backend->sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+				backend->sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+				backend->sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+				backend->sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+				backend->cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+				backend->cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+				backend->cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+				backend->cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+				backend->slots_.resize(depth);
+				for (u32 i = depth; i != 0; --i) {
+					backend->freeSlots_.push_back(i - 1);
+				}
+				backend->thread_ = std::thread(&IoUringBackend::run, backend.get());
+				return backend;
+			}
+
+			virtual ~IoUringBackend() override {
+				if (sqes_ != MAP_FAILED) {
+					munmap(sqes_, sqesSize_);
+				}
+				if (cqRing_ != MAP_FAILED) {
+					munmap(cqRing_, cqRingSize_);
+				}
+				if (sqRing_ != MAP_FAILED) {
+					munmap(sqRing_, sqRingSize_);
+				}
+				if (wakeFd_ >= 0) {
+					close(wakeFd_);
+				}
+				if (ringFd_ >= 0) {
+					close(ringFd_);
+				}
+			}
+
+			virtual std::string_view getName() const override { return "io-uring"; }
+
+			virtual void wake() override {
+				// one write is enough until the thread has seen it
+				if (!wakePending_.exchange(true)) {
+					const u64 one = 1;
+					[[maybe_unused]] auto written = ::write(wakeFd_, &one, sizeof(one));
+				}
+			}
+
+			virtual void stop() override {
+				wakePending_.store(false);
+				wake();
+				if (thread_.joinable()) {
+					thread_.join();
+				}
+			}
+		};
+#endif
+	}
+
+	auto Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		if (auto value = config->getString(BACKEND_PROP_NAME)) {
+			settings.backend = std::string(*value);
+		}
+		if (auto value = config->getInt(QUEUE_DEPTH_PROP_NAME)) {
+			settings.queueDepth = static_cast<u32>(*value);
+		}
+		if (auto value = config->getInt(THREAD_COUNT_PROP_NAME)) {
+			settings.threadCount = static_cast<u32>(*value);
+		}
+		return settings;
+	}
+
+	class AsyncIoSystem
+		: public IoSystem
+	{
+		Requests requests_{};
+		Box<Backend> backend_{};
+
+		mutable std::mutex filesMutex_{};
+		// a FileId is an index into files_ plus one, so 0 is never a valid file
+		std::vector<NativeFile> files_{};
+		std::vector<FileId> freeFiles_{};
+
+		NativeFile getNativeFile(FileId file) const {
+			std::lock_guard lock(filesMutex_);
+			return file != 0 && file <= files_.size() ? files_[file - 1] : INVALID_FILE;
+		}
+
+		static void closeNativeFile(NativeFile file) {
+#if defined(_WIN32)
+			CloseHandle(file);
+#else
+			close(file);
+#endif
+		}
+
+	public:
+		virtual ~AsyncIoSystem() override {
+			shutdown();
+			for (NativeFile file : files_) {
+				if (file != INVALID_FILE) {
+					closeNativeFile(file);
+				}
+			}
+		}
+
+		virtual Expected<void> initialize() override {
+			return initialize(Settings::fromConfig());
+		}
+
+		virtual Expected<void> initialize(const Settings& settings) override {
+			QF_PROFILE_ZONE("IoSystem::initialize");
+			if (backend_) {
+				return std::unexpected("io system is already initialized");
+			}
+			if (settings.backend != "auto" && settings.backend != "io-uring" && settings.backend != "threads") {
+				return std::unexpected(std::format("unknown io backend {}", settings.backend));
+			}
+
+			requests_.start();
+#if defined(QF_IO_URING)
+			if (settings.backend != "threads") {
+				auto backend = IoUringBackend::create(requests_, settings.queueDepth);
+				if (backend.has_value()) {
+					backend_ = std::move(backend.value());
+				}
+				else if (settings.backend == "io-uring") {
+					requests_.stop();
+					return std::unexpected(backend.error());
+				}
+				else {
+					log::info("{}, reading files on a thread pool instead", backend.error().str());
+				}
+			}
+#else
+			if (settings.backend == "io-uring") {
+				requests_.stop();
+				return std::unexpected("io_uring isn't available on this platform");
+			}
+#endif
+			if (!backend_) {
+				backend_ = makeBox<ThreadPoolBackend>(requests_, settings.threadCount);
+			}
+			log::info("io system started with the {} backend", backend_->getName());
+			return {};
+		}
+
+		virtual void shutdown() override {
+			if (!backend_) {
+				return;
+			}
+			requests_.stop();
+			backend_->stop();
+			backend_.reset();
+		}
+
+		virtual std::string_view getBackendName() const override {
+			return backend_ ? backend_->getName() : std::string_view();
+		}
+
+		virtual Expected<FileId> openFile(const std::filesystem::path& path) override {
+#if defined(_WIN32)
+			NativeFile file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+#else
+			NativeFile file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+			if (file == INVALID_FILE) {
+				return std::unexpected(std::format("can't open {}", path.string()));
+			}
+
+			std::lock_guard lock(filesMutex_);
+			if (!freeFiles_.empty()) {
+				const FileId id = freeFiles_.back();
+				freeFiles_.pop_back();
+				files_[id - 1] = file;
+				return id;
+			}
+			files_.push_back(file);
+			return static_cast<FileId>(files_.size());
+		}
+
+		virtual void closeFile(FileId file) override {
+			std::lock_guard lock(filesMutex_);
+			if (file == 0 || file > files_.size() || files_[file - 1] == INVALID_FILE) {
+				return;
+			}
+			closeNativeFile(files_[file - 1]);
+			files_[file - 1] = INVALID_FILE;
+			freeFiles_.push_back(file);
+		}
+
+		virtual Expected<u64> getFileSize(FileId file) const override {
+			const NativeFile native = getNativeFile(file);
+#if defined(_WIN32)
+			LARGE_INTEGER size{};
+			if (native == INVALID_FILE || !GetFileSizeEx(native, &size)) {
+				return std::unexpected("can't get the size of the file");
+			}
+			return static_cast<u64>(size.QuadPart);
+#else
+			struct stat st {};
+			if (native == INVALID_FILE || fstat(native, &st) != 0) {
+				return std::unexpected("can't get the size of the file");
+			}
+			return static_cast<u64>(st.st_size);
+#endif
+		}
+
+		virtual RequestId submit(ReadRequest&& request) override {
+			std::pair<Priority, Pending> pending{ request.priority, Pending{
+				.id = 0,
+				.file = getNativeFile(request.file),
+				.offset = request.offset,
+				.buffer = request.buffer,
+				.callback = std::move(request.callback),
+			} };
+			const RequestId id = requests_.push(std::span(&pending, 1));
+			if (backend_) {
+				backend_->wake();
+			}
+			return id;
+		}
+
+		virtual void submit(std::span<ReadRequest> requests, std::span<RequestId> ids) override {
+			std::vector<std::pair<Priority, Pending>> pending;
+			pending.reserve(requests.size());
+			{
+				// one lock for the whole batch rather than one per file lookup
+				std::lock_guard lock(filesMutex_);
+				for (auto& request : requests) {
+					const FileId file = request.file;
+					pending.emplace_back(request.priority, Pending{
+						.id = 0,
+						.file = file != 0 && file <= files_.size() ? files_[file - 1] : INVALID_FILE,
+						.offset = request.offset,
+						.buffer = request.buffer,
+						.callback = std::move(request.callback),
+					});
+				}
+			}
+			const RequestId first = requests_.push(pending);
+			for (size_t i = 0; i != std::min(ids.size(), requests.size()); ++i) {
+				ids[i] = first + i;
+			}
+			if (backend_) {
+				backend_->wake();
+			}
+		}
+
+		virtual bool cancel(RequestId id) override {
+			return requests_.cancel(id);
+		}
+	};
+}
+
+IMPLEMENT_CLASS_FACTORY(qf::io::AsyncIoSystem);
+IMPLEMENT_CLASS_FACTORY_UUID(qf::io::AsyncIoSystem, qf::AsyncIoSystemClassId);
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "service_slot.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace qf::io
+{
+	/*
+	* queued requests are started highest priority first, in submission order within a priority
+	*/
+	enum class Priority : u8 {
+		High,
+		Normal,
+		Low,
+	};
+
+	inline constexpr size_t PRIORITY_COUNT = 3;
+
+	using FileId = u32;
+	using RequestId = u64;
+
+	/*
+	* the number of bytes read, fewer than asked for only at the end of the file
+	*/
+	using ReadCallback = std::function<void(Expected<size_t>)>;
+
+	/*
+	* reads buffer.size() bytes at offset. the buffer must stay valid until the callback has
+	* been called
+	*/
+	struct ReadRequest {
+		FileId file;
+		u64 offset;
+		std::span<std::byte> buffer;
+		Priority priority = Priority::Normal;
+		ReadCallback callback;
+	};
+
+	struct Settings {
+		// "auto" uses io_uring where the kernel has it and the thread pool otherwise,
+		// "io-uring" fails to initialize without it, "threads" always uses the thread pool
+		std::string backend{ "auto" };
+		// most reads handed to the kernel, or the thread pool, at once. the rest wait in the
+		// priority queues so a high priority read never waits behind a full device queue
+		u32 queueDepth = 128;
+		// threads doing blocking reads for the thread pool backend
+		u32 threadCount = 4;
+
+		static Settings fromConfig();
+	};
+
+	/**
+	 * @brief Reads files without blocking the calling thread.
+	 *
+	 * Requests wait in one queue per priority until the backend has room for them. The io_uring
+	 * backend keeps up to queueDepth reads in the kernel from a single thread, the thread pool
+	 * backend does blocking positional reads on a few threads. Callbacks are called on the
+	 * backend's threads, so they should be short and hand anything more to the job system.
+	 *
+	 * The io system is registered with the application context under SERVICE_NAME and
+	 * SERVICE_SLOT.
+	 */
+	class IoSystem : public Serializable
+	{
+	public:
+		static constexpr std::string_view SERVICE_NAME{ "io" };
+		static constexpr ServiceSlot SERVICE_SLOT = ServiceSlot::Io;
+
+		/*
+		* starts the backend using the settings from the configuration
+		*/
+		virtual Expected<void> initialize() = 0;
+
+		virtual Expected<void> initialize(const Settings& settings) = 0;
+
+		/*
+		* fails every queued request, waits for the ones already started and stops the backend
+		*/
+		virtual void shutdown() = 0;
+
+		virtual std::string_view getBackendName() const = 0;
+
+		virtual Expected<FileId> openFile(const std::filesystem::path& path) = 0;
+
+		/*
+		* the file must have no requests left
+		*/
+		virtual void closeFile(FileId file) = 0;
+
+		virtual Expected<u64> getFileSize(FileId file) const = 0;
+
+		virtual RequestId submit(ReadRequest&& request) = 0;
+
+		/*
+		* submits every request under one lock and with one wake up of the backend. ids, when
+		* not empty, receives the id of each request
+		*/
+		virtual void submit(std::span<ReadRequest> requests, std::span<RequestId> ids = {}) = 0;
+
+		/*
+		* a queued request is removed and its callback is called with an error right away. one
+		* already started gets the error once it finishes, and its data must be ignored.
+		* returns false when the request has already completed
+		*/
+		virtual bool cancel(RequestId id) = 0;
+
+		/*
+		* submits a read and returns its result as a future
+		*/
+		std::future<Expected<size_t>> read(FileId file, u64 offset, std::span<std::byte> buffer, Priority priority = Priority::Normal) {
+			auto promise = std::make_shared<std::promise<Expected<size_t>>>();
+			auto future = promise->get_future();
+			submit(ReadRequest{
+				.file = file,
+				.offset = offset,
+				.buffer = buffer,
+				.priority = priority,
+				.callback = [promise](Expected<size_t> result) { promise->set_value(std::move(result)); },
+			});
+			return future;
+		}
+	};
+}
@@ -0,0 +1,415 @@
+#include "job_system.hpp"
+#include "application_context.hpp"
+#include "class_ids.hpp"
+#include "logger.hpp"
+#include "profiler.hpp"
+
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	static constexpr std::string_view WORKER_COUNT_PROP_NAME{ "jobs.worker-count" };
+	static constexpr int SPIN_ATTEMPTS = 64;
+}
+
+namespace qf::jobs
+{
+	namespace
+	{
+		struct Job {
+			JobFn fn;
+			Counter* counter;
+		};
+
+		/*
+		* recycles jobs so submitting one doesn't go to the heap once the pool is warm.
+		* each thread keeps a small cache and trades batches with a shared free list, since
+		* jobs are usually freed on a different thread than the one that allocated them
+		*/
+		class JobPool : NonCopyable
+		{
+			static constexpr size_t BATCH_SIZE = 64;
+
+			std::mutex mutex_{};
+			std::vector<Job*> free_{};
+
+			struct ThreadCache {
+				std::vector<Job*> jobs;
+
+				ThreadCache() { jobs.reserve(BATCH_SIZE * 2); }
+				~ThreadCache() { instance().giveBack(jobs, jobs.size()); }
+			};
+
+			static ThreadCache& cache() {
+				static thread_local ThreadCache cache;
+				return cache;
+			}
+
+			void giveBack(std::vector<Job*>& jobs, size_t count) {
+				std::lock_guard lock(mutex_);
+				free_.insert(free_.end(), jobs.end() - count, jobs.end());
+				jobs.resize(jobs.size() - count);
+			}
+
+		public:
+			~JobPool() {
+				for (Job* job : free_) {
+					delete job;
+				}
+			}
+
+			static JobPool& instance() {
+				static JobPool pool;
+				return pool;
+			}
+
+			Job* acquire(JobFn&& fn, Counter* counter) {
+				auto& jobs = cache().jobs;
+				if (jobs.empty()) {
+					std::lock_guard lock(mutex_);
+					const size_t count = std::min(BATCH_SIZE, free_.size());
+					jobs.insert(jobs.end(), free_.end() - count, free_.end());
+					free_.resize(free_.size() - count);
+				}
+				if (jobs.empty()) {
+					return new Job{ std::move(fn), counter };
+				}
+				Job* job = jobs.back();
+				jobs.pop_back();
+				job->fn = std::move(fn);
+				job->counter = counter;
+				return job;
+			}
+
+			void release(Job* job) {
+				job->fn = nullptr;
+				auto& jobs = cache().jobs;
+				jobs.push_back(job);
+				if (jobs.size() >= BATCH_SIZE * 2) {
+					giveBack(jobs, BATCH_SIZE);
+				}
+			}
+		};
+
+		/*
+		* Chase-Lev work stealing deque.
+		* push() and pop() may only be called by the owning thread, steal() by any thread.
+		*/
+		class WorkStealingDeque : NonCopyable
+		{
+			static constexpr s64 CAPACITY = 4096;
+			static constexpr s64 MASK = CAPACITY - 1;
+
+			alignas(64) std::atomic<s64> top_{};
+			alignas(64) std::atomic<s64> bottom_{};
+			std::array<std::atomic<Job*>, CAPACITY> buffer_{};
+
+		public:
+			bool push(Job* job) {
+				const s64 b = bottom_.load(std::memory_order_relaxed);
+				const s64 t = top_.load(std::memory_order_acquire);
+				if (b - t >= CAPACITY) {
+					return false;
+				}
+				buffer_[b & MASK].store(job, std::memory_order_relaxed);
+				bottom_.store(b + 1, std::memory_order_release);
+				return true;
+			}
+
+			Job* pop() {
+				const s64 b = bottom_.load(std::memory_order_relaxed) - 1;
+				bottom_.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				s64 t = top_.load(std::memory_order_relaxed);
+
+				if (t > b) {
+					bottom_.store(b + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+
+				Job* job = buffer_[b & MASK].load(std::memory_order_relaxed);
+				if (t == b) {
+					// last item, race any thieves for it
+					if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+						job = nullptr;
+					}
+					bottom_.store(b + 1, std::memory_order_relaxed);
+				}
+				return job;
+			}
+
+			Job* steal() {
+				s64 t = top_.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				const s64 b = bottom_.load(std::memory_order_acquire);
+				if (t >= b) {
+					return nullptr;
+				}
+				Job* job = buffer_[t & MASK].load(std::memory_order_relaxed);
+				if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					return nullptr;
+				}
+				return job;
+			}
+		};
+	}
+
+	class WorkStealingJobSystem
+		: public JobSystem
+	{
+		static constexpr u32 NO_WORKER = ~0u;
+
+		static inline thread_local WorkStealingJobSystem* currentSystem_{};
+		static inline thread_local u32 currentWorker_{ NO_WORKER };
+		static inline thread_local u32 stealSeed_{ 0x9e3779b9u };
+
+		/*
+		* deque 0 belongs to the thread that called initialize(), the rest to the workers
+		*/
+		std::vector<Box<WorkStealingDeque>> deques_{};
+		std::vector<std::thread> threads_{};
+
+		/*
+		* jobs submitted from threads that don't own a deque
+		*/
+		std::mutex injectMutex_{};
+		std::deque<Job*> injected_{};
+		std::atomic<u32> injectedCount_{};
+
+		std::mutex sleepMutex_{};
+		std::condition_variable sleepCondition_{};
+		std::atomic<u64> workEpoch_{};
+		std::atomic<u32> sleepers_{};
+		std::atomic<bool> stopping_{};
+
+		u32 ownerIndex() const {
+			return currentSystem_ == this ? currentWorker_ : NO_WORKER;
+		}
+
+		/*
+		* a job that throws is logged and counted as finished, so whoever waits on its counter
+		* isn't left waiting forever. the exception doesn't travel any further
+		*/
+		void execute(Job* job) {
+			try {
+				job->fn();
+			}
+			catch (const std::exception& e) {
+				log::error("job threw an exception: {}", e.what());
+			}
+			catch (...) {
+				log::error("job threw an exception");
+			}
+			if (job->counter) {
+				job->counter->done();
+			}
+			JobPool::instance().release(job);
+		}
+
+		Job* popInjected() {
+			if (injectedCount_.load(std::memory_order_acquire) == 0) {
+				return nullptr;
+			}
+			std::lock_guard lock(injectMutex_);
+			if (injected_.empty()) {
+				return nullptr;
+			}
+			Job* job = injected_.front();
+			injected_.pop_front();
+			injectedCount_.fetch_sub(1, std::memory_order_release);
+			return job;
+		}
+
+		Job* findJob(u32 index) {
+			if (index != NO_WORKER) {
+				if (Job* job = deques_[index]->pop()) {
+					return job;
+				}
+			}
+			if (Job* job = popInjected()) {
+				return job;
+			}
+
+			// xorshift to pick where to start stealing, so thieves spread over the victims
+			stealSeed_ ^= stealSeed_ << 13;
+			stealSeed_ ^= stealSeed_ >> 17;
+			stealSeed_ ^= stealSeed_ << 5;
+
+			const u32 count = static_cast<u32>(deques_.size());
+			const u32 start = stealSeed_ % count;
+			for (u32 i = 0; i != count; ++i) {
+				const u32 victim = (start + i) % count;
+				if (victim == index) {
+					continue;
+				}
+				if (Job* job = deques_[victim]->steal()) {
+					return job;
+				}
+			}
+			return nullptr;
+		}
+
+		void wakeWorker() {
+			workEpoch_.fetch_add(1, std::memory_order_seq_cst);
+			if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+				std::lock_guard lock(sleepMutex_);
+				sleepCondition_.notify_one();
+			}
+		}
+
+		void workerMain(u32 index) {
+			currentSystem_ = this;
+			currentWorker_ = index;
+			QF_PROFILE_THREAD_NAME(std::format("worker {}", index));
+			stealSeed_ += index * 0x85ebca6bu;
+
+			while (!stopping_.load(std::memory_order_acquire)) {
+				const u64 epoch = workEpoch_.load(std::memory_order_seq_cst);
+
+				Job* job{};
+				for (int i = 0; i != SPIN_ATTEMPTS && !job; ++i) {
+					job = findJob(index);
+				}
+				if (job) {
+					execute(job);
+					continue;
+				}
+
+				std::unique_lock lock(sleepMutex_);
+				sleepers_.fetch_add(1, std::memory_order_seq_cst);
+				sleepCondition_.wait(lock, [&] {
+					return workEpoch_.load(std::memory_order_seq_cst) != epoch
+						|| stopping_.load(std::memory_order_acquire);
+				});
+				sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+			}
+
+			currentSystem_ = nullptr;
+			currentWorker_ = NO_WORKER;
+		}
+
+	public:
+		virtual ~WorkStealingJobSystem() override {
+			shutdown();
+		}
+
+		virtual Expected<void> initialize() override {
+			u32 workerCount = 0;
+			if (auto ctx = IApplicationContext::getContext()) {
+				if (auto value = ctx->getConfig()->getInt(WORKER_COUNT_PROP_NAME)) {
+					workerCount = static_cast<u32>(*value);
+				}
+			}
+			return initialize(workerCount);
+		}
+
+		virtual Expected<void> initialize(u32 workerCount) override {
+			QF_PROFILE_ZONE("JobSystem::initialize");
+			if (!deques_.empty()) {
+				return std::unexpected("job system is already initialized");
+			}
+			if (workerCount == 0) {
+				workerCount = std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			stopping_ = false;
+			for (u32 i = 0; i != workerCount; ++i) {
+				deques_.emplace_back(makeBox<WorkStealingDeque>());
+			}
+
+			currentSystem_ = this;
+			currentWorker_ = 0;
+
+			for (u32 i = 1; i != workerCount; ++i) {
+				threads_.emplace_back(&WorkStealingJobSystem::workerMain, this, i);
+			}
+
+			log::info("job system started with {} workers", workerCount);
+			return {};
+		}
+
+		virtual void shutdown() override {
+			if (deques_.empty()) {
+				return;
+			}
+			{
+				std::lock_guard lock(sleepMutex_);
+				stopping_ = true;
+			}
+			sleepCondition_.notify_all();
+			for (auto& thread : threads_) {
+				thread.join();
+			}
+			threads_.clear();
+
+			while (Job* job = findJob(NO_WORKER)) {
+				execute(job);
+			}
+			deques_.clear();
+
+			if (currentSystem_ == this) {
+				currentSystem_ = nullptr;
+				currentWorker_ = NO_WORKER;
+			}
+		}
+
+		virtual void run(JobFn&& fn, Counter* counter) override {
+			if (counter) {
+				counter->add(1);
+			}
+
+			Job* job = JobPool::instance().acquire(std::move(fn), counter);
+			if (deques_.empty() || stopping_.load(std::memory_order_acquire)) {
+				execute(job);
+				return;
+			}
+
+			const u32 index = ownerIndex();
+			if (index != NO_WORKER) {
+				if (!deques_[index]->push(job)) {
+					// our deque is full, running it now is cheaper than queueing it elsewhere
+					execute(job);
+					return;
+				}
+			}
+			else {
+				std::lock_guard lock(injectMutex_);
+				injected_.push_back(job);
+				injectedCount_.fetch_add(1, std::memory_order_release);
+			}
+			wakeWorker();
+		}
+
+		virtual void wait(Counter& counter) override {
+			while (!counter.isDone()) {
+				if (!runOne()) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		virtual bool runOne() override {
+			if (deques_.empty()) {
+				return false;
+			}
+			if (Job* job = findJob(ownerIndex())) {
+				execute(job);
+				return true;
+			}
+			return false;
+		}
+
+		virtual u32 getWorkerCount() const override {
+			return std::max<u32>(1, static_cast<u32>(deques_.size()));
+		}
+	};
+}
+
+IMPLEMENT_CLASS_FACTORY(qf::jobs::WorkStealingJobSystem);
+IMPLEMENT_CLASS_FACTORY_UUID(qf::jobs::WorkStealingJobSystem, qf::WorkStealingJobSystemClassId);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "service_slot.hpp"
+
+#include <atomic>
+#include <functional>
+#include <string_view>
+#include <algorithm>
+
+namespace qf::jobs
+{
+	/**
+	 * @brief Tracks a group of submitted jobs.
+	 *
+	 * Every job submitted against a counter increments it, and decrements it once the job
+	 * has finished running. A counter is done when it drops back to zero. Waiting on a
+	 * counter through JobSystem::wait() runs other jobs instead of blocking the thread.
+	 */
+	class Counter : NonCopyable
+	{
+		std::atomic<u32> pending_{};
+
+	public:
+		void add(u32 count) { pending_.fetch_add(count, std::memory_order_relaxed); }
+
+		void done() { pending_.fetch_sub(1, std::memory_order_acq_rel); }
+
+		bool isDone() const { return pending_.load(std::memory_order_acquire) == 0; }
+	};
+
+	using JobFn = std::function<void()>;
+
+	/**
+	 * @brief Runs jobs on a pool of worker threads.
+	 *
+	 * The thread that calls initialize() takes part in running jobs whenever it waits on a
+	 * counter, so a job system with a worker count of one runs everything on that thread.
+	 * The job system is registered with the application context under SERVICE_NAME and
+	 * SERVICE_SLOT.
+	 */
+	class JobSystem : public Serializable
+	{
+	public:
+		static constexpr std::string_view SERVICE_NAME{ "jobs" };
+		static constexpr ServiceSlot SERVICE_SLOT = ServiceSlot::Jobs;
+
+		/*
+		* starts the workers using the worker count from the configuration
+		*/
+		virtual Expected<void> initialize() = 0;
+
+		/*
+		* starts the workers. workerCount is the total number of threads running jobs,
+		* including the calling thread. 0 uses every hardware thread.
+		*/
+		virtual Expected<void> initialize(u32 workerCount) = 0;
+
+		/*
+		* stops and joins the workers, running any jobs still queued on the calling thread
+		*/
+		virtual void shutdown() = 0;
+
+		/*
+		* queues a job. when counter is given it is incremented now and decremented once
+		* the job has finished. a job that throws is logged and still counts as finished.
+		*/
+		virtual void run(JobFn&& fn, Counter* counter = nullptr) = 0;
+
+		/*
+		* runs queued jobs on the calling thread until the counter is done
+		*/
+		virtual void wait(Counter& counter) = 0;
+
+		/*
+		* runs one queued job on the calling thread. returns false when there was nothing to run
+		*/
+		virtual bool runOne() = 0;
+
+		virtual u32 getWorkerCount() const = 0;
+
+		/*
+		* splits [begin, end) into ranges of at most grainSize elements, calls fn(first, last)
+		* for each range in parallel and returns once all of them have finished.
+		* a grainSize of 0 picks a size giving each worker a few ranges to balance with.
+		*/
+		template<typename F>
+		void parallelFor(u32 begin, u32 end, u32 grainSize, F&& fn) {
+			if (begin >= end) {
+				return;
+			}
+			if (grainSize == 0) {
+				grainSize = std::max<u32>(1, (end - begin) / (getWorkerCount() * 4));
+			}
+			Counter counter;
+			for (u32 first = begin; first < end;) {
+				const u32 last = first + std::min(grainSize, end - first);
+				run([&fn, first, last] { fn(first, last); }, &counter);
+				first = last;
+			}
+			wait(counter);
+		}
+	};
+}
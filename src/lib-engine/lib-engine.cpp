@@ -1,23 +1,18 @@
 #include "class_factory.hpp"
+#include "class_registry.hpp"
+#include "flat_hash_map.hpp"
 
 #include <vulkan/vulkan.h>
 
-
-#include <unordered_map>
-
 using namespace qf;
 
 namespace qf
 {
-	class Sdl2PlatformInterface;
-	
-	std::unordered_map<UUID, ptr<AbstractClassFactory>> factoryMap;
+	UUIDMap<ptr<AbstractClassFactory>> factoryMap;
 }
 
 void qf::registerFactories()
 {
-	registerFactory<Sdl2PlatformInterface>();
-
 }
 
 void qf::registerFactory(const UUID& clsid, ptr<AbstractClassFactory> const& cf)
@@ -26,6 +21,9 @@ void qf::registerFactory(const UUID& clsid, ptr<AbstractClassFactory> const& cf)
 }
 
 ptr<Serializable> qf::createInstance_(const UUID& clsid) {
+	if (auto create = ClassRegistry::find(clsid)) {
+		return create();
+	}
 	auto it = factoryMap.find(clsid);
 	if (it == factoryMap.end()) {
 		return nullptr;
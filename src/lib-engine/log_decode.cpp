@@ -0,0 +1,91 @@
+#include "log_decode.hpp"
+
+namespace qf::log
+{
+	namespace
+	{
+		std::string_view asString(std::span<const std::byte> bytes) {
+			return { reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+		}
+	}
+
+	Expected<LogDecoder> LogDecoder::open(std::span<const std::byte> data)
+	{
+		LogDecoder decoder(data);
+		if (!decoder.read(decoder.header_) || decoder.header_.magic != LOG_FILE_MAGIC) {
+			return std::unexpected("not a binary log");
+		}
+		if (decoder.header_.version != LOG_FILE_VERSION) {
+			return std::unexpected(std::format("version {}, expected {}", decoder.header_.version, LOG_FILE_VERSION));
+		}
+		return decoder;
+	}
+
+	bool LogDecoder::readBytes(size_t size, std::span<const std::byte>& bytes)
+	{
+		if (data_.size() < size) {
+			return false;
+		}
+		bytes = data_.first(size);
+		data_ = data_.subspan(size);
+		return true;
+	}
+
+	Expected<void> LogDecoder::decodeRecord(std::string& text)
+	{
+		LogFileRecord type;
+		if (!read(type)) {
+			return std::unexpected("truncated record");
+		}
+
+		LogRecord record{};
+		std::span<const std::byte> bytes;
+		switch (type) {
+		case LogFileRecord::Site: {
+			u32 id;
+			u16 formatLength;
+			u8 argCount;
+			std::span<const std::byte> format;
+			std::span<const std::byte> argTypes;
+			if (!read(id) || !read(formatLength) || !read(argCount)
+				|| !readBytes(formatLength, format) || !readBytes(argCount, argTypes)) {
+				return std::unexpected("truncated site record");
+			}
+			if (id != sites_.size()) {
+				return std::unexpected(std::format("site {} out of sequence", id));
+			}
+			sites_.push_back(Site{
+				.format = asString(format),
+				.argTypes = { reinterpret_cast<const ArgType*>(argTypes.data()), argTypes.size() },
+			});
+			return {};
+		}
+		case LogFileRecord::Event: {
+			u32 id;
+			u32 argsSize;
+			if (!read(id) || !read(record.level) || !read(record.thread)
+				|| !read(record.time) || !read(argsSize) || !readBytes(argsSize, bytes)) {
+				return std::unexpected("truncated event record");
+			}
+			if (id >= sites_.size()) {
+				return std::unexpected(std::format("event refers to unknown site {}", id));
+			}
+			const std::string message = formatDeferred(sites_[id].format, sites_[id].argTypes, bytes);
+			record.message = message;
+			LogSink::formatRecord(text, record);
+			return {};
+		}
+		case LogFileRecord::Text: {
+			u32 length;
+			if (!read(record.level) || !read(record.thread) || !read(record.time)
+				|| !read(length) || !readBytes(length, bytes)) {
+				return std::unexpected("truncated text record");
+			}
+			record.message = asString(bytes);
+			LogSink::formatRecord(text, record);
+			return {};
+		}
+		}
+		return std::unexpected(std::format("unknown record type {}", static_cast<u32>(type)));
+	}
+}
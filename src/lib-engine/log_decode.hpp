@@ -0,0 +1,64 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "logger.hpp"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qf::log
+{
+	/**
+	 * @brief Turns a log written by BinaryFileSink back into text.
+	 *
+	 * Records are decoded one at a time into the lines ConsoleSink would have written for
+	 * them, so a log cut short by a crash still decodes up to the damage. The decoder reads
+	 * straight from data, which must outlive it.
+	 */
+	class LogDecoder
+	{
+		struct Site {
+			std::string_view format;
+			std::span<const ArgType> argTypes;
+		};
+
+		std::span<const std::byte> data_;
+		LogFileHeader header_{};
+		std::vector<Site> sites_{};
+
+		explicit LogDecoder(std::span<const std::byte> data)
+			: data_(data) {}
+
+		template<typename T>
+		bool read(T& value) {
+			if (data_.size() < sizeof(T)) {
+				return false;
+			}
+			std::memcpy(&value, data_.data(), sizeof(T));
+			data_ = data_.subspan(sizeof(T));
+			return true;
+		}
+
+		bool readBytes(size_t size, std::span<const std::byte>& bytes);
+
+	public:
+		/*
+		* fails when data isn't a binary log of this version
+		*/
+		static Expected<LogDecoder> open(std::span<const std::byte> data);
+
+		/*
+		* system clock time in nanoseconds when the log was started
+		*/
+		int64_t getStartTime() const { return header_.startTime; }
+
+		bool isAtEnd() const { return data_.empty(); }
+
+		/*
+		* appends the text of the next record, if it has any. fails once the log is damaged
+		*/
+		Expected<void> decodeRecord(std::string& text);
+	};
+}
@@ -0,0 +1,157 @@
+#include "log_format.hpp"
+
+#include <format>
+#include <tuple>
+#include <variant>
+
+namespace
+{
+	using namespace qf::log;
+
+	/*
+	* one decoded argument, formatted by the formatter of the type it was stored as
+	*/
+	struct DecodedArg {
+		std::variant<int64_t, bool, char, uint64_t, float, double, std::string_view, const void*> value{};
+	};
+
+	template<typename T>
+	bool read(std::span<const std::byte>& args, T& value) {
+		if (args.size() < sizeof(T)) {
+			return false;
+		}
+		std::memcpy(&value, args.data(), sizeof(T));
+		args = args.subspan(sizeof(T));
+		return true;
+	}
+
+	template<typename Stored>
+	bool decode(std::span<const std::byte>& args, DecodedArg& arg) {
+		Stored value;
+		if (!read(args, value)) {
+			return false;
+		}
+		arg.value = value;
+		return true;
+	}
+
+	bool decode(std::span<const std::byte>& args, ArgType type, DecodedArg& arg) {
+		switch (type) {
+		case ArgType::Bool: return decode<bool>(args, arg);
+		case ArgType::Char: return decode<char>(args, arg);
+		case ArgType::Int: return decode<int64_t>(args, arg);
+		case ArgType::UInt: return decode<uint64_t>(args, arg);
+		case ArgType::Float: return decode<float>(args, arg);
+		case ArgType::Double: return decode<double>(args, arg);
+		case ArgType::Pointer: {
+			uint64_t address;
+			if (!read(args, address)) {
+				return false;
+			}
+			arg.value = reinterpret_cast<const void*>(static_cast<uintptr_t>(address));
+			return true;
+		}
+		case ArgType::String: {
+			uint32_t length;
+			if (!read(args, length) || args.size() < length) {
+				return false;
+			}
+			arg.value = std::string_view(reinterpret_cast<const char*>(args.data()), length);
+			args = args.subspan(length);
+			return true;
+		}
+		}
+		return false;
+	}
+}
+
+/*
+* keeps the format spec from the format string and hands it, with the value, to the formatter
+* of the decoded type
+*/
+template<>
+struct std::formatter<DecodedArg> {
+	std::string_view spec_{};
+
+	constexpr auto parse(std::format_parse_context& ctx) {
+		auto it = ctx.begin();
+		while (it != ctx.end() && *it != '}') {
+			++it;
+		}
+		spec_ = std::string_view(ctx.begin(), it);
+		return it;
+	}
+
+	auto format(const DecodedArg& arg, std::format_context& ctx) const {
+		return std::visit([&](const auto& value) {
+			std::formatter<std::remove_cvref_t<decltype(value)>> formatter;
+			std::format_parse_context parseContext(spec_);
+			parseContext.advance_to(formatter.parse(parseContext));
+			return formatter.format(value, ctx);
+		}, arg.value);
+	}
+};
+
+namespace qf::log
+{
+	bool canDeferFormat(std::string_view format, std::span<const ArgType> argTypes)
+	{
+		size_t nextArg = 0;
+		for (size_t i = 0; i < format.size(); ++i) {
+			if (format[i] != '{') {
+				continue;
+			}
+			if (i + 1 < format.size() && format[i + 1] == '{') {
+				++i;
+				continue;
+			}
+			const size_t end = format.find('}', i);
+			if (end == std::string_view::npos) {
+				return false;
+			}
+			// a nested field ends at its own '}', so the outer field still holds its '{'
+			const std::string_view field = format.substr(i + 1, end - i - 1);
+			if (field.find('{') != std::string_view::npos) {
+				return false;
+			}
+			const size_t colon = field.find(':');
+			const std::string_view id = field.substr(0, colon);
+			size_t arg = nextArg++;
+			if (!id.empty()) {
+				arg = 0;
+				for (char c : id) {
+					arg = arg * 10 + static_cast<size_t>(c - '0');
+				}
+			}
+			const std::string_view spec = colon == std::string_view::npos ? std::string_view() : field.substr(colon + 1);
+			if (arg < argTypes.size() && argTypes[arg] == ArgType::String && (spec.ends_with('p') || spec.ends_with('P'))) {
+				return false;
+			}
+			i = end;
+		}
+		return true;
+	}
+
+	std::string formatDeferred(std::string_view format, std::span<const ArgType> argTypes, std::span<const std::byte> args)
+	{
+		std::array<DecodedArg, MAX_DEFERRED_ARGS> values{};
+		if (argTypes.size() > values.size()) {
+			return std::format("{} [too many arguments]", format);
+		}
+		for (size_t i = 0; i != argTypes.size(); ++i) {
+			if (!decode(args, argTypes[i], values[i])) {
+				return std::format("{} [damaged arguments]", format);
+			}
+		}
+
+		try {
+			// arguments past the ones the format string uses are ignored
+			return std::apply([&](auto&... value) {
+				return std::vformat(format, std::make_format_args(value...));
+			}, values);
+		}
+		catch (const std::format_error& e) {
+			return std::format("{} [{}]", format, e.what());
+		}
+	}
+}
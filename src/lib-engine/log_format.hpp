@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace qf
+{
+	namespace log
+	{
+		/*
+		* how an argument of a deferred message is stored. integers are widened to 64 bits,
+		* strings are copied as a 32 bit length followed by their bytes
+		*/
+		enum class ArgType : uint8_t {
+			Bool,
+			Char,
+			Int,
+			UInt,
+			Float,
+			Double,
+			String,
+			Pointer,
+		};
+
+		inline constexpr size_t MAX_DEFERRED_ARGS = 16;
+
+		template<typename T>
+		struct ArgTraits {
+			static constexpr bool ENCODABLE = false;
+		};
+
+		template<typename T>
+		inline constexpr bool IS_DEFERRABLE = ArgTraits<std::remove_cvref_t<T>>::ENCODABLE;
+
+		/*
+		* true when a message with these arguments can be logged without formatting it on the
+		* calling thread
+		*/
+		template<typename... Args>
+		inline constexpr bool CAN_DEFER = sizeof...(Args) <= MAX_DEFERRED_ARGS && (IS_DEFERRABLE<Args> && ...);
+
+		template<typename... Args>
+		inline constexpr std::array<ArgType, sizeof...(Args)> ARG_TYPES{ ArgTraits<std::remove_cvref_t<Args>>::TYPE... };
+
+		namespace detail
+		{
+			template<ArgType Type, typename Stored>
+			struct FixedArg {
+				static constexpr bool ENCODABLE = true;
+				static constexpr ArgType TYPE = Type;
+				static constexpr size_t SIZE = sizeof(Stored);
+
+				template<typename T>
+				static std::byte* encode(std::byte* out, size_t&, const T& value) {
+					const Stored stored = static_cast<Stored>(value);
+					std::memcpy(out, &stored, sizeof(stored));
+					return out + sizeof(stored);
+				}
+			};
+
+			struct StringArg {
+				static constexpr bool ENCODABLE = true;
+				static constexpr ArgType TYPE = ArgType::String;
+				static constexpr size_t SIZE = sizeof(uint32_t);
+
+				/*
+				* truncates the string to what is left of the budget for string bytes
+				*/
+				static std::byte* encode(std::byte* out, size_t& stringBudget, std::string_view value) {
+					const auto length = static_cast<uint32_t>(std::min(value.size(), stringBudget));
+					stringBudget -= length;
+					std::memcpy(out, &length, SIZE);
+					std::memcpy(out + SIZE, value.data(), length);
+					return out + SIZE + length;
+				}
+			};
+		}
+
+		template<> struct ArgTraits<bool> : detail::FixedArg<ArgType::Bool, bool> {};
+		template<> struct ArgTraits<char> : detail::FixedArg<ArgType::Char, char> {};
+		template<> struct ArgTraits<float> : detail::FixedArg<ArgType::Float, float> {};
+		template<> struct ArgTraits<double> : detail::FixedArg<ArgType::Double, double> {};
+		template<> struct ArgTraits<const void*> : detail::FixedArg<ArgType::Pointer, uint64_t> {
+			static std::byte* encode(std::byte* out, size_t& stringBudget, const void* value) {
+				return FixedArg::encode(out, stringBudget, reinterpret_cast<uintptr_t>(value));
+			}
+		};
+		template<> struct ArgTraits<void*> : ArgTraits<const void*> {};
+		template<> struct ArgTraits<std::nullptr_t> : ArgTraits<const void*> {};
+
+		template<typename T>
+			requires (std::is_integral_v<T> && std::is_signed_v<T> && !std::is_same_v<T, char>)
+		struct ArgTraits<T> : detail::FixedArg<ArgType::Int, int64_t> {};
+
+		template<typename T>
+			requires (std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char>)
+		struct ArgTraits<T> : detail::FixedArg<ArgType::UInt, uint64_t> {};
+
+		template<> struct ArgTraits<std::string_view> : detail::StringArg {};
+		template<> struct ArgTraits<std::string> : detail::StringArg {};
+		template<> struct ArgTraits<const char*> : detail::StringArg {};
+		template<> struct ArgTraits<char*> : detail::StringArg {};
+		template<size_t N> struct ArgTraits<char[N]> : detail::StringArg {
+			static std::byte* encode(std::byte* out, size_t& stringBudget, const char(&value)[N]) {
+				return StringArg::encode(out, stringBudget, std::string_view(value));
+			}
+		};
+
+		/*
+		* bytes taken by the fixed size part of the arguments, a string's length but not its bytes
+		*/
+		template<typename... Args>
+		inline constexpr size_t FIXED_ARGS_SIZE = (size_t(0) + ... + ArgTraits<std::remove_cvref_t<Args>>::SIZE);
+
+		/*
+		* writes the arguments to out, which must have room for FIXED_ARGS_SIZE plus stringBudget
+		* bytes, and returns the end of what was written
+		*/
+		template<typename... Args>
+		std::byte* encodeArgs(std::byte* out, size_t stringBudget, const Args&... args) {
+			((out = ArgTraits<std::remove_cvref_t<Args>>::encode(out, stringBudget, args)), ...);
+			return out;
+		}
+
+		/*
+		* false when the format string can't be applied to the arguments as they are stored,
+		* although it could to the original ones: a field with a dynamic width or precision,
+		* or a pointer presentation of a string. such messages are formatted eagerly
+		*/
+		bool canDeferFormat(std::string_view format, std::span<const ArgType> argTypes);
+
+		/*
+		* formats a deferred message from its encoded arguments, the same text std::format would
+		* have produced from the original ones. a damaged record or a format string that doesn't
+		* match its arguments gives the format string with a note instead of failing
+		*/
+		std::string formatDeferred(std::string_view format, std::span<const ArgType> argTypes, std::span<const std::byte> args);
+
+		/*
+		* the binary log file written by BinaryFileSink and read by bin-logdecode. a header is
+		* followed by a stream of records, each starting with its LogFileRecord. a site record
+		* defines a format string and its argument types the first time one is used, events
+		* refer to it by id. all integers are little endian
+		*/
+		inline constexpr uint32_t LOG_FILE_MAGIC = 0x474c4651; // "QFLG"
+		inline constexpr uint32_t LOG_FILE_VERSION = 1;
+
+		struct LogFileHeader {
+			uint32_t magic;
+			uint32_t version;
+			// system clock time in nanoseconds when the log was started, event times are relative to it
+			int64_t startTime;
+		};
+
+		enum class LogFileRecord : uint8_t {
+			// u32 site id, u16 format length, u8 argument count, format bytes, ArgType each
+			Site,
+			// u32 site id, u8 level, u32 thread, s64 time, u32 argument bytes, arguments
+			Event,
+			// u8 level, u32 thread, s64 time, u32 text length, text
+			Text,
+		};
+	}
+}
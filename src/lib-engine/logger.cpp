@@ -0,0 +1,625 @@
+#include "logger.hpp"
+#include "application_context.hpp"
+#include "hash.hpp"
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	static constexpr std::string_view FILE_PROP_NAME{ "log.file" };
+	static constexpr std::string_view BINARY_FILE_PROP_NAME{ "log.binary-file" };
+	static constexpr std::string_view CONSOLE_PROP_NAME{ "log.console" };
+	static constexpr std::string_view BUFFER_SIZE_PROP_NAME{ "log.buffer-size" };
+
+	constexpr size_t MIN_BUFFER_SIZE = 16 * 1024;
+	constexpr size_t MAX_BUFFER_SIZE = 64 * 1024 * 1024;
+	constexpr std::chrono::milliseconds DRAIN_INTERVAL{ 10 };
+
+	using namespace qf::log;
+
+	/*
+	* every record starts on a RECORD_ALIGNMENT boundary, so there is always room for a header
+	* before the end of the ring. a header with SKIP_LEVEL pads out the end when the next record
+	* doesn't fit there
+	*/
+	struct RecordHeader {
+		uint32_t size;
+		uint16_t length;
+		Level level;
+		bool deferred;
+		int64_t time;
+	};
+
+	/*
+	* follows the header of a deferred record, the encoded arguments follow it
+	*/
+	struct DeferredPrefix {
+		const char* format;
+		const ArgType* argTypes;
+		uint32_t formatLength;
+		uint32_t argCount;
+	};
+
+	constexpr size_t RECORD_ALIGNMENT = sizeof(RecordHeader);
+	constexpr Level SKIP_LEVEL = static_cast<Level>(0xff);
+
+	static_assert(sizeof(RecordHeader) == 16);
+	static_assert(detail::MAX_MESSAGE_LENGTH + sizeof(DeferredPrefix) <= UINT16_MAX);
+
+	/*
+	* steady_clock is read through the vDSO on Linux and QueryPerformanceCounter on Windows,
+	* both a few tens of nanoseconds, so it is cheap enough for per-frame loops
+	*/
+	int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/*
+	* single producer, single consumer byte ring owned by one logging thread
+	*/
+	class ThreadBuffer : qf::NonCopyable
+	{
+		std::unique_ptr<std::byte[]> data_;
+		size_t mask_;
+
+		alignas(64) std::atomic<size_t> head_{};
+		size_t cachedTail_ = 0;
+
+		alignas(64) std::atomic<size_t> tail_{};
+
+	public:
+		const uint32_t index;
+		std::atomic<bool> retired{};
+
+		ThreadBuffer(size_t capacity, uint32_t index)
+			: data_(std::make_unique<std::byte[]>(capacity))
+			, mask_(capacity - 1)
+			, index(index) {}
+
+		/*
+		* writes prefix and body as one record
+		*/
+		bool push(Level level, int64_t time, std::span<const std::byte> prefix, std::span<const std::byte> body) {
+			const size_t length = prefix.size() + body.size();
+			const size_t size = (sizeof(RecordHeader) + length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+			const size_t head = head_.load(std::memory_order_relaxed);
+			const size_t contiguous = mask_ + 1 - (head & mask_);
+			const size_t padding = size > contiguous ? contiguous : 0;
+
+			if (head + padding + size - cachedTail_ > mask_ + 1) {
+				cachedTail_ = tail_.load(std::memory_order_acquire);
+				if (head + padding + size - cachedTail_ > mask_ + 1) {
+					return false;
+				}
+			}
+
+			if (padding != 0) {
+				const RecordHeader skip{ .size = static_cast<uint32_t>(padding), .level = SKIP_LEVEL };
+				std::memcpy(data_.get() + (head & mask_), &skip, sizeof(skip));
+			}
+			std::byte* record = data_.get() + ((head + padding) & mask_);
+			const RecordHeader header{
+				.size = static_cast<uint32_t>(size),
+				.length = static_cast<uint16_t>(length),
+				.level = level,
+				.deferred = !prefix.empty(),
+				.time = time,
+			};
+			std::memcpy(record, &header, sizeof(header));
+			if (!prefix.empty()) {
+				std::memcpy(record + sizeof(header), prefix.data(), prefix.size());
+			}
+			std::memcpy(record + sizeof(header) + prefix.size(), body.data(), body.size());
+			head_.store(head + padding + size, std::memory_order_release);
+			return true;
+		}
+
+		/*
+		* appends the records written so far to out, returns the position to release them up to
+		*/
+		size_t peek(std::vector<LogRecord>& out, int64_t startTime) const {
+			const size_t head = head_.load(std::memory_order_acquire);
+			size_t tail = tail_.load(std::memory_order_relaxed);
+			while (tail != head) {
+				const std::byte* record = data_.get() + (tail & mask_);
+				RecordHeader header;
+				std::memcpy(&header, record, sizeof(header));
+				const std::byte* body = record + sizeof(header);
+				if (header.level == SKIP_LEVEL) {
+				}
+				else if (header.deferred) {
+					DeferredPrefix prefix;
+					std::memcpy(&prefix, body, sizeof(prefix));
+					out.push_back(LogRecord{
+						.level = header.level,
+						.thread = index,
+						.time = header.time - startTime,
+						.format = std::string_view(prefix.format, prefix.formatLength),
+						.argTypes = std::span(prefix.argTypes, prefix.argCount),
+						.args = std::span(body + sizeof(prefix), header.length - sizeof(prefix)),
+					});
+				}
+				else {
+					out.push_back(LogRecord{
+						.level = header.level,
+						.thread = index,
+						.time = header.time - startTime,
+						.message = std::string_view(reinterpret_cast<const char*>(body), header.length),
+					});
+				}
+				tail += header.size;
+			}
+			return tail;
+		}
+
+		void release(size_t tail) {
+			tail_.store(tail, std::memory_order_release);
+		}
+
+		bool isEmpty() const {
+			return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	 * @brief Owns the thread buffers and the thread that drains them into the sinks.
+	 */
+	class Logger : qf::NonCopyable
+	{
+		const int64_t startTime_ = now();
+		const int64_t startSystemTime_ = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		std::mutex buffersMutex_{};
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers_{};
+		uint32_t nextThreadIndex_ = 0;
+		std::atomic<size_t> bufferSize_{ Settings{}.bufferSize };
+
+		// taken by the logger thread while writing, so sinks can be replaced safely
+		std::mutex sinksMutex_{};
+		std::vector<std::unique_ptr<LogSink>> sinks_{};
+
+		// the text of deferred records in the current batch, reused from batch to batch
+		std::vector<std::string> texts_{};
+
+		std::mutex wakeMutex_{};
+		std::condition_variable wake_{};
+		std::condition_variable flushed_{};
+		uint64_t flushRequests_ = 0;
+		uint64_t flushedRequests_ = 0;
+		// a warning or an error is waiting, drain now instead of after DRAIN_INTERVAL
+		bool urgent_ = false;
+		bool running_ = true;
+
+		std::atomic<uint64_t> dropped_{};
+		uint64_t reportedDropped_ = 0;
+
+		std::thread thread_{};
+
+		void drain() {
+			std::vector<std::pair<ThreadBuffer*, size_t>> positions;
+			std::vector<LogRecord> records;
+			{
+				std::lock_guard lock(buffersMutex_);
+				// a retired buffer seen empty here can't be written to again
+				std::erase_if(buffers_, [](auto const& buffer) {
+					return buffer->retired.load(std::memory_order_acquire) && buffer->isEmpty();
+				});
+				for (auto const& buffer : buffers_) {
+					positions.emplace_back(buffer.get(), buffer->peek(records, startTime_));
+				}
+			}
+
+			// each buffer is already in order, so a stable sort keeps a thread's messages in sequence
+			std::stable_sort(records.begin(), records.end(), [](auto const& a, auto const& b) { return a.time < b.time; });
+
+			const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+			std::string droppedMessage;
+			if (dropped != reportedDropped_) {
+				droppedMessage = std::format("{} log messages dropped, the thread buffers were full", dropped - reportedDropped_);
+				records.push_back(LogRecord{ .level = Level::Warn, .time = now() - startTime_, .message = droppedMessage });
+				reportedDropped_ = dropped;
+			}
+
+			{
+				std::lock_guard lock(sinksMutex_);
+				const bool needsText = std::any_of(sinks_.begin(), sinks_.end(), [](auto const& sink) { return sink->needsText(); });
+				if (needsText) {
+					texts_.resize(std::max(texts_.size(), records.size()));
+					for (size_t i = 0; i != records.size(); ++i) {
+						if (records[i].isDeferred()) {
+							texts_[i] = formatDeferred(records[i].format, records[i].argTypes, records[i].args);
+							records[i].message = texts_[i];
+						}
+					}
+				}
+				if (!records.empty()) {
+					for (auto const& sink : sinks_) {
+						sink->write(records);
+					}
+				}
+				for (auto const& sink : sinks_) {
+					sink->flush();
+				}
+			}
+
+			// the buffers can't be removed while they are here, only this thread removes them
+			for (auto [buffer, tail] : positions) {
+				buffer->release(tail);
+			}
+		}
+
+		void run() {
+			std::unique_lock lock(wakeMutex_);
+			for (;;) {
+				wake_.wait_for(lock, DRAIN_INTERVAL, [this] { return !running_ || urgent_ || flushRequests_ != flushedRequests_; });
+				const bool running = running_;
+				const uint64_t requests = flushRequests_;
+				// cleared before draining, so a warning pushed while this drain runs wakes the next one
+				urgent_ = false;
+				lock.unlock();
+
+				drain();
+
+				lock.lock();
+				flushedRequests_ = requests;
+				flushed_.notify_all();
+				if (!running) {
+					return;
+				}
+			}
+		}
+
+	public:
+		Logger() {
+			sinks_.push_back(std::make_unique<ConsoleSink>());
+			thread_ = std::thread([this] { run(); });
+		}
+
+		~Logger() {
+			{
+				std::lock_guard lock(wakeMutex_);
+				running_ = false;
+			}
+			wake_.notify_one();
+			thread_.join();
+
+			// threads still running may hold on to their buffers past this point
+			for (auto& buffer : buffers_) {
+				if (!buffer->retired.load()) {
+					buffer.release();
+				}
+			}
+		}
+
+		ThreadBuffer* createBuffer() {
+			std::lock_guard lock(buffersMutex_);
+			const size_t size = std::bit_ceil(std::clamp(bufferSize_.load(std::memory_order_relaxed), MIN_BUFFER_SIZE, MAX_BUFFER_SIZE));
+			buffers_.push_back(std::make_unique<ThreadBuffer>(size, nextThreadIndex_++));
+			return buffers_.back().get();
+		}
+
+		void submit(ThreadBuffer& buffer, Level level, std::span<const std::byte> prefix, std::span<const std::byte> body) {
+			if (!buffer.push(level, now(), prefix, body)) {
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			// warnings and errors go out straight away rather than with the next batch
+			if (level >= Level::Warn) {
+				{
+					std::lock_guard lock(wakeMutex_);
+					urgent_ = true;
+				}
+				wake_.notify_one();
+			}
+		}
+
+		void flush() {
+			std::unique_lock lock(wakeMutex_);
+			const uint64_t request = ++flushRequests_;
+			wake_.notify_one();
+			flushed_.wait(lock, [&] { return flushedRequests_ >= request; });
+		}
+
+		void setSinks(std::vector<std::unique_ptr<LogSink>>&& sinks) {
+			std::lock_guard lock(sinksMutex_);
+			sinks_ = std::move(sinks);
+		}
+
+		void addSink(std::unique_ptr<LogSink>&& sink) {
+			std::lock_guard lock(sinksMutex_);
+			sinks_.push_back(std::move(sink));
+		}
+
+		void setBufferSize(size_t size) {
+			bufferSize_.store(size, std::memory_order_relaxed);
+		}
+
+		int64_t getStartSystemTime() const {
+			return startSystemTime_;
+		}
+
+		uint64_t getDroppedCount() const {
+			return dropped_.load(std::memory_order_relaxed);
+		}
+	};
+
+	Logger& getLogger() {
+		static Logger logger;
+		return logger;
+	}
+
+	/*
+	* marks the thread's buffer retired when the thread exits, the logger frees it once drained
+	*/
+	struct ThreadHandle {
+		ThreadBuffer* buffer{};
+
+		~ThreadHandle() {
+			if (buffer) {
+				buffer->retired.store(true, std::memory_order_release);
+			}
+		}
+	};
+
+	thread_local ThreadHandle threadHandle_{};
+
+	/*
+	* canDeferFormat() for the format strings the thread logs with, direct mapped by their
+	* address. a collision only costs scanning the format string again
+	*/
+	struct DeferrableSite {
+		const char* format;
+		const ArgType* argTypes;
+		bool deferrable;
+	};
+
+	thread_local std::array<DeferrableSite, 256> deferrableSites_{};
+}
+
+namespace qf::log
+{
+	std::string_view getLevelName(Level level)
+	{
+		switch (level) {
+		case Level::Trace: return "trace";
+		case Level::Debug: return "debug";
+		case Level::Info: return "info";
+		case Level::Warn: return "warn";
+		case Level::Error: return "error";
+		}
+		return "?";
+	}
+
+	void LogSink::formatRecord(std::string& out, const LogRecord& record)
+	{
+		std::format_to(std::back_inserter(out), "{:12.6f} {:<5} [{}] {}\n",
+			static_cast<double>(record.time) * 1e-9, getLevelName(record.level), record.thread, record.message);
+	}
+
+	void ConsoleSink::write(std::span<const LogRecord> records)
+	{
+		for (auto const& record : records) {
+			formatRecord(buffer_, record);
+		}
+	}
+
+	void ConsoleSink::flush()
+	{
+		std::fwrite(buffer_.data(), 1, buffer_.size(), stdout);
+		std::fflush(stdout);
+		buffer_.clear();
+	}
+
+	FileSink::FileSink(const std::string& path)
+		: file_(std::fopen(path.c_str(), "wb"))
+	{
+	}
+
+	FileSink::~FileSink()
+	{
+		if (file_) {
+			std::fclose(file_);
+		}
+	}
+
+	void FileSink::write(std::span<const LogRecord> records)
+	{
+		for (auto const& record : records) {
+			formatRecord(buffer_, record);
+		}
+	}
+
+	void FileSink::flush()
+	{
+		if (file_) {
+			std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+			std::fflush(file_);
+		}
+		buffer_.clear();
+	}
+
+	namespace
+	{
+		template<typename T>
+		void append(std::string& out, const T& value) {
+			out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+	}
+
+	size_t BinaryFileSink::SiteKeyHash::operator()(const SiteKey& key) const
+	{
+		return static_cast<size_t>(qf::detail::mix64(reinterpret_cast<uintptr_t>(key.format) ^ qf::detail::mix64(reinterpret_cast<uintptr_t>(key.argTypes))));
+	}
+
+	BinaryFileSink::BinaryFileSink(const std::string& path, int64_t startTime)
+		: file_(std::fopen(path.c_str(), "wb"))
+	{
+		const LogFileHeader header{ .magic = LOG_FILE_MAGIC, .version = LOG_FILE_VERSION, .startTime = startTime };
+		append(buffer_, header);
+	}
+
+	BinaryFileSink::~BinaryFileSink()
+	{
+		if (file_) {
+			std::fclose(file_);
+		}
+	}
+
+	uint32_t BinaryFileSink::getSiteId(const LogRecord& record)
+	{
+		auto [it, inserted] = sites_.try_emplace(SiteKey{ record.format.data(), record.argTypes.data() }, static_cast<uint32_t>(sites_.size()));
+		if (inserted) {
+			append(buffer_, LogFileRecord::Site);
+			append(buffer_, it->second);
+			append(buffer_, static_cast<uint16_t>(record.format.size()));
+			append(buffer_, static_cast<uint8_t>(record.argTypes.size()));
+			buffer_.append(record.format);
+			buffer_.append(reinterpret_cast<const char*>(record.argTypes.data()), record.argTypes.size());
+		}
+		return it->second;
+	}
+
+	void BinaryFileSink::write(std::span<const LogRecord> records)
+	{
+		for (auto const& record : records) {
+			if (record.isDeferred()) {
+				const uint32_t siteId = getSiteId(record);
+				append(buffer_, LogFileRecord::Event);
+				append(buffer_, siteId);
+				append(buffer_, record.level);
+				append(buffer_, record.thread);
+				append(buffer_, record.time);
+				append(buffer_, static_cast<uint32_t>(record.args.size()));
+				buffer_.append(reinterpret_cast<const char*>(record.args.data()), record.args.size());
+			}
+			else {
+				append(buffer_, LogFileRecord::Text);
+				append(buffer_, record.level);
+				append(buffer_, record.thread);
+				append(buffer_, record.time);
+				append(buffer_, static_cast<uint32_t>(record.message.size()));
+				buffer_.append(record.message);
+			}
+		}
+	}
+
+	void BinaryFileSink::flush()
+	{
+		if (file_) {
+			std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+			std::fflush(file_);
+		}
+		buffer_.clear();
+	}
+
+	auto Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		if (auto value = config->getString(FILE_PROP_NAME)) {
+			settings.file = std::string(*value);
+		}
+		if (auto value = config->getString(BINARY_FILE_PROP_NAME)) {
+			settings.binaryFile = std::string(*value);
+		}
+		if (auto value = config->getBool(CONSOLE_PROP_NAME)) {
+			settings.console = *value;
+		}
+		if (auto value = config->getInt(BUFFER_SIZE_PROP_NAME)) {
+			settings.bufferSize = static_cast<size_t>(std::clamp<s64>(*value, MIN_BUFFER_SIZE, MAX_BUFFER_SIZE));
+		}
+		return settings;
+	}
+
+	void initialize(const Settings& settings)
+	{
+		std::vector<std::unique_ptr<LogSink>> sinks;
+		if (settings.console) {
+			sinks.push_back(std::make_unique<ConsoleSink>());
+		}
+		auto& logger = getLogger();
+		std::vector<std::string_view> failed;
+		if (!settings.file.empty()) {
+			auto sink = std::make_unique<FileSink>(settings.file);
+			if (!sink->isOpen()) {
+				failed.push_back(settings.file);
+			}
+			sinks.push_back(std::move(sink));
+		}
+		if (!settings.binaryFile.empty()) {
+			auto sink = std::make_unique<BinaryFileSink>(settings.binaryFile, logger.getStartSystemTime());
+			if (!sink->isOpen()) {
+				failed.push_back(settings.binaryFile);
+			}
+			sinks.push_back(std::move(sink));
+		}
+
+		// whatever was logged so far goes to the sinks it was logged under
+		logger.flush();
+		logger.setBufferSize(settings.bufferSize);
+		logger.setSinks(std::move(sinks));
+		for (auto file : failed) {
+			warn("can't open log file {}", file);
+		}
+	}
+
+	void addSink(std::unique_ptr<LogSink>&& sink)
+	{
+		getLogger().addSink(std::move(sink));
+	}
+
+	void flush()
+	{
+		getLogger().flush();
+	}
+
+	uint64_t getDroppedCount()
+	{
+		return getLogger().getDroppedCount();
+	}
+
+	void detail::submit(Level level, std::string_view message)
+	{
+		auto& logger = getLogger();
+		if (!threadHandle_.buffer) {
+			threadHandle_.buffer = logger.createBuffer();
+		}
+		logger.submit(*threadHandle_.buffer, level, {}, std::as_bytes(std::span(message)));
+	}
+
+	bool detail::isDeferrable(std::string_view format, std::span<const ArgType> argTypes)
+	{
+		const uintptr_t key = reinterpret_cast<uintptr_t>(format.data()) ^ (reinterpret_cast<uintptr_t>(argTypes.data()) >> 4);
+		auto& site = deferrableSites_[(key >> 3) % deferrableSites_.size()];
+		if (site.format != format.data() || site.argTypes != argTypes.data()) {
+			site = DeferrableSite{ .format = format.data(), .argTypes = argTypes.data(), .deferrable = canDeferFormat(format, argTypes) };
+		}
+		return site.deferrable;
+	}
+
+	void detail::submitDeferred(Level level, std::string_view format, std::span<const ArgType> argTypes, std::span<const std::byte> args)
+	{
+		auto& logger = getLogger();
+		if (!threadHandle_.buffer) {
+			threadHandle_.buffer = logger.createBuffer();
+		}
+		const DeferredPrefix prefix{
+			.format = format.data(),
+			.argTypes = argTypes.data(),
+			.formatLength = static_cast<uint32_t>(format.size()),
+			.argCount = static_cast<uint32_t>(argTypes.size()),
+		};
+		logger.submit(*threadHandle_.buffer, level, std::as_bytes(std::span(&prefix, 1)), args);
+	}
+}
@@ -1,15 +1,263 @@
 #pragma once
 
+#include "noncopyable.hpp"
+#include "log_format.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <format>
-#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// the lowest level compiled in, 0 trace, 1 debug, 2 info, 3 warn, 4 error
+#ifndef QF_LOG_LEVEL
+#ifdef NDEBUG
+#define QF_LOG_LEVEL 2
+#else
+#define QF_LOG_LEVEL 1
+#endif
+#endif
 
 namespace qf
 {
 	namespace log
 	{
+		enum class Level : uint8_t {
+			Trace,
+			Debug,
+			Info,
+			Warn,
+			Error,
+		};
+
+		inline constexpr Level COMPILED_LEVEL = static_cast<Level>(QF_LOG_LEVEL);
+
+		template<Level L>
+		inline constexpr bool IS_ENABLED = L >= COMPILED_LEVEL;
+
+		std::string_view getLevelName(Level level);
+
+		/*
+		* a message as it reaches the sinks. time is in nanoseconds since the logger started and
+		* thread is a small index handed out to each thread the first time it logs.
+		* a deferred message also has its format string and encoded arguments, and its text is
+		* only formatted, on the logger's thread, when a sink needs it
+		*/
+		struct LogRecord {
+			Level level;
+			uint32_t thread;
+			int64_t time;
+			std::string_view message;
+			std::string_view format{};
+			std::span<const ArgType> argTypes{};
+			std::span<const std::byte> args{};
+
+			bool isDeferred() const { return format.data() != nullptr; }
+		};
+
+		/**
+		 * @brief Destination for log records, called on the logger's thread only.
+		 *
+		 * Records arrive in batches, ordered by time across all threads.
+		 */
+		class LogSink : NonCopyable
+		{
+		public:
+			virtual ~LogSink() = default;
+
+			virtual void write(std::span<const LogRecord> records) = 0;
+
+			virtual void flush() {}
+
+			/*
+			* false when the sink never reads LogRecord::message of a deferred record
+			*/
+			virtual bool needsText() const { return true; }
+
+			/*
+			* appends the record as one line of text
+			*/
+			static void formatRecord(std::string& out, const LogRecord& record);
+		};
+
+		class ConsoleSink : public LogSink
+		{
+			std::string buffer_{};
+
+		public:
+			virtual void write(std::span<const LogRecord> records) override;
+
+			virtual void flush() override;
+		};
+
+		class FileSink : public LogSink
+		{
+			std::FILE* file_{};
+			std::string buffer_{};
+
+		public:
+			/*
+			* truncates the file. a sink that couldn't open its file drops everything
+			*/
+			explicit FileSink(const std::string& path);
+
+			virtual ~FileSink() override;
+
+			bool isOpen() const { return file_ != nullptr; }
+
+			virtual void write(std::span<const LogRecord> records) override;
+
+			virtual void flush() override;
+		};
+
+		/**
+		 * @brief Writes records without formatting them, for bin-logdecode to turn into text.
+		 *
+		 * Each format string is written once, the first time it is used, and every message
+		 * after that is an id, a timestamp and the raw bytes of its arguments. Messages that
+		 * were formatted when they were logged are written as text.
+		 */
+		class BinaryFileSink : public LogSink
+		{
+			struct SiteKey {
+				const char* format;
+				const ArgType* argTypes;
+
+				bool operator==(const SiteKey&) const = default;
+			};
+
+			struct SiteKeyHash {
+				size_t operator()(const SiteKey& key) const;
+			};
+
+			std::FILE* file_{};
+			std::string buffer_{};
+			std::unordered_map<SiteKey, uint32_t, SiteKeyHash> sites_{};
+
+			uint32_t getSiteId(const LogRecord& record);
+
+		public:
+			/*
+			* truncates the file and writes the header. startTime is the system clock time, in
+			* nanoseconds, that record times are relative to
+			*/
+			BinaryFileSink(const std::string& path, int64_t startTime);
+
+			virtual ~BinaryFileSink() override;
+
+			bool isOpen() const { return file_ != nullptr; }
+
+			virtual void write(std::span<const LogRecord> records) override;
+
+			virtual void flush() override;
+
+			virtual bool needsText() const override { return false; }
+		};
+
+		struct Settings {
+			// also write to this file when not empty
+			std::string file{};
+			// also write to this file in the binary format when not empty
+			std::string binaryFile{};
+			bool console = true;
+			// bytes of each thread's buffer, messages that don't fit are dropped. clamped to
+			// between 16 KB and 64 MB
+			size_t bufferSize = 256 * 1024;
+
+			static Settings fromConfig();
+		};
+
+		/*
+		* replaces the sinks. until this is called messages go to the console
+		*/
+		void initialize(const Settings& settings);
+
+		void addSink(std::unique_ptr<LogSink>&& sink);
+
+		/*
+		* blocks until everything logged before the call has been written out
+		*/
+		void flush();
+
+		/*
+		* number of messages dropped so far because their thread's buffer was full
+		*/
+		uint64_t getDroppedCount();
+
+		namespace detail
+		{
+			inline constexpr size_t MAX_MESSAGE_LENGTH = 2048;
+
+			/*
+			* copies the message into the calling thread's buffer
+			*/
+			void submit(Level level, std::string_view message);
+
+			/*
+			* copies the encoded arguments into the calling thread's buffer. the format string is
+			* kept by address
+			*/
+			void submitDeferred(Level level, std::string_view format, std::span<const ArgType> argTypes, std::span<const std::byte> args);
+
+			/*
+			* canDeferFormat(), remembered per thread by the address of the format string
+			*/
+			bool isDeferrable(std::string_view format, std::span<const ArgType> argTypes);
+
+			template<Level L, typename... Args>
+			void write(std::format_string<Args...> f, Args&&... args) {
+				if constexpr (IS_ENABLED<L>) {
+					if constexpr (CAN_DEFER<Args...>) {
+						if (isDeferrable(f.get(), ARG_TYPES<Args...>)) {
+							std::byte buffer[MAX_MESSAGE_LENGTH];
+							std::byte* end = encodeArgs(buffer, MAX_MESSAGE_LENGTH - FIXED_ARGS_SIZE<Args...>, args...);
+							submitDeferred(L, f.get(), ARG_TYPES<Args...>, std::span<const std::byte>(buffer, end));
+							return;
+						}
+					}
+					char buffer[MAX_MESSAGE_LENGTH];
+					const auto res = std::format_to_n(buffer, MAX_MESSAGE_LENGTH, f, std::forward<Args>(args)...);
+					submit(L, std::string_view(buffer, std::min<size_t>(res.size, MAX_MESSAGE_LENGTH)));
+				}
+			}
+		}
+
+		/*
+		* when every argument is a number, a string, a bool or a pointer, the call only copies
+		* the arguments and formatting happens later on the logger's thread, or not at all when
+		* every sink is binary. the format string must then be a literal, since it is kept by
+		* address. a format string using dynamic width or precision, or printing a string as a
+		* pointer, and any other message, are formatted on the calling thread. either way the
+		* logger's thread writes it out.
+		* calls below QF_LOG_LEVEL compile to nothing, though their arguments are still evaluated
+		*/
+		template<typename... Args>
+		void trace(std::format_string<Args...> f, Args&&... args) {
+			detail::write<Level::Trace>(f, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void debug(std::format_string<Args...> f, Args&&... args) {
+			detail::write<Level::Debug>(f, std::forward<Args>(args)...);
+		}
+
 		template<typename... Args>
 		void info(std::format_string<Args...> f, Args&&... args) {
-			std::cout << std::format(f, args...) << std::endl;
+			detail::write<Level::Info>(f, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void warn(std::format_string<Args...> f, Args&&... args) {
+			detail::write<Level::Warn>(f, std::forward<Args>(args)...);
+		}
+
+		template<typename... Args>
+		void error(std::format_string<Args...> f, Args&&... args) {
+			detail::write<Level::Error>(f, std::forward<Args>(args)...);
 		}
 	}
-}
\ No newline at end of file
+}
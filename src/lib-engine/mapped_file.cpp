@@ -0,0 +1,93 @@
+#include "mapped_file.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qf
+{
+#if defined(_WIN32)
+	Expected<Box<MappedFile>> MappedFile::open(const std::filesystem::path& path)
+	{
+		Box<MappedFile> file(new MappedFile());
+		file->file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file->file_ == INVALID_HANDLE_VALUE) {
+			file->file_ = nullptr;
+			return std::unexpected(std::format("can't open {}", path.string()));
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file->file_, &size)) {
+			return std::unexpected(std::format("can't get the size of {}", path.string()));
+		}
+		file->size_ = static_cast<size_t>(size.QuadPart);
+		if (file->size_ == 0) {
+			return file;
+		}
+
+		file->mapping_ = CreateFileMappingW(file->file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!file->mapping_) {
+			return std::unexpected(std::format("can't map {}", path.string()));
+		}
+		file->data_ = static_cast<const std::byte*>(MapViewOfFile(file->mapping_, FILE_MAP_READ, 0, 0, 0));
+		if (!file->data_) {
+			return std::unexpected(std::format("can't map {}", path.string()));
+		}
+		return file;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data_) {
+			UnmapViewOfFile(data_);
+		}
+		if (mapping_) {
+			CloseHandle(mapping_);
+		}
+		if (file_) {
+			CloseHandle(file_);
+		}
+	}
+#else
+	Expected<Box<MappedFile>> MappedFile::open(const std::filesystem::path& path)
+	{
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return std::unexpected(std::format("can't open {}", path.string()));
+		}
+
+		Box<MappedFile> file(new MappedFile());
+		struct stat info{};
+		if (fstat(fd, &info) != 0) {
+			close(fd);
+			return std::unexpected(std::format("can't get the size of {}", path.string()));
+		}
+		file->size_ = static_cast<size_t>(info.st_size);
+		if (file->size_ != 0) {
+			// the mapping keeps the file referenced, the descriptor isn't needed after this
+			void* data = mmap(nullptr, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED) {
+				close(fd);
+				return std::unexpected(std::format("can't map {}", path.string()));
+			}
+			file->data_ = static_cast<const std::byte*>(data);
+		}
+		close(fd);
+		return file;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (data_) {
+			munmap(const_cast<std::byte*>(data_), size_);
+		}
+	}
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <filesystem>
+#include <span>
+
+namespace qf
+{
+	/**
+	 * @brief A whole file mapped read-only into memory.
+	 *
+	 * Pages are loaded by the OS on first touch, so opening a large file is cheap and only
+	 * the parts that are read cost anything. The view stays valid for the MappedFile's
+	 * lifetime.
+	 */
+	class MappedFile : NonCopyable
+	{
+		const std::byte* data_{};
+		size_t size_ = 0;
+#if defined(_WIN32)
+		void* file_{};
+		void* mapping_{};
+#endif
+
+		MappedFile() = default;
+
+	public:
+		static Expected<Box<MappedFile>> open(const std::filesystem::path& path);
+
+		~MappedFile();
+
+		std::span<const std::byte> getData() const { return { data_, size_ }; }
+
+		size_t getSize() const { return size_; }
+	};
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "noncopyable.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace qf
+{
+	/**
+	 * @brief Per-type slab allocator with a free list.
+	 *
+	 * Objects are carved out of slabs of SLAB_SIZE slots, so objects of one type sit next to
+	 * each other in memory, and freed slots go onto a LIFO free list so the most recently freed
+	 * (and most likely cached) slot is reused first. Slabs are never returned to the heap.
+	 *
+	 * Each thread keeps its own free list and only takes the pool lock to trade a batch of
+	 * slots with the shared list, when its list runs dry or grows past two batches.
+	 *
+	 * The pool for each type is created on first use and deliberately never destroyed, so
+	 * objects released during static destruction still have a pool to go back to. A thread's
+	 * list is handed to the shared list when its thread_locals are destroyed, which for the
+	 * main thread is before its statics. After that the thread uses the shared list under
+	 * the lock.
+	 */
+	template<typename T>
+	class ObjectPool : NonCopyable
+	{
+		static constexpr size_t SLAB_SIZE = 64;
+		static constexpr size_t BATCH_SIZE = SLAB_SIZE;
+
+		union Slot {
+			Slot* next;
+			alignas(T) std::byte storage[sizeof(T)];
+		};
+
+		struct FreeList {
+			Slot* head{};
+			size_t count = 0;
+
+			void push(Slot* slot) {
+				slot->next = head;
+				head = slot;
+				++count;
+			}
+
+			Slot* pop() {
+				Slot* slot = head;
+				head = slot->next;
+				--count;
+				return slot;
+			}
+
+			/*
+			* moves up to n slots from the front of this list onto other
+			*/
+			void moveTo(FreeList& other, size_t n) {
+				while (n-- != 0 && head) {
+					other.push(pop());
+				}
+			}
+		};
+
+		struct ThreadCache {
+			FreeList list;
+
+			~ThreadCache() {
+				auto& pool = instance();
+				std::lock_guard lock(pool.mutex_);
+				list.moveTo(pool.shared_, list.count);
+				cacheGone_ = true;
+			}
+		};
+
+		// trivially destructible, so it can still be read once the cache is destroyed
+		static inline thread_local bool cacheGone_ = false;
+
+		std::mutex mutex_{};
+		FreeList shared_{};
+		std::vector<std::unique_ptr<Slot[]>> slabs_{};
+
+		ObjectPool() = default;
+
+		/*
+		* the calling thread's list, or nullptr once its cache has been destroyed
+		*/
+		static FreeList* localList() {
+			if (cacheGone_) {
+				return nullptr;
+			}
+			static thread_local ThreadCache cache;
+			return &cache.list;
+		}
+
+		/*
+		* makes sure the shared list has a slot, under the lock
+		*/
+		void growShared() {
+			if (!shared_.head) {
+				auto slab = std::make_unique<Slot[]>(SLAB_SIZE);
+				for (size_t i = SLAB_SIZE; i != 0; --i) {
+					shared_.push(&slab[i - 1]);
+				}
+				slabs_.emplace_back(std::move(slab));
+			}
+		}
+
+		void refill(FreeList& local) {
+			std::lock_guard lock(mutex_);
+			growShared();
+			shared_.moveTo(local, BATCH_SIZE);
+		}
+
+	public:
+		static ObjectPool& instance() {
+			static ObjectPool* pool = new ObjectPool();
+			return *pool;
+		}
+
+		/*
+		* returns uninitialized storage for one T
+		*/
+		void* allocate() {
+			FreeList* local = localList();
+			if (!local) {
+				std::lock_guard lock(mutex_);
+				growShared();
+				return shared_.pop()->storage;
+			}
+			if (!local->head) {
+				refill(*local);
+			}
+			return local->pop()->storage;
+		}
+
+		void deallocate(void* p) {
+			FreeList* local = localList();
+			if (!local) {
+				std::lock_guard lock(mutex_);
+				shared_.push(static_cast<Slot*>(p));
+				return;
+			}
+			local->push(static_cast<Slot*>(p));
+			if (local->count >= BATCH_SIZE * 2) {
+				std::lock_guard lock(mutex_);
+				local->moveTo(shared_, BATCH_SIZE);
+			}
+		}
+
+		template<typename... Args>
+		T* create(Args&&... args) {
+			void* p = allocate();
+			try {
+				return new (p) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				deallocate(p);
+				throw;
+			}
+		}
+
+		void destroy(T* obj) {
+			obj->~T();
+			deallocate(obj);
+		}
+
+		/*
+		* number of objects the pool's slabs have room for
+		*/
+		size_t getCapacity() {
+			std::lock_guard lock(mutex_);
+			return slabs_.size() * SLAB_SIZE;
+		}
+	};
+
+	/**
+	 * @brief Standard allocator drawing single objects from ObjectPool.
+	 *
+	 * Lets std::shared_ptr keep its control block in a pool of its own type, so creating a
+	 * shared object with a custom deleter doesn't go to the heap for the control block.
+	 */
+	template<typename T>
+	struct PoolAllocator {
+		using value_type = T;
+
+		PoolAllocator() = default;
+
+		template<typename U>
+		PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+		T* allocate(size_t n) {
+			if (n == 1) {
+				return static_cast<T*>(ObjectPool<T>::instance().allocate());
+			}
+			return std::allocator<T>{}.allocate(n);
+		}
+
+		void deallocate(T* p, size_t n) noexcept {
+			if (n == 1) {
+				ObjectPool<T>::instance().deallocate(p);
+				return;
+			}
+			std::allocator<T>{}.deallocate(p, n);
+		}
+
+		template<typename U>
+		bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+	};
+
+	/**
+	 * @brief Intrusive reference counted pointer to a Serializable.
+	 *
+	 * The count lives in the object itself, so copying a Ref is a single atomic increment
+	 * on memory the caller is about to touch anyway, and a Ref is one pointer wide.
+	 * Objects are created with makeRef(), which takes them from the ObjectPool for their type.
+	 * When the last Ref goes away the object is disposed, destroyed and its slot returned
+	 * to the pool.
+	 */
+	template<typename T>
+	class Ref
+	{
+		template<typename U>
+		friend class Ref;
+
+		T* p_{};
+
+	public:
+		Ref() = default;
+
+		Ref(std::nullptr_t) {}
+
+		explicit Ref(T* p)
+			: p_(p)
+		{
+			if (p_) {
+				p_->addRef();
+			}
+		}
+
+		Ref(const Ref& other)
+			: Ref(other.p_) {}
+
+		Ref(Ref&& other) noexcept
+			: p_(std::exchange(other.p_, nullptr)) {}
+
+		template<typename U>
+			requires std::convertible_to<U*, T*>
+		Ref(const Ref<U>& other)
+			: Ref(other.p_) {}
+
+		template<typename U>
+			requires std::convertible_to<U*, T*>
+		Ref(Ref<U>&& other) noexcept
+			: p_(std::exchange(other.p_, nullptr)) {}
+
+		~Ref() {
+			if (p_) {
+				p_->release();
+			}
+		}
+
+		Ref& operator=(Ref other) noexcept {
+			std::swap(p_, other.p_);
+			return *this;
+		}
+
+		void reset() {
+			Ref().swap(*this);
+		}
+
+		void swap(Ref& other) noexcept {
+			std::swap(p_, other.p_);
+		}
+
+		T* get() const { return p_; }
+
+		T* operator->() const { return p_; }
+
+		T& operator*() const { return *p_; }
+
+		explicit operator bool() const { return p_ != nullptr; }
+
+		template<typename U>
+		bool operator==(const Ref<U>& other) const { return p_ == other.p_; }
+
+		bool operator==(std::nullptr_t) const { return p_ == nullptr; }
+	};
+}
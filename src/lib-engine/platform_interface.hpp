@@ -1,15 +1,20 @@
 #pragma once
 
 #include "engine80.hpp"
+#include "service_slot.hpp"
 
 #include <vector>
 #include <optional>
+#include <chrono>
 
 namespace qf 
 {
 	class PlatformInterface : public Serializable
 	{
 	public:
+		static constexpr std::string_view SERVICE_NAME{ "platform" };
+		static constexpr ServiceSlot SERVICE_SLOT = ServiceSlot::Platform;
+
 		virtual std::expected<void,std::string> initialize() = 0;
 
 		/*
@@ -18,6 +23,12 @@ namespace qf
 		*/
 		virtual bool update(float timeDelta) = 0;
 
+		/*
+		* blocks until a platform event arrives or the timeout elapses.
+		* events are left for the next update() to handle
+		*/
+		virtual void waitEvents(std::chrono::microseconds timeout) = 0;
+
 		virtual Expected<intptr_t> getNativeWindowHandle() const = 0;
 
 		virtual std::optional<std::tuple<int, int>> getWindowExtents() const = 0;
@@ -0,0 +1,260 @@
+#include "profiler.hpp"
+#include "application_context.hpp"
+#include "logger.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	static constexpr std::string_view ENABLED_PROP_NAME{ "profiler.enabled" };
+	static constexpr std::string_view OUTPUT_PROP_NAME{ "profiler.output" };
+	static constexpr std::string_view BUFFER_SIZE_PROP_NAME{ "profiler.buffer-size" };
+
+	using namespace qf;
+	using Settings = profiler::Settings;
+
+	enum class EventType : u8 {
+		Zone,
+		Counter,
+		Frame,
+	};
+
+	/*
+	* payload is the duration of a zone, the bits of a counter's value or a frame's index
+	*/
+	struct Event {
+		const char* name;
+		s64 time;
+		u64 payload;
+		EventType type;
+	};
+
+	constexpr u32 CHUNK_EVENT_COUNT = 2048;
+
+	/*
+	* events are only appended by the owning thread. count and next are published with release
+	* so writeTrace() can read a chunk while its thread is still filling it
+	*/
+	struct Chunk {
+		Event events[CHUNK_EVENT_COUNT];
+		std::atomic<u32> count{};
+		std::atomic<Chunk*> next{};
+	};
+
+	struct ThreadEvents : NonCopyable {
+		u32 index;
+		std::mutex nameMutex{};
+		std::string name{};
+		std::atomic<Chunk*> first{};
+		Chunk* last{};
+		size_t chunkCount = 0;
+		std::atomic<u64> dropped{};
+
+		~ThreadEvents() {
+			for (Chunk* chunk = first.load(); chunk;) {
+				delete std::exchange(chunk, chunk->next.load());
+			}
+		}
+
+		void push(const Event& event, size_t maxChunks) {
+			u32 count = last ? last->count.load(std::memory_order_relaxed) : CHUNK_EVENT_COUNT;
+			if (count == CHUNK_EVENT_COUNT) {
+				if (chunkCount == maxChunks) {
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				auto* chunk = new Chunk;
+				if (last) {
+					last->next.store(chunk, std::memory_order_release);
+				}
+				else {
+					first.store(chunk, std::memory_order_release);
+				}
+				last = chunk;
+				++chunkCount;
+				count = 0;
+			}
+			last->events[count] = event;
+			last->count.store(count + 1, std::memory_order_release);
+		}
+	};
+
+	struct Globals {
+		std::mutex mutex{};
+		// never shrinks, threads that have exited keep their events for the trace
+		std::vector<Box<ThreadEvents>> threads{};
+		std::atomic<size_t> maxChunks{ Settings{}.bufferSize / sizeof(Chunk) };
+		const s64 startTime = profiler::detail::now();
+	};
+
+	Globals& globals() {
+		static Globals g;
+		return g;
+	}
+
+	thread_local ThreadEvents* threadEvents_{};
+
+	ThreadEvents& getThreadEvents() {
+		if (!threadEvents_) {
+			auto& g = globals();
+			std::lock_guard lock(g.mutex);
+			auto& events = g.threads.emplace_back(makeBox<ThreadEvents>());
+			events->index = static_cast<u32>(g.threads.size() - 1);
+			events->name = std::format("thread {}", events->index);
+			threadEvents_ = events.get();
+		}
+		return *threadEvents_;
+	}
+
+	void record(const Event& event) {
+		getThreadEvents().push(event, globals().maxChunks.load(std::memory_order_relaxed));
+	}
+
+	/*
+	* appends s as the contents of a JSON string
+	*/
+	void appendEscaped(std::string& out, std::string_view s) {
+		for (char c : s) {
+			switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					std::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(c));
+				}
+				else {
+					out += c;
+				}
+			}
+		}
+	}
+}
+
+namespace qf::profiler
+{
+	s64 detail::now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void detail::recordZone(const char* name, s64 start, s64 end)
+	{
+		record(Event{ .name = name, .time = start, .payload = static_cast<u64>(end - start), .type = EventType::Zone });
+	}
+
+	auto Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		if (auto value = config->getBool(ENABLED_PROP_NAME)) {
+			settings.enabled = *value;
+		}
+		if (auto value = config->getString(OUTPUT_PROP_NAME)) {
+			settings.output = std::string(*value);
+		}
+		if (auto value = config->getInt(BUFFER_SIZE_PROP_NAME)) {
+			settings.bufferSize = static_cast<size_t>(*value);
+		}
+		return settings;
+	}
+
+	void initialize(const Settings& settings)
+	{
+		globals().maxChunks.store(std::max<size_t>(1, settings.bufferSize / sizeof(Chunk)), std::memory_order_relaxed);
+		detail::enabled_.store(IS_COMPILED_IN && settings.enabled, std::memory_order_relaxed);
+	}
+
+	void setThreadName(std::string_view name)
+	{
+		auto& events = getThreadEvents();
+		std::lock_guard lock(events.nameMutex);
+		events.name = name;
+	}
+
+	void markFrame(u64 frameIndex)
+	{
+		if (isEnabled()) {
+			record(Event{ .name = "frame", .time = detail::now(), .payload = frameIndex, .type = EventType::Frame });
+		}
+	}
+
+	void recordCounter(const char* name, double value)
+	{
+		if (isEnabled()) {
+			record(Event{ .name = name, .time = detail::now(), .payload = std::bit_cast<u64>(value), .type = EventType::Counter });
+		}
+	}
+
+	Expected<void> writeTrace(const std::filesystem::path& path)
+	{
+		auto& g = globals();
+		std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		u64 dropped = 0;
+		{
+			std::lock_guard lock(g.mutex);
+			for (auto const& thread : g.threads) {
+				{
+					std::lock_guard nameLock(thread->nameMutex);
+					json += std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"", thread->index);
+					appendEscaped(json, thread->name);
+					json += "\"}},\n";
+				}
+				dropped += thread->dropped.load(std::memory_order_relaxed);
+
+				// chunks only ever gain events, so this reads a consistent prefix of them
+				for (const Chunk* chunk = thread->first.load(std::memory_order_acquire); chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+					const u32 count = chunk->count.load(std::memory_order_acquire);
+					for (u32 i = 0; i != count; ++i) {
+						const Event& event = chunk->events[i];
+						const double ts = static_cast<double>(event.time - g.startTime) * 1e-3;
+						json += "{\"name\":\"";
+						appendEscaped(json, event.name);
+						switch (event.type) {
+						case EventType::Zone:
+							json += std::format("\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}},\n",
+								thread->index, ts, static_cast<double>(event.payload) * 1e-3);
+							break;
+						case EventType::Counter:
+							json += std::format("\",\"ph\":\"C\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"args\":{{\"value\":{}}}}},\n",
+								thread->index, ts, std::bit_cast<double>(event.payload));
+							break;
+						case EventType::Frame:
+							json += std::format("\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"args\":{{\"index\":{}}}}},\n",
+								thread->index, ts, event.payload);
+							break;
+						}
+					}
+				}
+			}
+		}
+		// the trailing comma isn't valid JSON
+		if (json.ends_with(",\n")) {
+			json.erase(json.size() - 2);
+		}
+		json += "\n]}\n";
+
+		std::FILE* file = std::fopen(path.string().c_str(), "wb");
+		if (!file) {
+			return std::unexpected(std::format("can't write profiler trace to {}", path.string()));
+		}
+		const bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+		std::fclose(file);
+		if (!written) {
+			return std::unexpected(std::format("failed writing profiler trace to {}", path.string()));
+		}
+		if (dropped != 0) {
+			log::warn("profiler dropped {} events, the thread buffers were full", dropped);
+		}
+		return {};
+	}
+}
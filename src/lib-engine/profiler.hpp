@@ -0,0 +1,116 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace qf
+{
+	/**
+	 * @brief Scoped CPU zones, counters and frame markers, exported as a Chrome trace.
+	 *
+	 * Every thread records into buffers of its own without locking. writeTrace() turns
+	 * everything recorded so far into the JSON trace format read by chrome://tracing and
+	 * ui.perfetto.dev.
+	 *
+	 * Use it through the QF_PROFILE_ macros, which compile to nothing in builds without
+	 * QF_PROFILER. In builds with it, recording starts with the process so startup is
+	 * captured, and initialize() turns it off unless the config enables it. A zone costs one
+	 * relaxed load while recording is off.
+	 *
+	 * Names are kept by address, so they must outlive the export: string literals, __func__,
+	 * or strings owned by something that lives until writeTrace().
+	 */
+	namespace profiler
+	{
+#if defined(QF_PROFILER)
+		inline constexpr bool IS_COMPILED_IN = true;
+#else
+		inline constexpr bool IS_COMPILED_IN = false;
+#endif
+
+		struct Settings {
+			bool enabled = false;
+			// written by main when the application exits
+			std::string output{ "trace.json" };
+			// bytes of events each thread may record, events past that are dropped
+			size_t bufferSize = 16 * 1024 * 1024;
+
+			static Settings fromConfig();
+		};
+
+		namespace detail
+		{
+			inline std::atomic<bool> enabled_{ IS_COMPILED_IN };
+
+			s64 now();
+
+			void recordZone(const char* name, s64 start, s64 end);
+		}
+
+		inline bool isEnabled() {
+			return detail::enabled_.load(std::memory_order_relaxed);
+		}
+
+		/*
+		* recording stays off in builds without QF_PROFILER whatever the settings say
+		*/
+		void initialize(const Settings& settings);
+
+		/*
+		* names the calling thread in the trace
+		*/
+		void setThreadName(std::string_view name);
+
+		/*
+		* marks the start of a frame
+		*/
+		void markFrame(u64 frameIndex);
+
+		void recordCounter(const char* name, double value);
+
+		/*
+		* writes everything recorded so far, by every thread, as a Chrome trace
+		*/
+		Expected<void> writeTrace(const std::filesystem::path& path);
+
+		/*
+		* records the time from construction to destruction under name
+		*/
+		class Zone : NonCopyable
+		{
+			const char* name_;
+			s64 start_;
+
+		public:
+			explicit Zone(const char* name)
+				: name_(name)
+				, start_(isEnabled() ? detail::now() : -1) {}
+
+			~Zone() {
+				if (start_ >= 0) {
+					detail::recordZone(name_, start_, detail::now());
+				}
+			}
+		};
+	}
+}
+
+#if defined(QF_PROFILER)
+#define QF_PROFILE_CONCAT_(a, b) a##b
+#define QF_PROFILE_CONCAT(a, b) QF_PROFILE_CONCAT_(a, b)
+#define QF_PROFILE_ZONE(name) ::qf::profiler::Zone QF_PROFILE_CONCAT(profileZone_, __LINE__){ name }
+#define QF_PROFILE_FUNCTION() QF_PROFILE_ZONE(__func__)
+#define QF_PROFILE_FRAME(frameIndex) ::qf::profiler::markFrame(frameIndex)
+#define QF_PROFILE_COUNTER(name, value) ::qf::profiler::recordCounter(name, value)
+#define QF_PROFILE_THREAD_NAME(name) ::qf::profiler::setThreadName(name)
+#else
+#define QF_PROFILE_ZONE(name) do {} while (0)
+#define QF_PROFILE_FUNCTION() do {} while (0)
+#define QF_PROFILE_FRAME(frameIndex) do {} while (0)
+#define QF_PROFILE_COUNTER(name, value) do {} while (0)
+#define QF_PROFILE_THREAD_NAME(name) do {} while (0)
+#endif
@@ -1,15 +1,15 @@
 #include "platform_interface.hpp"
 #include "graphics.hpp"
 #include "class_ids.hpp"
-#include "class_factory.hpp"
+#include "profiler.hpp"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 #include <SDL2/SDL_syswm.h>
 
-#include <thread>
 #include <chrono>
 #include <ranges>
+#include <vector>
 
 namespace qf {
 	class Sdl2PlatformInterface
@@ -18,8 +18,22 @@ namespace qf {
 		static inline const char* CLASS_NAME = "Sdl2PlatformInterface";
 		SDL_Window* window_{};
 
+		/*
+		* events taken off the queue by waitEvents(), handled by the next update()
+		*/
+		std::vector<SDL_Event> pendingEvents_{};
+
+		bool handleEvent(const SDL_Event& e) {
+			switch (e.type) {
+			case SDL_QUIT:
+				return false;
+			}
+			return true;
+		}
+
 	public:
 		virtual std::expected<void, std::string> initialize() override {
+			QF_PROFILE_ZONE("Sdl2PlatformInterface::initialize");
 			int result;
 			if ((result = SDL_Init(SDL_INIT_VIDEO)))
 			{
@@ -44,15 +58,27 @@ namespace qf {
 		}
 
 		virtual bool update(float timeDelta) override {
+			bool running = true;
+			for (auto const& e : pendingEvents_) {
+				running &= handleEvent(e);
+			}
+			pendingEvents_.clear();
+
 			SDL_Event e{};
 			while (SDL_PollEvent(&e)) {
-				switch (e.type) {
-				case SDL_QUIT:
-					return false;
-				}
+				running &= handleEvent(e);
+			}
+			return running;
+		}
+
+		virtual void waitEvents(std::chrono::microseconds timeout) override {
+			// SDL waits in whole milliseconds, round down so we never wait past the timeout
+			const int ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+			SDL_Event e{};
+			if (ms > 0 && SDL_WaitEventTimeout(&e, ms)) {
+				// keep the event, otherwise it would wake every later wait until the next update
+				pendingEvents_.push_back(e);
 			}
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
-			return true;
 		}
 
 		virtual Expected<intptr_t> getNativeWindowHandle() const override {
@@ -89,20 +115,4 @@ namespace qf {
 }
 
 IMPLEMENT_CLASS_FACTORY(qf::Sdl2PlatformInterface);
-
-template<>
-void qf::registerFactory<qf::Sdl2PlatformInterface>() {
-	//class Sdl2PlatformInterfaceClassFactory : public ClassFactory
-	//{
-	//	virtual ptr<Serializable> create() const override {
-	//		auto obj = std::make_shared<Sdl2PlatformInterface>();
-	//		if (obj) {
-	//			if (auto res = obj->postConstruct(); res.has_value()) {
-	//				return obj;
-	//			}
-	//		}
-	//		return nullptr;
-	//	}
-	//};
-	registerFactory(Sdl2PlatformInterfaceClassId, std::make_shared<TClassFactory<Sdl2PlatformInterface>>());
-}
+IMPLEMENT_CLASS_FACTORY_UUID(qf::Sdl2PlatformInterface, qf::Sdl2PlatformInterfaceClassId);
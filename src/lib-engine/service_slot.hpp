@@ -0,0 +1,31 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <concepts>
+#include <string_view>
+
+namespace qf
+{
+	/*
+	* fixed slots for the services fetched on hot paths, see IApplicationContext::getService()
+	*/
+	enum class ServiceSlot : u32 {
+		Jobs,
+		Platform,
+		Graphics,
+		Io,
+		Assets,
+		Count,
+	};
+
+	/*
+	* a service interface with a slot of its own. it is registered under SERVICE_NAME as well,
+	* so it can still be found by name
+	*/
+	template<typename T>
+	concept SlottedService = std::derived_from<T, Serializable> && requires {
+		{ T::SERVICE_SLOT } -> std::convertible_to<ServiceSlot>;
+		{ T::SERVICE_NAME } -> std::convertible_to<std::string_view>;
+	};
+}
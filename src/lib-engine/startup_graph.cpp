@@ -0,0 +1,163 @@
+#include "startup_graph.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+
+namespace qf
+{
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		double millisecondsSince(Clock::time_point start, Clock::time_point now) {
+			return std::chrono::duration<double, std::milli>(now - start).count();
+		}
+	}
+
+	Expected<void> StartupGraph::addStep(StepDesc&& desc)
+	{
+		if (ran_) {
+			return std::unexpected("startup graph has already run");
+		}
+		if (!desc.fn) {
+			return std::unexpected(std::format("step {} has no function", desc.name));
+		}
+		auto findStep = [&](const std::string& name) {
+			return std::find_if(steps_.begin(), steps_.end(), [&](const StepDesc& step) { return step.name == name; });
+		};
+		if (findStep(desc.name) != steps_.end()) {
+			return std::unexpected(std::format("duplicate step {}", desc.name));
+		}
+
+		// steps can only follow earlier ones, so there can't be a cycle
+		std::vector<u32> after;
+		for (auto const& name : desc.after) {
+			auto it = findStep(name);
+			if (it == steps_.end()) {
+				return std::unexpected(std::format("step {} runs after {}, which hasn't been added", desc.name, name));
+			}
+			after.push_back(static_cast<u32>(it - steps_.begin()));
+		}
+		const u32 index = dependencies_.addTask();
+		for (u32 dependency : after) {
+			dependencies_.addDependency(index, dependency);
+		}
+		steps_.emplace_back(std::move(desc));
+		return {};
+	}
+
+	Expected<void> StartupGraph::run()
+	{
+		if (ran_) {
+			return std::unexpected("startup graph has already run");
+		}
+		ran_ = true;
+
+		const u32 count = static_cast<u32>(steps_.size());
+		remaining_.resize(count);
+		// steps that never run are left out of the critical path
+		finishMs_.assign(count, -1.0);
+		stats_.steps.resize(count);
+		for (u32 i = 0; i != count; ++i) {
+			remaining_[i] = static_cast<u32>(dependencies_.getDependencies(i).size());
+			stats_.steps[i] = StepTiming{
+				.name = steps_[i].name,
+				.startMs = 0,
+				.durationMs = 0,
+				.mainThread = steps_[i].mainThread,
+				.critical = false,
+			};
+		}
+
+		start_ = Clock::now();
+		{
+			std::unique_lock lock(mutex_);
+			for (u32 i = 0; i != count; ++i) {
+				if (dependencies_.getDependencies(i).empty()) {
+					schedule(i);
+				}
+			}
+
+			// the calling thread runs main thread steps as they become ready, and is done once
+			// nothing is running or waiting to
+			while (true) {
+				condition_.wait(lock, [this] { return !mainThreadReady_.empty() || pending_ == 0; });
+				if (mainThreadReady_.empty()) {
+					break;
+				}
+				const u32 next = mainThreadReady_.back();
+				mainThreadReady_.pop_back();
+				if (error_) {
+					--pending_;
+					continue;
+				}
+				lock.unlock();
+				runStep(next);
+				lock.lock();
+			}
+		}
+
+		// nothing starts another thread once pending_ is zero
+		for (auto& thread : threads_) {
+			thread.join();
+		}
+		threads_.clear();
+
+		stats_.totalMs = millisecondsSince(start_, Clock::now());
+		stats_.criticalPathMs = dependencies_.markCriticalPath(finishMs_, stats_.steps);
+
+		if (error_) {
+			return std::unexpected(std::move(*error_));
+		}
+		return {};
+	}
+
+	/*
+	* called with mutex_ held
+	*/
+	void StartupGraph::schedule(u32 index)
+	{
+		++pending_;
+		if (steps_[index].mainThread) {
+			mainThreadReady_.push_back(index);
+			condition_.notify_all();
+			return;
+		}
+		threads_.emplace_back([this, index] {
+			QF_PROFILE_THREAD_NAME(std::format("startup {}", steps_[index].name));
+			runStep(index);
+		});
+	}
+
+	void StartupGraph::runStep(u32 index)
+	{
+		auto& step = steps_[index];
+		const auto start = Clock::now();
+		auto result = [&] {
+			QF_PROFILE_ZONE(step.name.c_str());
+			return step.fn();
+		}();
+		const auto end = Clock::now();
+
+		std::lock_guard lock(mutex_);
+		auto& timing = stats_.steps[index];
+		timing.startMs = millisecondsSince(start_, start);
+		timing.durationMs = millisecondsSince(start, end);
+		finishMs_[index] = millisecondsSince(start_, end);
+
+		if (!result.has_value()) {
+			if (!error_) {
+				error_.emplace(std::format("startup step {} failed: {}", step.name, result.error().str()));
+			}
+		}
+		else if (!error_) {
+			for (u32 dependent : dependencies_.getDependents(index)) {
+				if (--remaining_[dependent] == 0) {
+					schedule(dependent);
+				}
+			}
+		}
+		--pending_;
+		condition_.notify_all();
+	}
+}
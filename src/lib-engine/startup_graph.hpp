@@ -0,0 +1,99 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "task_graph.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace qf
+{
+	/**
+	 * @brief Runs the steps of engine bring-up in dependency order, in parallel where possible.
+	 *
+	 * Each step names the earlier steps it must run after. A step runs as soon as those have
+	 * finished, on a thread of its own since the job system may not be up yet. Steps that must
+	 * stay on the thread calling run(), such as creating the window or starting the job system,
+	 * set mainThread.
+	 *
+	 * When a step fails nothing more is started, run() waits for the steps already running and
+	 * returns the first error. Afterwards getStats() holds the time spent in every step and the
+	 * critical path: the chain of dependent steps that limited the total startup time.
+	 */
+	class StartupGraph : NonCopyable
+	{
+	public:
+		using StepFn = std::function<Expected<void>()>;
+
+		struct StepDesc {
+			std::string name;
+			std::vector<std::string> after;
+			StepFn fn;
+			bool mainThread = false;
+		};
+
+		using StepTiming = TaskTiming;
+
+		struct Stats {
+			double totalMs;
+			double criticalPathMs;
+			std::vector<StepTiming> steps;
+		};
+
+		/*
+		* adds a step. the steps it runs after must have been added already
+		*/
+		Expected<void> addStep(StepDesc&& desc);
+
+		/*
+		* runs every step once and returns when they have all finished
+		*/
+		Expected<void> run();
+
+		const Stats& getStats() const { return stats_; }
+
+	private:
+		std::vector<StepDesc> steps_{};
+		TaskDependencies dependencies_{};
+		bool ran_ = false;
+
+		/*
+		* only used during run(), guarded by mutex_
+		*/
+		std::mutex mutex_{};
+		std::condition_variable condition_{};
+		std::vector<u32> remaining_{};
+		std::vector<u32> mainThreadReady_{};
+		std::vector<std::thread> threads_{};
+		std::vector<double> finishMs_{};
+		u32 pending_ = 0;
+		std::optional<Err> error_{};
+		std::chrono::steady_clock::time_point start_{};
+
+		Stats stats_{};
+
+		void schedule(u32 index);
+		void runStep(u32 index);
+	};
+}
+
+template<>
+struct std::formatter<qf::StartupGraph::Stats> {
+	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
+		return ctx.end();
+	}
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		auto out = format_to(ctx.out(), "startup: {:.3f} ms, critical path {:.3f} ms\n",
+			val.totalMs, val.criticalPathMs);
+		for (auto const& step : val.steps) {
+			out = format_to(out, "{}", step);
+		}
+		return out;
+	}
+};
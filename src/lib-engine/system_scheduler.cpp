@@ -0,0 +1,168 @@
+#include "system_scheduler.hpp"
+#include "profiler.hpp"
+
+#include <chrono>
+
+namespace
+{
+	static constexpr std::string_view STRUCTURE_RESOURCE_NAME{ "ecs.structure" };
+}
+
+namespace qf::ecs
+{
+	namespace
+	{
+		// below this many entities a job costs more to hand out than it saves
+		constexpr u32 MIN_JOB_ENTITIES = 4096;
+
+		using Clock = std::chrono::steady_clock;
+
+		u64 nanosecondsSince(Clock::time_point start) {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		}
+
+		std::vector<std::string> getResourceNames(const ComponentMask& mask) {
+			std::vector<std::string> names;
+			for (size_t id = 0; id != mask.size(); ++id) {
+				if (mask.test(id)) {
+					names.push_back(std::format("component.{}", id));
+				}
+			}
+			return names;
+		}
+	}
+
+	Expected<void> SystemScheduler::addSystem(SystemDesc&& desc)
+	{
+		if (!desc.fn == !desc.chunkFn) {
+			return std::unexpected(std::format("system {} needs either fn or chunkFn", desc.name));
+		}
+		if (desc.chunkFn && desc.exclusive) {
+			return std::unexpected(std::format("system {} is exclusive, which needs fn", desc.name));
+		}
+		if (desc.chunkFn && (desc.reads | desc.writes).none()) {
+			return std::unexpected(std::format("system {} has no components to iterate", desc.name));
+		}
+
+		auto reads = getResourceNames(desc.reads & ~desc.writes);
+		auto writes = getResourceNames(desc.writes);
+		// exclusive systems conflict with every other system through the world's structure
+		(desc.exclusive ? writes : reads).emplace_back(STRUCTURE_RESOURCE_NAME);
+
+		const u32 index = static_cast<u32>(systems_.size());
+		TRY_EXPR_IGNORE_VALUE(graph_.addStage({
+			.name = desc.name,
+			.reads = std::move(reads),
+			.writes = std::move(writes),
+			.fn = [this, index](const FrameInfo&) { runSystem(index); },
+		}));
+		systems_.push_back(makeBox<System>());
+		systems_.back()->desc = std::move(desc);
+		return {};
+	}
+
+	Expected<void> SystemScheduler::compile()
+	{
+		TRY_EXPR_IGNORE_VALUE(graph_.compile());
+		stats_.systems.resize(systems_.size());
+		for (u32 i = 0; i != systems_.size(); ++i) {
+			stats_.systems[i].name = systems_[i]->desc.name;
+		}
+		return {};
+	}
+
+	Expected<void> SystemScheduler::execute(jobs::JobSystem& jobSystem, World& world, const FrameInfo& info)
+	{
+		jobSystem_ = &jobSystem;
+		world_ = &world;
+		info_ = &info;
+		auto res = graph_.execute(jobSystem, info);
+		jobSystem_ = nullptr;
+		world_ = nullptr;
+		info_ = nullptr;
+		if (!res.has_value()) {
+			return res;
+		}
+
+		auto const& graphStats = graph_.getLastFrameStats();
+		stats_.frameIndex = graphStats.frameIndex;
+		stats_.frameMs = graphStats.frameMs;
+		stats_.criticalPathMs = graphStats.criticalPathMs;
+		stats_.workMs = 0;
+		for (u32 i = 0; i != systems_.size(); ++i) {
+			auto const& system = *systems_[i];
+			auto& timing = stats_.systems[i];
+			timing.startMs = graphStats.stages[i].startMs;
+			timing.durationMs = graphStats.stages[i].durationMs;
+			timing.critical = graphStats.stages[i].critical;
+			timing.workMs = system.workNs.load(std::memory_order_relaxed) * 1e-6;
+			timing.jobCount = static_cast<u32>(system.jobStarts.size());
+			timing.entityCount = system.entityCount;
+			stats_.workMs += timing.workMs;
+		}
+		stats_.parallelism = stats_.frameMs > 0 ? stats_.workMs / stats_.frameMs : 0;
+		return {};
+	}
+
+	void SystemScheduler::runSystem(u32 index)
+	{
+		System& system = *systems_[index];
+		system.workNs.store(0, std::memory_order_relaxed);
+		system.chunks.clear();
+		system.jobStarts.clear();
+		system.entityCount = 0;
+
+		if (system.desc.fn) {
+			const auto start = Clock::now();
+			system.desc.fn(*world_, *info_);
+			system.workNs.store(nanosecondsSince(start), std::memory_order_relaxed);
+			system.jobStarts.push_back(0);
+			return;
+		}
+
+		world_->forEachArchetype(system.desc.reads | system.desc.writes, [&](const Archetype& archetype) {
+			for (u32 chunk = 0; chunk != archetype.getChunkCount(); ++chunk) {
+				system.chunks.push_back(ChunkRef{ &archetype, chunk });
+			}
+			system.entityCount += archetype.getSize();
+		});
+
+		// runs of whole chunks, each with at least grainSize entities but the last
+		const u32 grainSize = system.desc.grainSize != 0 ? system.desc.grainSize
+			: std::max(MIN_JOB_ENTITIES, system.entityCount / (jobSystem_->getWorkerCount() * 4));
+		u32 entities = 0;
+		for (u32 i = 0; i != system.chunks.size(); ++i) {
+			if (entities == 0) {
+				system.jobStarts.push_back(i);
+			}
+			entities += system.chunks[i].archetype->getChunkSize(system.chunks[i].chunk);
+			if (entities >= grainSize) {
+				entities = 0;
+			}
+		}
+		if (system.jobStarts.empty()) {
+			return;
+		}
+
+		// the first job runs here while the workers take the rest
+		jobs::Counter counter;
+		for (u32 job = 1; job < system.jobStarts.size(); ++job) {
+			jobSystem_->run([this, index, job] { runJob(index, job); }, &counter);
+		}
+		runJob(index, 0);
+		jobSystem_->wait(counter);
+	}
+
+	void SystemScheduler::runJob(u32 index, u32 job)
+	{
+		System& system = *systems_[index];
+		QF_PROFILE_ZONE(system.desc.name.c_str());
+		const u32 first = system.jobStarts[job];
+		const u32 last = job + 1 < system.jobStarts.size() ? system.jobStarts[job + 1] : static_cast<u32>(system.chunks.size());
+		const auto start = Clock::now();
+		for (u32 i = first; i != last; ++i) {
+			system.desc.chunkFn(*system.chunks[i].archetype, system.chunks[i].chunk, *info_);
+		}
+		system.workNs.fetch_add(nanosecondsSince(start), std::memory_order_relaxed);
+	}
+}
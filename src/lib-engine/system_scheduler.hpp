@@ -0,0 +1,181 @@
+#pragma once
+
+#include "engine80.hpp"
+#include "ecs.hpp"
+#include "frame_graph.hpp"
+#include "job_system.hpp"
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace qf::ecs
+{
+	/*
+	* the components of a query that are only read, the const ones
+	*/
+	template<typename... Ts>
+	ComponentMask getReadMask() {
+		ComponentMask mask;
+		([&] {
+			if constexpr (std::is_const_v<Ts>) {
+				mask.set(getComponentId<std::remove_const_t<Ts>>());
+			}
+		}(), ...);
+		return mask;
+	}
+
+	template<typename... Ts>
+	ComponentMask getWriteMask() {
+		ComponentMask mask;
+		([&] {
+			if constexpr (!std::is_const_v<Ts>) {
+				mask.set(getComponentId<Ts>());
+			}
+		}(), ...);
+		return mask;
+	}
+
+	/**
+	 * @brief Runs the systems updating a World, in parallel where their components allow.
+	 *
+	 * Systems name the components they read and write. A system runs after every earlier
+	 * system it conflicts with, one that writes what it reads, reads what it writes or
+	 * writes what it writes, and at the same time as the rest. The ordering is resolved by
+	 * a FrameGraph with one stage per system.
+	 *
+	 * A system given a chunkFn runs over every chunk of the entities with all of its
+	 * components, split into jobs of about grainSize entities each, so one big query keeps
+	 * every worker busy too. Systems that create, destroy, add or remove set exclusive and
+	 * run with no other system.
+	 *
+	 * After each execute() getLastFrameStats() holds every system's wall time, the time its
+	 * jobs spent working and the parallelism achieved: the work done over the frame time.
+	 */
+	class SystemScheduler : NonCopyable
+	{
+	public:
+		using SystemFn = std::function<void(World&, const FrameInfo&)>;
+		using ChunkFn = std::function<void(const Archetype&, u32 chunk, const FrameInfo&)>;
+
+		struct SystemDesc {
+			std::string name;
+			ComponentMask reads{};
+			ComponentMask writes{};
+			// called once per execute, as one job
+			SystemFn fn{};
+			// or called for each chunk with all of reads and writes
+			ChunkFn chunkFn{};
+			// entities per job for a chunkFn. 0 gives each worker a few jobs
+			u32 grainSize = 0;
+			// may change the world's structure, only with fn
+			bool exclusive = false;
+		};
+
+		struct SystemTiming {
+			std::string_view name;
+			double startMs;
+			double durationMs;
+			// summed over the system's jobs, more than durationMs when they ran in parallel
+			double workMs;
+			u32 jobCount;
+			u32 entityCount;
+			bool critical;
+		};
+
+		struct FrameStats {
+			u64 frameIndex;
+			double frameMs;
+			double criticalPathMs;
+			double workMs;
+			double parallelism;
+			std::vector<SystemTiming> systems;
+		};
+
+		Expected<void> addSystem(SystemDesc&& desc);
+
+		/*
+		* adds a system calling fn(const FrameInfo&, Ts&...) for every entity with all of Ts.
+		* a const T is only read
+		*/
+		template<typename... Ts, typename F>
+		Expected<void> addSystem(std::string name, F&& fn, u32 grainSize = 0) {
+			static_assert(sizeof...(Ts) != 0, "a system needs a component to iterate");
+			return addSystem(SystemDesc{
+				.name = std::move(name),
+				.reads = getReadMask<Ts...>(),
+				.writes = getWriteMask<Ts...>(),
+				.chunkFn = [fn = std::forward<F>(fn)](const Archetype& archetype, u32 chunk, const FrameInfo& info) {
+					const u32 size = archetype.getChunkSize(chunk);
+					[&](Ts*... columns) {
+						for (u32 i = 0; i != size; ++i) {
+							fn(info, columns[i]...);
+						}
+					}(archetype.getColumn<Ts>(chunk)...);
+				},
+				.grainSize = grainSize,
+			});
+		}
+
+		/*
+		* resolves the dependencies between the systems added so far
+		*/
+		Expected<void> compile();
+
+		/*
+		* runs every system once and returns when they have all finished
+		*/
+		Expected<void> execute(jobs::JobSystem& jobSystem, World& world, const FrameInfo& info);
+
+		const FrameStats& getLastFrameStats() const { return stats_; }
+
+	private:
+		struct ChunkRef {
+			const Archetype* archetype;
+			u32 chunk;
+		};
+
+		struct System {
+			SystemDesc desc;
+			// the chunks of this execute and where each job's run of them starts
+			std::vector<ChunkRef> chunks;
+			std::vector<u32> jobStarts;
+			std::atomic<u64> workNs{};
+			u32 entityCount = 0;
+		};
+
+		std::vector<Box<System>> systems_{};
+		FrameGraph graph_{};
+
+		/*
+		* only valid during execute(). jobs capture indices into systems_ so their closures
+		* stay small, as in FrameGraph
+		*/
+		jobs::JobSystem* jobSystem_{};
+		World* world_{};
+		const FrameInfo* info_{};
+
+		FrameStats stats_{};
+
+		void runSystem(u32 index);
+		void runJob(u32 index, u32 job);
+	};
+}
+
+template<>
+struct std::formatter<qf::ecs::SystemScheduler::FrameStats> {
+	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
+		return ctx.end();
+	}
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		auto out = format_to(ctx.out(), "systems frame {}: {:.3f} ms, critical path {:.3f} ms, work {:.3f} ms, parallelism {:.2f}\n",
+			val.frameIndex, val.frameMs, val.criticalPathMs, val.workMs, val.parallelism);
+		for (auto const& system : val.systems) {
+			out = format_to(out, "  {} {:<24} start {:8.3f} ms  took {:8.3f} ms  work {:8.3f} ms  {:>4} jobs  {:>8} entities\n",
+				system.critical ? '*' : ' ', system.name, system.startMs, system.durationMs, system.workMs,
+				system.jobCount, system.entityCount);
+		}
+		return out;
+	}
+};
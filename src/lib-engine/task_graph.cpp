@@ -0,0 +1,49 @@
+#include "task_graph.hpp"
+
+namespace qf
+{
+	u32 TaskDependencies::addTask()
+	{
+		tasks_.emplace_back();
+		return static_cast<u32>(tasks_.size() - 1);
+	}
+
+	void TaskDependencies::addDependency(u32 task, u32 dependency)
+	{
+		tasks_[task].dependencies.push_back(dependency);
+		tasks_[dependency].dependents.push_back(task);
+	}
+
+	/*
+	* walks back from the task that finished last, at each step following the dependency
+	* that finished last, since that is the one the task was actually waiting on
+	*/
+	double TaskDependencies::markCriticalPath(std::span<const double> finishMs, std::span<TaskTiming> timings)
+	{
+		const u32 count = getTaskCount();
+		criticalPredecessor_.resize(count);
+		u32 last = NO_TASK;
+		for (u32 i = 0; i != count; ++i) {
+			timings[i].critical = false;
+			criticalPredecessor_[i] = NO_TASK;
+			if (finishMs[i] < 0) {
+				continue;
+			}
+			for (u32 dependency : tasks_[i].dependencies) {
+				if (criticalPredecessor_[i] == NO_TASK || finishMs[dependency] > finishMs[criticalPredecessor_[i]]) {
+					criticalPredecessor_[i] = dependency;
+				}
+			}
+			if (last == NO_TASK || finishMs[i] > finishMs[last]) {
+				last = i;
+			}
+		}
+
+		double lengthMs = 0;
+		for (u32 i = last; i != NO_TASK; i = criticalPredecessor_[i]) {
+			timings[i].critical = true;
+			lengthMs += timings[i].durationMs;
+		}
+		return lengthMs;
+	}
+}
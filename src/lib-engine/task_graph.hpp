@@ -0,0 +1,74 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace qf
+{
+	/*
+	* when a task of a FrameGraph or StartupGraph ran, relative to the start of the graph
+	*/
+	struct TaskTiming {
+		std::string_view name;
+		double startMs;
+		double durationMs;
+		bool mainThread;
+		bool critical;
+	};
+
+	/**
+	 * @brief The dependencies between the tasks of a graph, and the critical path through them.
+	 *
+	 * Shared by FrameGraph, whose tasks are the stages of a frame, and StartupGraph, whose
+	 * tasks are the steps of engine bring-up. Tasks are numbered in the order they are added
+	 * and can only depend on earlier ones, so there can't be a cycle.
+	 *
+	 * Once the tasks have run, markCriticalPath() finds the chain of dependent tasks that
+	 * limited the total time.
+	 */
+	class TaskDependencies
+	{
+		struct Task {
+			std::vector<u32> dependencies;
+			std::vector<u32> dependents;
+		};
+
+		std::vector<Task> tasks_{};
+		std::vector<u32> criticalPredecessor_{};
+
+	public:
+		static constexpr u32 NO_TASK = ~0u;
+
+		u32 addTask();
+
+		/*
+		* task runs after dependency, which must have been added before it
+		*/
+		void addDependency(u32 task, u32 dependency);
+
+		u32 getTaskCount() const { return static_cast<u32>(tasks_.size()); }
+		const std::vector<u32>& getDependencies(u32 task) const { return tasks_[task].dependencies; }
+		const std::vector<u32>& getDependents(u32 task) const { return tasks_[task].dependents; }
+
+		/*
+		* sets critical on the timings of the tasks on the critical path and returns its length.
+		* finishMs holds when each task finished, or is negative for a task that never ran
+		*/
+		double markCriticalPath(std::span<const double> finishMs, std::span<TaskTiming> timings);
+	};
+}
+
+template<>
+struct std::formatter<qf::TaskTiming> {
+	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
+		return ctx.end();
+	}
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
+		return format_to(ctx.out(), "  {} {:<24} start {:8.3f} ms  took {:8.3f} ms{}\n",
+			val.critical ? '*' : ' ', val.name, val.startMs, val.durationMs,
+			val.mainThread ? "  (main thread)" : "");
+	}
+};
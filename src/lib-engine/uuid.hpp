@@ -1,7 +1,12 @@
 #pragma once
 
+#include "hash.hpp"
+
 #include <cstdint>
+#include <cstddef>
 #include <array>
+#include <bit>
+#include <functional>
 
 namespace qf
 {
@@ -29,25 +34,53 @@ namespace qf
 		uint16_t p3{};
 		uint8_t p4[6]{};
 
+		/*
+		* parses the canonical xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx form
+		*/
 		constexpr UUID(const char* p) {
-			p0 = detail::hex(p += 9, 8);
-			p1 = detail::hex(p += 5, 4);
+			p0 = detail::hex(p, 8);
+			p1 = detail::hex(p += 9, 4);
 			p2 = detail::hex(p += 5, 4);
 			p3 = detail::hex(p += 5, 4);
-			for (int i = 0; i != 5; ++i)
-				p4[i] = detail::hex(p += 2, 2);
+			p += 5;
+			for (int i = 0; i != 6; ++i, p += 2)
+				p4[i] = detail::hex(p, 2);
 		}
 
 		constexpr UUID() = default;
 
+		/*
+		* the uuid as two 64 bit words, in field order
+		*/
+		constexpr uint64_t high() const {
+			return uint64_t(p0) << 32 | uint64_t(p1) << 16 | p2;
+		}
+
+		constexpr uint64_t low() const {
+			uint64_t res = p3;
+			for (int i = 0; i != 6; ++i)
+				res = res << 8 | p4[i];
+			return res;
+		}
+
+		/*
+		* the uuid's bytes as two 64 bit words in memory order, cheaper than high() and low()
+		* when the order doesn't matter
+		*/
+		constexpr std::array<uint64_t, 2> words() const {
+			return std::bit_cast<std::array<uint64_t, 2>>(*this);
+		}
+
 		constexpr bool operator==(const UUID& other) const {
-			auto a = (uint64_t[2])other.p0;
-			auto b = (uint64_t[2])p0;
-			return a[0] == b[0] && a[1] == b[1];
+			const auto a = words();
+			const auto b = other.words();
+			return ((a[0] ^ b[0]) | (a[1] ^ b[1])) == 0;
 		}
 
 	};
 
+	static_assert(sizeof(UUID) == 16, "UUID must be exactly 128 bits");
+
 	class FourCC 
 	{
 		std::array<uint8_t, 4> value_;
@@ -59,7 +92,12 @@ namespace qf
 
 		constexpr auto& get() const { return value_; }
 
-		constexpr uint32_t getint() { return *(uint32_t*)value_.data(); }
+		/*
+		* the four characters as they lie in memory, read as one integer
+		*/
+		constexpr uint32_t getint() const { return std::bit_cast<uint32_t>(value_); }
+
+		constexpr bool operator==(const FourCC&) const = default;
 	};
 }
 
@@ -67,7 +105,7 @@ template<>
 struct std::hash<qf::UUID>
 {
 	constexpr std::size_t operator()(const qf::UUID& k) const {
-		const uint32_t* p = &k.p0;
-		return p[0] ^ p[1] ^ p[2] ^ p[3];
+		const auto w = k.words();
+		return static_cast<std::size_t>(qf::detail::mix64(w[0] ^ qf::detail::mix64(w[1] ^ 0x9e3779b97f4a7c15ull)));
 	}
 };
\ No newline at end of file
@@ -0,0 +1,398 @@
+#include "vfs.hpp"
+#include "application_context.hpp"
+#include "asset_pack.hpp"
+#include "flat_hash_map.hpp"
+#include "hash.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "profiler.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	static constexpr std::string_view MOUNTS_PROP_NAME{ "vfs.mounts" };
+}
+
+namespace qf::vfs
+{
+	namespace
+	{
+		struct MountedFile {
+			std::string path;
+			// the asset in the pack, nil for files in a directory
+			UUID assetId;
+		};
+
+		struct Mount {
+			MountId id;
+			s32 priority;
+			fs::path root;
+			ptr<AssetPack> pack;
+			std::vector<MountedFile> files;
+		};
+
+		/*
+		* points into the mounts, which only change under the exclusive lock along with the index
+		*/
+		struct IndexEntry {
+			const Mount* mount;
+			const MountedFile* file;
+		};
+
+		/*
+		* the mount a lookup found a path in, with the normal path
+		*/
+		struct Found {
+			const Mount* mount;
+			std::string_view path;
+			UUID assetId;
+		};
+
+		struct Globals {
+			std::shared_mutex mutex;
+			std::vector<Box<Mount>> mounts;
+			FlatHashMap<u64, IndexEntry> index;
+			MountId nextId = 1;
+			std::atomic<bool> mounted{};
+
+			std::atomic<u64> opens{};
+			std::atomic<u64> misses{};
+			std::atomic<u64> bytesOpened{};
+		};
+
+		Globals& globals() {
+			static Globals g;
+			return g;
+		}
+
+		/*
+		* "./a\\b/../c" and "a/c" name the same file. most paths are already normal and are
+		* used as they are
+		*/
+		bool isNormal(std::string_view path) {
+			return !path.empty() && path.front() != '/' && path.back() != '/'
+				&& path.find('\\') == std::string_view::npos
+				&& path.find("//") == std::string_view::npos
+				&& !path.starts_with("./") && !path.starts_with("../")
+				&& path.find("/.") == std::string_view::npos;
+		}
+
+		std::string normalize(std::string_view path) {
+			std::string normal = fs::path(path).lexically_normal().generic_string();
+			while (normal.starts_with('/')) {
+				normal.erase(0, 1);
+			}
+			if (normal.starts_with("./")) {
+				normal.erase(0, 2);
+			}
+			return normal;
+		}
+
+		/*
+		* adds the mount's files to the index, over files from mounts of lower priority
+		*/
+		void indexMount(Globals& g, const Mount& mount) {
+			g.index.reserve(g.index.size() + mount.files.size());
+			for (auto const& file : mount.files) {
+				auto [it, inserted] = g.index.emplace(hashString(file.path), IndexEntry{ &mount, &file });
+				if (inserted) {
+					continue;
+				}
+				if (it->second.file->path != file.path) {
+					log::warn("vfs paths {} and {} have the same hash, {} is hidden", it->second.file->path, file.path, file.path);
+					continue;
+				}
+				if (mount.priority >= it->second.mount->priority) {
+					it->second = IndexEntry{ &mount, &file };
+				}
+			}
+		}
+
+		void rebuildIndex(Globals& g) {
+			g.index.clear();
+			for (auto const& mount : g.mounts) {
+				indexMount(g, *mount);
+			}
+		}
+
+		/*
+		* only fails when root itself can't be listed. a subdirectory that can't be read is
+		* left out with a warning rather than losing the whole mount to it. hidden directories,
+		* like .git, are never listed
+		*/
+		Expected<std::vector<MountedFile>> listDirectory(const fs::path& root) {
+			QF_PROFILE_ZONE("vfs::listDirectory");
+			std::vector<MountedFile> files;
+			std::vector<fs::path> dirs{ root };
+			while (!dirs.empty()) {
+				const fs::path dir = std::move(dirs.back());
+				dirs.pop_back();
+				std::error_code ec;
+				for (auto it = fs::directory_iterator(dir, fs::directory_options::skip_permission_denied, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+					std::error_code entryEc;
+					if (it->is_directory(entryEc) && !it->is_symlink(entryEc)) {
+						if (!it->path().filename().string().starts_with('.')) {
+							dirs.push_back(it->path());
+						}
+					}
+					else if (it->is_regular_file(entryEc)) {
+						files.push_back(MountedFile{ .path = it->path().lexically_relative(root).generic_string(), .assetId = {} });
+					}
+				}
+				if (ec) {
+					if (dir == root) {
+						return std::unexpected(std::format("can't list {}: {}", root.string(), ec.message()));
+					}
+					log::warn("vfs skipped {}: {}", dir.string(), ec.message());
+				}
+			}
+			return files;
+		}
+
+		MountId addMount(Globals& g, Box<Mount>&& mount) {
+			mount->id = g.nextId++;
+			indexMount(g, *mount);
+			g.mounts.push_back(std::move(mount));
+			g.mounted.store(true, std::memory_order_release);
+			return g.mounts.back()->id;
+		}
+
+		/*
+		* mounts the working directory the first time the vfs is used without anything mounted.
+		* it is listed like any other mount, so lookups never reach the disk
+		*/
+		void ensureMounted(Globals& g) {
+			if (g.mounted.load(std::memory_order_acquire)) {
+				return;
+			}
+			std::unique_lock lock(g.mutex);
+			if (g.mounted.load(std::memory_order_relaxed)) {
+				return;
+			}
+			auto files = listDirectory(".");
+			if (!files.has_value()) {
+				log::warn("vfs mounted the working directory empty, {}", files.error().str());
+			}
+			addMount(g, makeBox<Mount>(Mount{ .id = 0, .priority = 0, .root = ".", .pack = nullptr, .files = std::move(files).value_or(std::vector<MountedFile>{}) }));
+		}
+
+		/*
+		* calls fn with where path was found, or nullptr, under the shared lock
+		*/
+		template<typename F>
+		auto findEntry(std::string_view path, F&& fn) {
+			auto& g = globals();
+			ensureMounted(g);
+			std::string normal;
+			if (!isNormal(path)) {
+				normal = normalize(path);
+				path = normal;
+			}
+			std::shared_lock lock(g.mutex);
+			Found found{ .mount = nullptr, .path = path, .assetId = {} };
+			if (auto it = g.index.find(hashString(path)); it != g.index.end() && it->second.file->path == path) {
+				found.mount = it->second.mount;
+				found.assetId = it->second.file->assetId;
+			}
+			if (!found.mount) {
+				g.misses.fetch_add(1, std::memory_order_relaxed);
+				return fn(static_cast<const Found*>(nullptr));
+			}
+			return fn(&found);
+		}
+	}
+
+	auto Settings::fromConfig() -> Settings
+	{
+		Settings settings;
+		auto ctx = IApplicationContext::getContext();
+		if (!ctx) {
+			return settings;
+		}
+		const auto config = ctx->getConfig();
+		for (size_t i = 0; i != config->getSize(MOUNTS_PROP_NAME); ++i) {
+			const std::string item = std::format("{}.{}.", MOUNTS_PROP_NAME, i);
+			const auto path = config->getString(item + "path");
+			if (!path) {
+				log::warn("vfs mount {} needs a path", i);
+				continue;
+			}
+			settings.mounts.push_back(Mount{
+				.path = std::string(*path),
+				.priority = static_cast<s32>(config->getInt(item + "priority").value_or(0)),
+			});
+		}
+		return settings;
+	}
+
+	Expected<void> initialize(const Settings& settings)
+	{
+		QF_PROFILE_ZONE("vfs::initialize");
+		ensureMounted(globals());
+		for (auto const& mount : settings.mounts) {
+			std::error_code ec;
+			auto res = fs::is_directory(mount.path, ec) ? mountDirectory(mount.path, mount.priority) : mountPack(mount.path, mount.priority);
+			if (!res.has_value()) {
+				return std::unexpected(res.error());
+			}
+		}
+		const Stats stats = getStats();
+		log::info("vfs: {} files from {} mounts", stats.fileCount, stats.mountCount);
+		return {};
+	}
+
+	Expected<MountId> mountDirectory(const fs::path& dir, s32 priority)
+	{
+		auto files = listDirectory(dir);
+		if (!files.has_value()) {
+			return std::unexpected(files.error());
+		}
+		auto& g = globals();
+		std::unique_lock lock(g.mutex);
+		return addMount(g, makeBox<Mount>(Mount{ .id = 0, .priority = priority, .root = dir, .pack = nullptr, .files = std::move(files.value()) }));
+	}
+
+	Expected<MountId> mountPack(const fs::path& path, s32 priority)
+	{
+		QF_PROFILE_ZONE("vfs::mountPack");
+		auto pack = AssetPack::open(path);
+		if (!pack.has_value()) {
+			return std::unexpected(pack.error());
+		}
+		auto mount = makeBox<Mount>(Mount{ .id = 0, .priority = priority, .root = path, .pack = std::move(pack.value()), .files = {} });
+		mount->files.reserve(mount->pack->getAssetCount());
+		mount->pack->forEach([&](const UUID& id) {
+			mount->files.push_back(MountedFile{ .path = normalize(mount->pack->getName(id)), .assetId = id });
+		});
+
+		auto& g = globals();
+		std::unique_lock lock(g.mutex);
+		return addMount(g, std::move(mount));
+	}
+
+	void unmount(MountId mount)
+	{
+		auto& g = globals();
+		Box<Mount> removed;
+		std::unique_lock lock(g.mutex);
+		auto it = std::find_if(g.mounts.begin(), g.mounts.end(), [&](auto const& m) { return m->id == mount; });
+		if (it == g.mounts.end()) {
+			return;
+		}
+		removed = std::move(*it);
+		g.mounts.erase(it);
+		rebuildIndex(g);
+	}
+
+	Expected<void> rescan()
+	{
+		QF_PROFILE_ZONE("vfs::rescan");
+		auto& g = globals();
+		// list without the lock, so lookups carry on while the disk is walked
+		std::vector<std::pair<MountId, fs::path>> dirs;
+		{
+			std::shared_lock lock(g.mutex);
+			for (auto const& mount : g.mounts) {
+				if (!mount->pack) {
+					dirs.emplace_back(mount->id, mount->root);
+				}
+			}
+		}
+		std::vector<std::pair<MountId, std::vector<MountedFile>>> listed;
+		for (auto const& [id, root] : dirs) {
+			auto files = listDirectory(root);
+			if (!files.has_value()) {
+				return std::unexpected(files.error());
+			}
+			listed.emplace_back(id, std::move(files.value()));
+		}
+
+		// mounts unmounted in the meantime are left out
+		std::unique_lock lock(g.mutex);
+		for (auto& [id, files] : listed) {
+			auto it = std::find_if(g.mounts.begin(), g.mounts.end(), [&](auto const& m) { return m->id == id; });
+			if (it != g.mounts.end()) {
+				(*it)->files = std::move(files);
+			}
+		}
+		rebuildIndex(g);
+		return {};
+	}
+
+	bool exists(std::string_view path)
+	{
+		return findEntry(path, [](const Found* found) { return found != nullptr; });
+	}
+
+	Expected<File> open(std::string_view path)
+	{
+		QF_PROFILE_ZONE("vfs::open");
+		auto& g = globals();
+		g.opens.fetch_add(1, std::memory_order_relaxed);
+
+		// the lock is only held to look the file up, mapping it goes to the disk
+		ptr<AssetPack> pack;
+		UUID assetId;
+		fs::path nativePath;
+		const bool exists = findEntry(path, [&](const Found* found) {
+			if (!found) {
+				return false;
+			}
+			if (found->mount->pack) {
+				pack = found->mount->pack;
+				assetId = found->assetId;
+			}
+			else {
+				nativePath = found->mount->root / found->path;
+			}
+			return true;
+		});
+		if (!exists) {
+			return std::unexpected(std::format("no mount has {}", path));
+		}
+
+		if (pack) {
+			auto data = pack->find(assetId);
+			if (!data.has_value()) {
+				return std::unexpected(std::format("{} is damaged in its pack", path));
+			}
+			g.bytesOpened.fetch_add(data->size(), std::memory_order_relaxed);
+			return File(std::move(pack), *data);
+		}
+		auto mapped = MappedFile::open(nativePath);
+		if (!mapped.has_value()) {
+			return std::unexpected(mapped.error());
+		}
+		ptr<const MappedFile> file = std::move(mapped.value());
+		g.bytesOpened.fetch_add(file->getSize(), std::memory_order_relaxed);
+		return File(file, file->getData());
+	}
+
+	std::optional<fs::path> getNativePath(std::string_view path)
+	{
+		return findEntry(path, [](const Found* found) -> std::optional<fs::path> {
+			if (!found || found->mount->pack) {
+				return std::nullopt;
+			}
+			return found->mount->root / found->path;
+		});
+	}
+
+	Stats getStats()
+	{
+		auto& g = globals();
+		std::shared_lock lock(g.mutex);
+		return Stats{
+			.opens = g.opens.load(std::memory_order_relaxed),
+			.misses = g.misses.load(std::memory_order_relaxed),
+			.bytesOpened = g.bytesOpened.load(std::memory_order_relaxed),
+			.fileCount = g.index.size(),
+			.mountCount = static_cast<u32>(g.mounts.size()),
+		};
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "engine80.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qf
+{
+	/**
+	 * @brief One read-only tree of files overlaid from mounted directories and asset packs.
+	 *
+	 * A path names the same file whatever it was mounted from: relative, with forward
+	 * slashes, eg "shaders/mesh.vert.spv". Where more than one mount has a file, the one
+	 * mounted with the highest priority wins, and the latest mount wins a tie.
+	 *
+	 * Mounting lists every file the mount holds into one index keyed by the hash of its path,
+	 * so finding a file never touches the disk. The flip side is that files added to a
+	 * mounted directory aren't seen until rescan(). Opening a file maps it, files in a pack
+	 * are views into the pack's mapping.
+	 *
+	 * The vfs only reads. Files the engine generates, like the config cache, are written
+	 * to disk directly, next to the file they were generated from when it is in a mounted
+	 * directory.
+	 *
+	 * When nothing has been mounted the working directory is mounted on first use, so code
+	 * that never mounts anything sees the files it would have opened without the vfs. It is
+	 * listed like any other mount. Hidden directories, like .git, are left out of every
+	 * directory mount.
+	 */
+	namespace vfs
+	{
+		using MountId = u32;
+
+		struct Settings {
+			struct Mount {
+				std::string path;
+				s32 priority;
+			};
+
+			// mounted in order after the working directory, which has priority 0
+			std::vector<Mount> mounts{};
+
+			static Settings fromConfig();
+		};
+
+		struct Stats {
+			u64 opens;
+			// opens and exists() calls for paths that no mount has
+			u64 misses;
+			u64 bytesOpened;
+			// files in the index
+			u64 fileCount;
+			u32 mountCount;
+		};
+
+		/**
+		 * @brief A file opened through the vfs, mapped read-only.
+		 *
+		 * Copies share the mapping, which lives until the last of them is gone.
+		 */
+		class File
+		{
+			ptr<const void> owner_{};
+			std::span<const std::byte> data_{};
+
+		public:
+			File() = default;
+
+			File(ptr<const void> owner, std::span<const std::byte> data)
+				: owner_(std::move(owner)), data_(data) {}
+
+			std::span<const std::byte> getData() const { return data_; }
+
+			std::string_view getText() const { return { reinterpret_cast<const char*>(data_.data()), data_.size() }; }
+
+			size_t getSize() const { return data_.size(); }
+		};
+
+		/*
+		* mounts the settings' mounts on top of what is already mounted
+		*/
+		Expected<void> initialize(const Settings& settings);
+
+		/*
+		* lists every file below dir, recursively. subdirectories that can't be read are
+		* skipped with a warning
+		*/
+		Expected<MountId> mountDirectory(const std::filesystem::path& dir, s32 priority = 0);
+
+		Expected<MountId> mountPack(const std::filesystem::path& path, s32 priority = 0);
+
+		void unmount(MountId mount);
+
+		/*
+		* lists the mounted directories again, without holding up lookups while it does
+		*/
+		Expected<void> rescan();
+
+		bool exists(std::string_view path);
+
+		Expected<File> open(std::string_view path);
+
+		/*
+		* where a file from a mounted directory is on disk, to watch it for changes. nothing
+		* for files in packs and paths no mount has
+		*/
+		std::optional<std::filesystem::path> getNativePath(std::string_view path);
+
+		Stats getStats();
+	}
+}
@@ -4,7 +4,8 @@
 #include "vulk_surface.hpp"
 #include "application_context.hpp"
 #include "logger.hpp"
-#include <yaml-cpp/yaml.h>
+#include "frame_arena.hpp"
+#include "profiler.hpp"
 #include <ranges>
 #include <array>
 
@@ -26,7 +27,18 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 	const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 	void* pUserData) {
 
-	log::info("{}", pCallbackData->pMessage);
+	if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+		log::error("{}", pCallbackData->pMessage);
+	}
+	else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+		log::warn("{}", pCallbackData->pMessage);
+	}
+	else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+		log::debug("{}", pCallbackData->pMessage);
+	}
+	else {
+		log::trace("{}", pCallbackData->pMessage);
+	}
 
 	return VK_FALSE;
 }
@@ -36,7 +48,7 @@ struct std::formatter<VkLayerProperties> {
 	constexpr auto parse(auto& ctx) -> decltype(ctx.begin()) {
 		return ctx.end();
 	}
-	auto format(auto&& val, auto&& ctx) -> decltype(ctx.out()) {
+	auto format(auto&& val, auto&& ctx) const -> decltype(ctx.out()) {
 		return format_to(ctx.out(), "{}", val.layerName);
 	}
 };
@@ -49,23 +61,33 @@ VulkanGraphics::VulkanGraphics(const CreateInstanceInfo& info)
 
 void VulkanGraphics::config()
 {
-	auto ctx = IApplicationContext::getContext();
-	static auto empty = YAML::Node{};
+	const auto config = IApplicationContext::getContext()->getConfig();
+	auto list = [&](std::string_view name) {
+		auto values = config->getStringList(name);
+		return std::vector<std::string>(values.begin(), values.end());
+	};
 
-	this->requiredExtensions_ = ctx->getProperty(REQUIRED_VULKAN_EXTENSIONS_PROP_NAME).value_or(empty).as<std::vector<std::string>>();
-	this->requiredDebugExtensions_ = ctx->getProperty(REQUIRED_DEBUG_EXTENSIONS_PROP_NAME).value_or(empty).as<std::vector<std::string>>();
-	this->validationLayers_ = ctx->getProperty(VALIDATION_LAYERS_PROPNAME).value_or(empty).as<std::vector<std::string>>();
-	this->useVulkanValidation_ = ctx->getProperty(ENABLE_VALIDATION_PROPERTY_NAME).value_or(empty).as<bool>();
-	this->requirdDeviceExtensions_ = ctx->getProperty(REQUIRED_DEVICE_EXTENSIONS_PROP_NAME).value_or(empty).as<std::vector<std::string>>();
+	this->requiredExtensions_ = list(REQUIRED_VULKAN_EXTENSIONS_PROP_NAME);
+	this->requiredDebugExtensions_ = list(REQUIRED_DEBUG_EXTENSIONS_PROP_NAME);
+	this->validationLayers_ = list(VALIDATION_LAYERS_PROPNAME);
+	this->useVulkanValidation_ = config->getBool(ENABLE_VALIDATION_PROPERTY_NAME).value_or(false);
+	this->requirdDeviceExtensions_ = list(REQUIRED_DEVICE_EXTENSIONS_PROP_NAME);
 
 }
 
 
-Expected<void> VulkanGraphics::initialize()
+Expected<void> VulkanGraphics::initializeInstance()
 {
+	QF_PROFILE_ZONE("VulkanGraphics::initializeInstance");
 	config();
 	TRY_EXPR_IGNORE_VALUE(createInstance());
 	TRY_EXPR_IGNORE_VALUE(setupDebugLogging());
+	return {};
+}
+
+Expected<void> VulkanGraphics::initializeSurface()
+{
+	QF_PROFILE_ZONE("VulkanGraphics::initializeSurface");
 	TRY_EXPR(surface_, Surface::create(*this));
 	return {};
 }
@@ -73,7 +95,7 @@ Expected<void> VulkanGraphics::initialize()
 bool VulkanGraphics::hasValidationLayerSupport() {
 	u32 count;
 	vkEnumerateInstanceLayerProperties(&count, nullptr);
-	std::vector<VkLayerProperties> layers(count);
+	std::pmr::vector<VkLayerProperties> layers(count, FrameArena::get());
 	vkEnumerateInstanceLayerProperties(&count, layers.data());
 	log::info("instance layers: {}", layers);
 
@@ -88,6 +110,7 @@ bool VulkanGraphics::hasValidationLayerSupport() {
 }
 
 Expected<void> VulkanGraphics::createInstance() {
+	QF_PROFILE_ZONE("VulkanGraphics::createInstance");
 
 	Expected<std::vector<std::string>> extensions = getInstanceExtensions();
 	TRY_EXPR_IGNORE_VALUE(extensions);
@@ -117,11 +140,11 @@ Expected<void> VulkanGraphics::createInstance() {
 
 	auto requiredExtensions = requiredExtensions_
 		| std::views::transform(cstr)
-		| std::ranges::to<std::vector<const char*>>();
+		| std::ranges::to<std::pmr::vector<const char*>>(FrameArena::get());
 
 	auto validationLayers = validationLayers_ 
 		| std::views::transform(cstr)
-		| std::ranges::to<std::vector<const char *>>();
+		| std::ranges::to<std::pmr::vector<const char *>>(FrameArena::get());
 
 	if (useVulkanValidation_)
 	{
@@ -199,6 +222,7 @@ Expected<std::vector<std::string>> VulkanGraphics::getInstanceExtensions()
 
 Expected<void> VulkanGraphics::setupDebugLogging()
 {
+	QF_PROFILE_ZONE("VulkanGraphics::setupDebugLogging");
 	if (useVulkanValidation_) {
 		VkDebugUtilsMessengerCreateInfoEXT ci{};
 		ci.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
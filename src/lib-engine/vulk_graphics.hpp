@@ -62,7 +62,9 @@ namespace qf::vulk
 		virtual ~VulkanGraphics() override;
 		void dispose() override;
 
-		virtual Expected<void> initialize() override;
+		virtual Expected<void> initializeInstance() override;
+
+		virtual Expected<void> initializeSurface() override;
 
 		std::optional<VkInstance> getInstance() const 
 		{
@@ -5,8 +5,8 @@
 #include "vulk_swap_chain.hpp"
 #include "vulk_graphics.hpp"
 #include "application_context.hpp"
+#include "profiler.hpp"
 
-#include <yaml-cpp/yaml.h>
 #include <set>
 #include <ranges>
 #include <functional>
@@ -31,6 +31,7 @@ namespace qf::vulk
 
 	Expected<Box<LogicalDevice>> LogicalDevice::create(PhysicalDevice& device)
 	{
+		QF_PROFILE_ZONE("LogicalDevice::create");
 		auto logicalDevice = makeBox<LogicalDevice>(device);
 		TRY_EXPR_IGNORE_VALUE(logicalDevice->initialize());
 		return logicalDevice;
@@ -38,9 +39,9 @@ namespace qf::vulk
     // Initializes the logical device by setting up queue families and creating the device.
     Expected<void> LogicalDevice::initialize() {
         // Get the required device extensions from the application context.
-        requiredDeviceExtensions_ = IApplicationContext::getContext()->getProperty(REQUIRED_DEVICE_EXTENSIONS_PROP_NAME)
-            .value_or(YAML::Node{})
-            .as<std::vector<std::string>>();
+        const auto config = IApplicationContext::getContext()->getConfig();
+        const auto extensions = config->getStringList(REQUIRED_DEVICE_EXTENSIONS_PROP_NAME);
+        requiredDeviceExtensions_.assign(extensions.begin(), extensions.end());
 
 
         // Find the queue families supported by the physical device.
@@ -7,8 +7,9 @@
 #include "vulk_swap_chain.hpp"
 
 #include "logger.hpp"
+#include "frame_arena.hpp"
+#include "profiler.hpp"
 #include <ranges>
-#include <set>
 #include <algorithm>
 using namespace qf;
 using namespace qf::vulk;
@@ -37,6 +38,7 @@ PhysicalDevice::~PhysicalDevice()
 
 Expected<Box<PhysicalDevice>> PhysicalDevice::create(VulkanGraphics& graphics, Surface& surface)
 {
+	QF_PROFILE_ZONE("PhysicalDevice::create");
 
 	u32 count = 0;
 	TRY_VKEXPR(vkEnumeratePhysicalDevices(graphics.getInstance().value(), &count, nullptr));
@@ -82,7 +84,7 @@ auto PhysicalDevice::findQueueFamilies(VkQueueFlagBits flagBits) const -> Expect
 
 	u32 count = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(vkPhysicalDeviceHandle, &count, nullptr);
-	std::vector<VkQueueFamilyProperties> queueFamilyProps(count);
+	std::pmr::vector<VkQueueFamilyProperties> queueFamilyProps(count, FrameArena::get());
 	vkGetPhysicalDeviceQueueFamilyProperties(vkPhysicalDeviceHandle, &count, queueFamilyProps.data());
 
 
@@ -117,16 +119,14 @@ Expected<bool> PhysicalDevice::checkDeviceExtensionSupport(VkPhysicalDevice devi
 	uint32_t extensionCount;
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
-	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	std::pmr::vector<VkExtensionProperties> availableExtensions(extensionCount, FrameArena::get());
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-	std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-	for (const auto& extension : availableExtensions) {
-		requiredExtensions.erase(extension.extensionName);
-	}
-
-	return requiredExtensions.empty();
+	return std::all_of(deviceExtensions.begin(), deviceExtensions.end(), [&](const char* required) {
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(), [&](const VkExtensionProperties& extension) {
+			return strcmp(required, extension.extensionName) == 0;
+		});
+	});
 }
 
 Expected<bool> PhysicalDevice::isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
@@ -170,7 +170,7 @@ bool PhysicalDevice::hasGraphicsQueueFamily(VkPhysicalDevice device) {
 	uint32_t queueFamilyCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
 
-	std::vector<VkQueueFamilyProperties> queueFamilyProps(queueFamilyCount);
+	std::pmr::vector<VkQueueFamilyProperties> queueFamilyProps(queueFamilyCount, FrameArena::get());
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyProps.data());
 
 	return std::any_of(queueFamilyProps.begin(), queueFamilyProps.end(), [](const VkQueueFamilyProperties& props) {
@@ -2,6 +2,7 @@
 #include "vulk_physical_device.hpp"
 #include "vulk_graphics.hpp"
 #include "vulk_logical_device.hpp"
+#include "profiler.hpp"
 
 #include <set>
 
@@ -23,6 +24,7 @@ namespace qf::vulk
 	}
 
 	Expected<Box<Surface>> Surface::create(VulkanGraphics& graphics) {
+		QF_PROFILE_ZONE("Surface::create");
 		auto surfaceObj = std::make_unique<Surface>(graphics);
 		surfaceObj->initialize();
 		return surfaceObj;
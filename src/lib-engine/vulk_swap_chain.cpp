@@ -6,7 +6,7 @@
 #include "application_context.hpp"
 #include "vulk_graphics.hpp"
 #include "platform_interface.hpp"
-#include <yaml-cpp/yaml.h>
+#include "profiler.hpp"
 #include <ranges>
 #include <limits>
 
@@ -37,6 +37,7 @@ namespace qf::vulk
 	}
 
 	auto SwapChain::createSwapChain(LogicalDevice& logicalDevice) -> Expected<Box<SwapChain>> {
+		QF_PROFILE_ZONE("SwapChain::createSwapChain");
 
 		auto& physicalDevice = logicalDevice.getPhysicalDevice();
 
@@ -115,9 +116,8 @@ namespace qf::vulk
 
 	Expected<VkSurfaceFormatKHR> SwapChain::chooseSwapSurfaceFormat(const std::span<VkSurfaceFormatKHR>& availableFormats)
 	{
-		auto formats = IApplicationContext::getContext()->getProperty("graphics.vulkan.swapchain.format")
-			.value_or(YAML::Node{})
-			.as<std::vector<std::string>>();
+		const auto config = IApplicationContext::getContext()->getConfig();
+		auto formats = config->getStringList("graphics.vulkan.swapchain.format");
 
 		auto surfaceFormats = formats
 			| std::views::transform(getVkValue<VkFormat>)